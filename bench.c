@@ -0,0 +1,223 @@
+/**
+ * Copyright © 2018 Andrey Nevolin, https://github.com/AndreyNevolin
+ * Twitter: @Andrey_Nevolin
+ * LinkedIn: https://www.linkedin.com/in/andrey-nevolin-76387328
+ *
+ * Micro-benchmarks of wtmlib's hot paths. Built on top of wtmlib_RunBenchmark()
+ *
+ * Usage: bench [CPU ID]
+ *
+ * If CPU ID is given, benchmarks are pinned to that CPU. Results are printed to stdout
+ * in nanoseconds per operation
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "src/wtmlib.h"
+#include "src/wtmlib_config.h"
+
+/* Number of values converted by a single call in the batch conversion benchmark */
+#define BATCH_SIZE 1024
+
+/* Results of benchmarked operations are stored here so that the compiler can't
+   eliminate the operations */
+static volatile uint64_t sink = 0;
+
+static wtmlib_TSCConversionParams_t conv_params;
+static wtmlib_VersionedTSCConversionParams_t versioned_params;
+static uint64_t batch_tscs[BATCH_SIZE];
+static uint64_t batch_nsecs[BATCH_SIZE];
+
+static void benchGetTSC( void *arg, uint64_t num_iterations)
+{
+    uint64_t acc = 0;
+
+    for ( uint64_t i = 0; i < num_iterations; i++ ) acc += WTMLIB_GET_TSC();
+
+    sink = acc;
+}
+
+static void benchGetTSCFencedPair( void *arg, uint64_t num_iterations)
+{
+    uint64_t acc = 0;
+
+    for ( uint64_t i = 0; i < num_iterations; i++ )
+    {
+        uint64_t start = WTMLIB_GET_TSC_START();
+
+        acc += WTMLIB_GET_TSC_END() - start;
+    }
+
+    sink = acc;
+}
+
+static void benchTSCToNsec( void *arg, uint64_t num_iterations)
+{
+    uint64_t acc = 0;
+
+    /* The loop counter is converted so that the conversions don't depend on each
+       other */
+    for ( uint64_t i = 0; i < num_iterations; i++ )
+    {
+        acc += WTMLIB_TSC_TO_NSEC( i, &conv_params);
+    }
+
+    sink = acc;
+}
+
+#ifdef __SIZEOF_INT128__
+static void benchTSCToNsecWide( void *arg, uint64_t num_iterations)
+{
+    uint64_t acc = 0;
+
+    for ( uint64_t i = 0; i < num_iterations; i++ )
+    {
+        acc += WTMLIB_TSC_TO_NSEC_WIDE( i, &conv_params);
+    }
+
+    sink = acc;
+}
+#endif
+
+static void benchNsecToTSC( void *arg, uint64_t num_iterations)
+{
+    uint64_t acc = 0;
+
+    for ( uint64_t i = 0; i < num_iterations; i++ )
+    {
+        acc += WTMLIB_NSEC_TO_TSC( i, &conv_params);
+    }
+
+    sink = acc;
+}
+
+static void benchTSCToNsecVersioned( void *arg, uint64_t num_iterations)
+{
+    uint64_t acc = 0;
+
+    for ( uint64_t i = 0; i < num_iterations; i++ )
+    {
+        acc += WTMLIB_TSC_TO_NSEC_VERSIONED( i, &versioned_params);
+    }
+
+    sink = acc;
+}
+
+static void benchTSCToNsecBatch( void *arg, uint64_t num_iterations)
+{
+    for ( uint64_t i = 0; i < num_iterations; i++ )
+    {
+        wtmlib_TSCToNsecBatch( batch_tscs, batch_nsecs, BATCH_SIZE, &conv_params);
+    }
+
+    sink = batch_nsecs[BATCH_SIZE - 1];
+}
+
+static void benchClockGettime( void *arg, uint64_t num_iterations)
+{
+    struct timespec ts;
+    uint64_t acc = 0;
+
+    for ( uint64_t i = 0; i < num_iterations; i++ )
+    {
+        clock_gettime( CLOCK_MONOTONIC, &ts);
+        acc += ts.tv_nsec;
+    }
+
+    sink = acc;
+}
+
+typedef struct
+{
+    const char *name;
+    wtmlib_BenchFunc_t func;
+    /* Number of operations performed by a single iteration */
+    uint64_t ops_per_iteration;
+} Benchmark_t;
+
+static const Benchmark_t benchmarks[] =
+{
+    {"WTMLIB_GET_TSC", benchGetTSC, 1},
+    {"WTMLIB_GET_TSC_START/END", benchGetTSCFencedPair, 1},
+    {"WTMLIB_TSC_TO_NSEC", benchTSCToNsec, 1},
+#ifdef __SIZEOF_INT128__
+    {"WTMLIB_TSC_TO_NSEC_WIDE", benchTSCToNsecWide, 1},
+#endif
+    {"WTMLIB_NSEC_TO_TSC", benchNsecToTSC, 1},
+    {"WTMLIB_TSC_TO_NSEC_VERSIONED", benchTSCToNsecVersioned, 1},
+    {"wtmlib_TSCToNsecBatch (per value)", benchTSCToNsecBatch, BATCH_SIZE},
+    {"clock_gettime(CLOCK_MONOTONIC)", benchClockGettime, 1}
+};
+
+int main( int argc, char **argv)
+{
+    char err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    wtmlib_BenchParams_t params = {.cpu_id = -1,
+                                   .num_warmup_iterations =
+                                       WTMLIB_BENCH_WARMUP_ITERATIONS,
+                                   .num_samples = WTMLIB_BENCH_SAMPLES,
+                                   .iterations_per_sample =
+                                       WTMLIB_BENCH_ITERATIONS_PER_SAMPLE};
+    int ret = 0;
+
+    if ( argc > 2 )
+    {
+        fprintf( stderr, "Usage: %s [CPU ID]\n", argv[0]);
+
+        return 1;
+    }
+
+    if ( argc == 2 ) params.cpu_id = atoi( argv[1]);
+
+    fprintf( stdout, "Calibrating TSC...\n");
+    ret = wtmlib_GetTSCToNsecConversionParamsFast( true, &conv_params, 0, 0, err_msg,
+                                                   sizeof( err_msg));
+
+    if ( !ret )
+    {
+        ret = wtmlib_MeasureTSCReadOverhead( &conv_params, err_msg, sizeof( err_msg));
+    }
+
+    if ( ret )
+    {
+        fprintf( stderr, "Calibration failed: %s\n", err_msg);
+
+        return 1;
+    }
+
+    wtmlib_InitVersionedTSCConversionParams( &versioned_params, &conv_params);
+
+    for ( int i = 0; i < BATCH_SIZE; i++ ) batch_tscs[i] = WTMLIB_GET_TSC();
+
+    fprintf( stdout, "TSC ticks per second: %lu, fenced read overhead: %lu ticks\n\n",
+             conv_params.tsc_ticks_per_sec, conv_params.fenced_read_overhead.min);
+    fprintf( stdout, "%-36s %10s %10s %10s %18s %9s\n", "Operation (ns)", "min",
+             "median", "p99", "mean", "outliers");
+
+    for ( uint64_t i = 0; i < sizeof( benchmarks) / sizeof( benchmarks[0]); i++ )
+    {
+        const Benchmark_t *bench = &benchmarks[i];
+        wtmlib_BenchResult_t result;
+        double ops = bench->ops_per_iteration;
+
+        ret = wtmlib_RunBenchmark( bench->func, 0, &params, &conv_params, &result,
+                                   err_msg, sizeof( err_msg));
+
+        if ( ret )
+        {
+            fprintf( stderr, "Benchmark \"%s\" failed: %s\n", bench->name, err_msg);
+
+            return 1;
+        }
+
+        fprintf( stdout, "%-36s %10.2f %10.2f %10.2f %10.2f +-%5.2f %9lu\n", bench->name,
+                 result.min_nsec / ops, result.median_nsec / ops, result.p99_nsec / ops,
+                 result.mean_nsec / ops, result.std_error_nsec / ops,
+                 result.num_outliers);
+    }
+
+    return 0;
+}
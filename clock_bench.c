@@ -0,0 +1,375 @@
+/**
+ * Copyright © 2018 Andrey Nevolin, https://github.com/AndreyNevolin
+ * Twitter: @Andrey_Nevolin
+ * LinkedIn: https://www.linkedin.com/in/andrey-nevolin-76387328
+ *
+ * Benchmark comparing wtmlib's TSC-based time measurement against the system clocks
+ *
+ * Usage: clock_bench
+ *
+ * Every operation is benchmarked on every CPU allowed by the affinity mask of the
+ * process. First one CPU at a time ("single" mode). Then on all the CPUs simultaneously
+ * ("contended" mode). In contended mode a thread that finishes its measurements keeps
+ * executing the operation until all the other threads finish too.
+ *
+ * Two numbers are measured for each operation:
+ *      - latency: duration of a single call (every sample contains exactly one call)
+ *      - throughput: millions of back-to-back calls per second
+ *
+ * Results are printed to stdout in CSV format, one line per operation, CPU and mode:
+ *      mode,cpu,operation,min_ns,median_ns,p99_ns,max_ns,mean_ns,std_error_ns,
+ *      outliers,mops_per_sec
+ * Latency is given in nanoseconds. Progress messages are printed to stderr
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "src/wtmlib.h"
+
+#define LATENCY_SAMPLES 10000
+#define THROUGHPUT_SAMPLES 200
+#define THROUGHPUT_ITERATIONS_PER_SAMPLE 1000
+#define WARMUP_ITERATIONS 10000
+
+/* Results of benchmarked operations are stored here so that the compiler can't
+   eliminate the operations */
+static volatile uint64_t sink = 0;
+
+static wtmlib_TSCConversionParams_t conv_params;
+
+static void benchGetTSC( void *arg, uint64_t num_iterations)
+{
+    uint64_t acc = 0;
+
+    for ( uint64_t i = 0; i < num_iterations; i++ ) acc += WTMLIB_GET_TSC();
+
+    sink = acc;
+}
+
+static void benchGetTSCAndCPU( void *arg, uint64_t num_iterations)
+{
+    uint64_t acc = 0;
+    int cpu = 0;
+
+    for ( uint64_t i = 0; i < num_iterations; i++ )
+    {
+        acc += WTMLIB_GET_TSC_AND_CPU( &cpu);
+    }
+
+    sink = acc + cpu;
+}
+
+static void benchGetTSCFencedPair( void *arg, uint64_t num_iterations)
+{
+    uint64_t acc = 0;
+
+    for ( uint64_t i = 0; i < num_iterations; i++ )
+    {
+        uint64_t start = WTMLIB_GET_TSC_START();
+
+        acc += WTMLIB_GET_TSC_END() - start;
+    }
+
+    sink = acc;
+}
+
+static void benchTSCToNsec( void *arg, uint64_t num_iterations)
+{
+    uint64_t acc = 0;
+
+    for ( uint64_t i = 0; i < num_iterations; i++ )
+    {
+        acc += WTMLIB_TSC_TO_NSEC( WTMLIB_GET_TSC(), &conv_params);
+    }
+
+    sink = acc;
+}
+
+static void benchClockGettime( void *arg, uint64_t num_iterations)
+{
+    clockid_t clk_id = *(const clockid_t*)arg;
+    struct timespec ts;
+    uint64_t acc = 0;
+
+    for ( uint64_t i = 0; i < num_iterations; i++ )
+    {
+        clock_gettime( clk_id, &ts);
+        acc += ts.tv_nsec;
+    }
+
+    sink = acc;
+}
+
+/* Same as above but uses the TSC-based clock (see wtmlib_StartClock()) */
+static void benchWtmlibClockGettime( void *arg, uint64_t num_iterations)
+{
+    clockid_t clk_id = *(const clockid_t*)arg;
+    struct timespec ts;
+    uint64_t acc = 0;
+
+    for ( uint64_t i = 0; i < num_iterations; i++ )
+    {
+        wtmlib_clock_gettime( clk_id, &ts);
+        acc += ts.tv_nsec;
+    }
+
+    sink = acc;
+}
+
+/* Same as above but bypasses vDSO */
+static void benchClockGettimeSyscall( void *arg, uint64_t num_iterations)
+{
+    clockid_t clk_id = *(const clockid_t*)arg;
+    struct timespec ts;
+    uint64_t acc = 0;
+
+    for ( uint64_t i = 0; i < num_iterations; i++ )
+    {
+        syscall( SYS_clock_gettime, clk_id, &ts);
+        acc += ts.tv_nsec;
+    }
+
+    sink = acc;
+}
+
+static const clockid_t clock_monotonic = CLOCK_MONOTONIC;
+static const clockid_t clock_monotonic_raw = CLOCK_MONOTONIC_RAW;
+static const clockid_t clock_realtime = CLOCK_REALTIME;
+
+typedef struct
+{
+    const char *name;
+    wtmlib_BenchFunc_t func;
+    const void *arg;
+} Operation_t;
+
+static const Operation_t operations[] =
+{
+    {"WTMLIB_GET_TSC", benchGetTSC, 0},
+    {"WTMLIB_GET_TSC_AND_CPU", benchGetTSCAndCPU, 0},
+    {"WTMLIB_GET_TSC_START/END", benchGetTSCFencedPair, 0},
+    {"WTMLIB_TSC_TO_NSEC(WTMLIB_GET_TSC)", benchTSCToNsec, 0},
+    {"clock_gettime(CLOCK_MONOTONIC)", benchClockGettime, &clock_monotonic},
+    {"clock_gettime(CLOCK_MONOTONIC_RAW)", benchClockGettime, &clock_monotonic_raw},
+    {"clock_gettime(CLOCK_REALTIME)", benchClockGettime, &clock_realtime},
+    {"wtmlib_clock_gettime(CLOCK_MONOTONIC)", benchWtmlibClockGettime, &clock_monotonic},
+    {"wtmlib_clock_gettime(CLOCK_REALTIME)", benchWtmlibClockGettime, &clock_realtime},
+    {"syscall(clock_gettime,CLOCK_MONOTONIC)", benchClockGettimeSyscall,
+     &clock_monotonic}
+};
+
+#define NUM_OPERATIONS (sizeof( operations) / sizeof( operations[0]))
+
+/* Results of benchmarking a single operation on a single CPU */
+typedef struct
+{
+    wtmlib_BenchResult_t latency;
+    wtmlib_BenchResult_t throughput;
+} OperationResult_t;
+
+/* State shared by threads that benchmark an operation simultaneously */
+typedef struct
+{
+    const Operation_t *operation;
+    pthread_barrier_t start_barrier;
+    int num_finished;
+    int num_threads;
+} ContendedRun_t;
+
+typedef struct
+{
+    ContendedRun_t *run;
+    int cpu_id;
+    OperationResult_t result;
+    int ret;
+    char err_msg[WTMLIB_MAX_ERR_MSG_SIZE];
+} ThreadArg_t;
+
+static int benchmarkOperation( const Operation_t *operation, int cpu_id,
+                               OperationResult_t *result, char *err_msg,
+                               int err_msg_size)
+{
+    wtmlib_BenchParams_t params = {.cpu_id = cpu_id,
+                                   .num_warmup_iterations = WARMUP_ITERATIONS,
+                                   .num_samples = LATENCY_SAMPLES,
+                                   .iterations_per_sample = 1};
+    int ret = 0;
+
+    ret = wtmlib_RunBenchmark( operation->func, (void*)operation->arg, &params,
+                               &conv_params, &result->latency, err_msg, err_msg_size);
+
+    if ( ret ) return ret;
+
+    params.num_samples = THROUGHPUT_SAMPLES;
+    params.iterations_per_sample = THROUGHPUT_ITERATIONS_PER_SAMPLE;
+
+    return wtmlib_RunBenchmark( operation->func, (void*)operation->arg, &params,
+                                &conv_params, &result->throughput, err_msg,
+                                err_msg_size);
+}
+
+static void *contendedThread( void *arg)
+{
+    ThreadArg_t *thread_arg = (ThreadArg_t*)arg;
+    ContendedRun_t *run = thread_arg->run;
+
+    pthread_barrier_wait( &run->start_barrier);
+    thread_arg->ret = benchmarkOperation( run->operation, thread_arg->cpu_id,
+                                          &thread_arg->result, thread_arg->err_msg,
+                                          sizeof( thread_arg->err_msg));
+    __atomic_add_fetch( &run->num_finished, 1, __ATOMIC_ACQ_REL);
+
+    /* Keep loading the system until every thread is done with the measurements */
+    while ( __atomic_load_n( &run->num_finished, __ATOMIC_ACQUIRE) < run->num_threads )
+    {
+        run->operation->func( (void*)run->operation->arg,
+                              THROUGHPUT_ITERATIONS_PER_SAMPLE);
+    }
+
+    return 0;
+}
+
+static void printResult( const char *mode, int cpu_id, const Operation_t *operation,
+                         const OperationResult_t *result)
+{
+    const wtmlib_BenchResult_t *latency = &result->latency;
+
+    fprintf( stdout, "%s,%d,\"%s\",%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%lu,%.2f\n", mode,
+             cpu_id, operation->name, latency->min_nsec, latency->median_nsec,
+             latency->p99_nsec, latency->max_nsec, latency->mean_nsec,
+             latency->std_error_nsec, latency->num_outliers,
+             1000.0 / result->throughput.mean_nsec);
+    fflush( stdout);
+}
+
+int main( int argc, char **argv)
+{
+    char err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    int cpus[CPU_SETSIZE];
+    ThreadArg_t thread_args[CPU_SETSIZE];
+    pthread_t threads[CPU_SETSIZE];
+    cpu_set_t cpu_set;
+    int num_cpus = 0;
+    int ret = 0;
+
+    if ( argc != 1 )
+    {
+        fprintf( stderr, "Usage: %s\n", argv[0]);
+
+        return 1;
+    }
+
+    if ( sched_getaffinity( 0, sizeof( cpu_set), &cpu_set) )
+    {
+        fprintf( stderr, "Couldn't get CPU affinity of the process\n");
+
+        return 1;
+    }
+
+    for ( int cpu = 0; cpu < CPU_SETSIZE; cpu++ )
+    {
+        if ( CPU_ISSET( cpu, &cpu_set) ) cpus[num_cpus++] = cpu;
+    }
+
+    fprintf( stderr, "Calibrating TSC...\n");
+    ret = wtmlib_GetTSCToNsecConversionParamsFast( true, &conv_params, 0, 0, err_msg,
+                                                   sizeof( err_msg));
+
+    if ( !ret )
+    {
+        ret = wtmlib_MeasureTSCReadOverhead( &conv_params, err_msg, sizeof( err_msg));
+    }
+
+    if ( ret )
+    {
+        fprintf( stderr, "Calibration failed: %s\n", err_msg);
+
+        return 1;
+    }
+
+    fprintf( stderr, "Starting the TSC-based clock...\n");
+
+    if ( wtmlib_StartClock( true, err_msg, sizeof( err_msg)) )
+    {
+        fprintf( stderr, "Couldn't start the TSC-based clock: %s\n", err_msg);
+
+        return 1;
+    }
+
+    fprintf( stdout, "mode,cpu,operation,min_ns,median_ns,p99_ns,max_ns,mean_ns,"
+             "std_error_ns,outliers,mops_per_sec\n");
+
+    for ( uint64_t op = 0; op < NUM_OPERATIONS; op++ )
+    {
+        for ( int i = 0; i < num_cpus; i++ )
+        {
+            OperationResult_t result;
+
+            fprintf( stderr, "single: %s on CPU %d\n", operations[op].name, cpus[i]);
+
+            if ( benchmarkOperation( &operations[op], cpus[i], &result, err_msg,
+                                     sizeof( err_msg)) )
+            {
+                fprintf( stderr, "Benchmark failed: %s\n", err_msg);
+
+                return 1;
+            }
+
+            printResult( "single", cpus[i], &operations[op], &result);
+        }
+    }
+
+    for ( uint64_t op = 0; op < NUM_OPERATIONS; op++ )
+    {
+        ContendedRun_t run;
+
+        fprintf( stderr, "contended: %s on %d CPUs\n", operations[op].name, num_cpus);
+        run.operation = &operations[op];
+        run.num_finished = 0;
+        run.num_threads = num_cpus;
+        pthread_barrier_init( &run.start_barrier, 0, num_cpus);
+
+        for ( int i = 0; i < num_cpus; i++ )
+        {
+            thread_args[i].run = &run;
+            thread_args[i].cpu_id = cpus[i];
+            thread_args[i].ret = 0;
+
+            if ( pthread_create( &threads[i], 0, contendedThread, &thread_args[i]) )
+            {
+                /* Threads that are already waiting on the barrier would never wake
+                   up */
+                fprintf( stderr, "Couldn't create a benchmarking thread\n");
+
+                return 1;
+            }
+        }
+
+        for ( int i = 0; i < num_cpus; i++ ) pthread_join( threads[i], 0);
+
+        pthread_barrier_destroy( &run.start_barrier);
+
+        for ( int i = 0; i < num_cpus; i++ )
+        {
+            if ( thread_args[i].ret )
+            {
+                fprintf( stderr, "Benchmark on CPU %d failed: %s\n", cpus[i],
+                         thread_args[i].err_msg);
+
+                return 1;
+            }
+
+            printResult( "contended", cpus[i], &operations[op], &thread_args[i].result);
+        }
+    }
+
+    return 0;
+}
@@ -16,10 +16,30 @@
 #include <errno.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
+#include <time.h>
+#include <dlfcn.h>
 
 /* System headers */
 #include <sys/sysinfo.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <linux/perf_event.h>
+
+#ifdef WTMLIB_ARCH_X86_64
+#include <cpuid.h>
+#endif
+
+/* Some code paths use x86-64 instruction set extensions (AVX2, AVX-512, WAITPKG). They
+   are compiled by means of GCC's "target" attribute. Whether an extension can be used
+   is decided at run time */
+#if defined( WTMLIB_ARCH_X86_64) && defined( __GNUC__)
+#define WTMLIB_X86_EXTENSIONS
+#include <immintrin.h>
+#endif
 
 #ifdef WTMLIB_DEBUG
 #include <execinfo.h>
@@ -180,7 +200,8 @@ static int wtmlib_GetCacheLineSize( char *err_msg,
  * "wtmlib_CollectTSCInCPUCarousel()" and "wtmlib_TSCProbeThread()"
  *
  * The function returns:
- *     1) an array of pointers to CPU set structures
+ *     1) an array of pointers to CPU set structures (only if "cpu_sets_ret" is
+ *        non-zero)
  *     2) an array of pointers to arrays of TSC samples
  *
  * The function doesn't change "cpu_sets_ret" and "tsc_vals_ret" pointers if fails.
@@ -197,7 +218,7 @@ static int wtmlib_AllocMemForTSCSampling( int cline_size,
                                           char *err_msg,
                                           int err_msg_size)
 {
-    WTMLIB_ASSERT( cpu_sets_ret && tsc_samples_ret);
+    WTMLIB_ASSERT( tsc_samples_ret);
 
     int ret = 0;
     cpu_set_t **cpu_sets = 0;
@@ -220,9 +241,12 @@ static int wtmlib_AllocMemForTSCSampling( int cline_size,
        share the same cache line, there will be no cache line "ping pong" between CPUs.
        Each CPU will just have its own "read-only" cache line copy. The same is true in
        case when CPU set structures share cache lines with other "read-only" data */
-    cpu_sets = (cpu_set_t**)calloc( sizeof( cpu_set_t*), num_cpu_sets);
+    if ( cpu_sets_ret )
+    {
+        cpu_sets = (cpu_set_t**)calloc( sizeof( cpu_set_t*), num_cpu_sets);
+    }
 
-    if ( !cpu_sets )
+    if ( cpu_sets_ret && !cpu_sets )
     {
         WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory to keep "
                          "an array of pointers to CPU sets");
@@ -232,7 +256,7 @@ static int wtmlib_AllocMemForTSCSampling( int cline_size,
     }
 
     /* Allocate memory for CPU sets. Store pointers to them in the array */
-    for ( int i = 0; i < num_cpu_sets; i++ )
+    for ( int i = 0; cpu_sets && i < num_cpu_sets; i++ )
     {
         cpu_sets[i] = CPU_ALLOC( num_cpus);
 
@@ -290,7 +314,8 @@ static int wtmlib_AllocMemForTSCSampling( int cline_size,
 alloc_mem_for_tsc_sampling_out:
     if ( !ret )
     {
-        *cpu_sets_ret = cpu_sets;
+        if ( cpu_sets_ret ) *cpu_sets_ret = cpu_sets;
+
         *tsc_samples_ret = tsc_samples;
 
         return 0;
@@ -775,6 +800,62 @@ calc_tsc_enclosing_range_cpusw_out:
     return ret;
 }
 
+/**
+ * Read the first line of a file into the provided buffer. The trailing newline
+ * character (if any) is removed
+ */
+static int wtmlib_ReadFirstLine( const char *path,
+                                 char *buff,
+                                 int buff_size,
+                                 char *err_msg,
+                                 int err_msg_size)
+{
+    WTMLIB_ASSERT( path && buff && buff_size > 0);
+
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    FILE *file = fopen( path, "r");
+
+    if ( !file )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't open \"%s\": %s", path,
+                         WTMLIB_STRERROR_R( local_err_msg, sizeof( local_err_msg)));
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    if ( !fgets( buff, buff_size, file) )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't read from \"%s\"", path);
+        fclose( file);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    fclose( file);
+    buff[strcspn( buff, "\n")] = '\0';
+
+    return 0;
+}
+
+/**
+ * Get ID of a physical package (socket) that the specified CPU belongs to
+ *
+ * "-1" is returned if the ID cannot be obtained (e.g. if the topology is not
+ * exported by the kernel)
+ */
+static int wtmlib_GetCPUPackageID( int cpu_id)
+{
+    char path[PATH_MAX] = "";
+    char value[32] = "";
+
+    snprintf( path, sizeof( path),
+              "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu_id);
+
+    if ( wtmlib_ReadFirstLine( path, value, sizeof( value), 0, 0) ) return -1;
+
+    return atoi( value);
+}
+
 /**
  * Get values of selected parameters that describe:
  *   - hardware state
@@ -1177,11 +1258,22 @@ typedef struct
     uint64_t seq_num;
 } wtmlib_TSCProbe_t;
 
+/**
+ * Pool of TSC probe threads (declared below)
+ */
+typedef struct wtmlib_TSCProbeThreadPool wtmlib_TSCProbeThreadPool_t;
+
 /**
  * Type that describes an argument of TSC probe thread
  */
 typedef struct
 {
+    /* Pool that the thread belongs to */
+    wtmlib_TSCProbeThreadPool_t *pool;
+    /* Whether the thread participates in the current round of probing */
+    bool is_active;
+    /* Result of the thread's start-up */
+    int ret;
     /* CPU set that represents a CPU that the thread must be executed on */
     cpu_set_t *cpu_set;
     /* Number of CPUs in the system */
@@ -1206,12 +1298,59 @@ typedef struct
     char err_msg[WTMLIB_MAX_ERR_MSG_SIZE];
 } wtmlib_TSCProbeThreadArg_t;
 
+/**
+ * Pool of persistent TSC probe threads (one thread per each available CPU)
+ */
+struct wtmlib_TSCProbeThreadPool
+{
+    /* Number of threads in the pool */
+    int num_threads;
+    /* Number of threads that were actually started */
+    int num_started;
+    /* Number of CPUs in the system */
+    int num_cpus;
+    /* Cache line size */
+    int cline_size;
+    /* cpu_ids[i] is ID of a CPU that thread "i" is bound to */
+    int *cpu_ids;
+    /* cpu_sets[i] is a CPU set that represents CPU cpu_ids[i] */
+    cpu_set_t **cpu_sets;
+    /* Arguments of the threads */
+    wtmlib_TSCProbeThreadArg_t *thread_args;
+    /* Thread descriptors */
+    pthread_t *thread_descs;
+    /* Cache-line aligned memory for sequence and "ready" counters (a cache line per
+       group of threads that collect probes simultaneously) */
+    char *counters;
+    /* Mutex that protects the fields below and "is_active" fields of the threads'
+       arguments */
+    pthread_mutex_t mutex;
+    /* Signalled when a new round of probing starts (or the pool is shut down) */
+    pthread_cond_t round_start;
+    /* Signalled when a thread completes its part of the round */
+    pthread_cond_t round_done;
+    /* Number of the current round */
+    uint64_t round;
+    /* Number of threads that completed the current round */
+    int num_done;
+    /* Number of threads that exited (or are about to exit) */
+    int num_exited;
+    /* Whether the threads must exit */
+    bool is_shutdown;
+    /* Whether some round didn't complete in time. Threads of a "broken" pool can only
+       be cancelled */
+    bool is_broken;
+};
+
 /**
  * Initialize an argument for a TSC probe thread
  */
 static void wtmlib_InitTSCProbeThreadArg( wtmlib_TSCProbeThreadArg_t* arg)
 {
     WTMLIB_ASSERT( arg);
+    arg->pool = 0;
+    arg->is_active = false;
+    arg->ret = 0;
     arg->cpu_set = 0;
     arg->num_cpus = -1;
     arg->tsc_probes = 0;
@@ -1307,13 +1446,60 @@ static void wtmlib_DeallocMemForTSCProbeThreads( wtmlib_TSCProbeThreadArg_t *thr
 }
 
 /**
- * Thread that collects TSC probes
+ * Bind the current thread to a designated CPU
+ */
+static int wtmlib_BindThreadToCPU( cpu_set_t *cpu_set,
+                                   int num_cpus,
+                                   char *err_msg,
+                                   int err_msg_size)
+{
+    WTMLIB_ASSERT( cpu_set);
+
+    if ( pthread_setaffinity_np( pthread_self(), CPU_ALLOC_SIZE( num_cpus), cpu_set) )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't bind itself to a designated "
+                         "CPU");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    return 0;
+}
+
+/**
+ * Wait until all measurement threads are ready to take measurements
  *
- * NOTE: TSC probe threads must allow asynchronous cancelability at any time.
- *       Explicit memory allocation is not allowed inside these threads.
- *       Synchronization methods should be thought through carefully.
+ * We use a shared counter to ensure that all threads start measuring more or less
+ * simultaneously. Each thread increments the counter when it is ready to take
+ * measurements. Then the thread waits until the counter reaches its target value (which
+ * is equal to the number of threads)
  */
-static void *wtmlib_TSCProbeThread( void *thread_arg)
+static inline void wtmlib_SyncMeasurementThreads( int *ready_counter, int num_threads)
+{
+    WTMLIB_ASSERT( ready_counter);
+    __atomic_add_fetch( ready_counter, 1, __ATOMIC_ACQ_REL);
+
+    /* Just spin (and burn CPU cycles, but hopefully for not so long) */
+    while ( __atomic_load_n( ready_counter, __ATOMIC_ACQUIRE) < num_threads )
+    {
+        ;
+    }
+
+    return;
+}
+
+/**
+ * Prepare a pinned measurement thread for work:
+ *   - make the thread cancellable at any time
+ *   - bind the thread to a designated CPU
+ *   - wait until all other measurement threads are also ready
+ */
+static int wtmlib_PrepareMeasurementThread( cpu_set_t *cpu_set,
+                                            int num_cpus,
+                                            int *ready_counter,
+                                            int num_threads,
+                                            char *err_msg,
+                                            int err_msg_size)
 {
     /* Make sure the thread can be cancelled at any time. Using "zero" as a second
        argument in the two function calls below is not POSIX-friendly. But there is some
@@ -1321,35 +1507,26 @@ static void *wtmlib_TSCProbeThread( void *thread_arg)
        "zeros" is not a priority problem */
     pthread_setcancelstate( PTHREAD_CANCEL_ENABLE, 0);
     pthread_setcanceltype( PTHREAD_CANCEL_ASYNCHRONOUS, 0);
-    WTMLIB_ASSERT( thread_arg);
-    WTMLIB_ASSERT( ((wtmlib_TSCProbeThreadArg_t*)thread_arg)->cpu_set);
 
-    wtmlib_TSCProbeThreadArg_t *arg = (wtmlib_TSCProbeThreadArg_t*)thread_arg;
-    pthread_t thread_self = pthread_self();
-    int cpu_set_size = CPU_ALLOC_SIZE( arg->num_cpus);
+    int ret = wtmlib_BindThreadToCPU( cpu_set, num_cpus, err_msg, err_msg_size);
 
-    /* Switch to a CPU designated for this thread */
-    if ( pthread_setaffinity_np( thread_self, cpu_set_size, arg->cpu_set) )
-    {
-        WTMLIB_BUFF_MSG( arg->err_msg, sizeof( arg->err_msg), "Couldn't bind itself "
-                         "to a designated CPU");
+    if ( ret ) return ret;
 
-        return (void*)(long int)WTMLIB_RET_GENERIC_ERR;
-    }
+    wtmlib_SyncMeasurementThreads( ready_counter, num_threads);
 
-    /* At this point the thread is ready to collect TSC probes. But it doesn't start
-       doing that until all other threads are also ready. We use a shared counter to
-       ensure that all threads start collecting probes more or less simultaneously.
-       Each thread increments the counter when it is ready to collect probes. Then
-       the thread waits until the counter reaches its target value (which is equal to
-       the number of threads) */
-    __atomic_add_fetch( arg->ready_counter, 1, __ATOMIC_ACQ_REL);
+    return 0;
+}
 
-    /* Just spin (and burn CPU cycles, but hopefully for not so long) */
-    while ( __atomic_load_n( arg->ready_counter, __ATOMIC_ACQUIRE) < arg->num_threads )
-    {
-        ;
-    }
+/**
+ * Collect TSC probes (the actual work done by a TSC probe thread during a round of
+ * CAS-ordered probing)
+ */
+static void wtmlib_CollectTSCProbes( wtmlib_TSCProbeThreadArg_t *arg)
+{
+    WTMLIB_ASSERT( arg);
+    /* The thread doesn't start collecting probes until all other threads participating
+       in the round are also ready */
+    wtmlib_SyncMeasurementThreads( arg->ready_counter, arg->num_threads);
 
     uint64_t *seq_counter = arg->seq_counter;
 
@@ -1379,6 +1556,101 @@ static void *wtmlib_TSCProbeThread( void *thread_arg)
         arg->tsc_probes[i].tsc_val = tsc_val;
     }
 
+    return;
+}
+
+/**
+ * Cleanup handler that releases a mutex (used when a thread is cancelled while waiting
+ * on a condition variable)
+ */
+static void wtmlib_UnlockMutex( void *mutex)
+{
+    pthread_mutex_unlock( (pthread_mutex_t*)mutex);
+
+    return;
+}
+
+/**
+ * Thread that collects TSC probes
+ *
+ * TSC probe threads are persistent. Each thread is bound to its CPU only once, right
+ * after the start. Then the thread parks on a condition variable and waits for rounds of
+ * CAS-ordered probing (see "wtmlib_CollectCASOrderedTSCProbes()"). Only the threads
+ * marked as active participate in a round. The thread exits when its pool is shut down.
+ *
+ * NOTE: while parked the thread can be cancelled only at cancellation points. While
+ *       collecting probes the thread allows asynchronous cancelability at any time.
+ *       Explicit memory allocation is not allowed inside these threads.
+ *       Synchronization methods should be thought through carefully.
+ */
+static void *wtmlib_TSCProbeThread( void *thread_arg)
+{
+    /* The thread parks on a condition variable. Hence, deferred cancelability. Using
+       "zero" as a second argument in the two function calls below is not POSIX-
+       friendly. But there is some other non-portable stuff in this library which is hard
+       to get rid of. So, for now "zeros" is not a priority problem */
+    pthread_setcancelstate( PTHREAD_CANCEL_ENABLE, 0);
+    pthread_setcanceltype( PTHREAD_CANCEL_DEFERRED, 0);
+    WTMLIB_ASSERT( thread_arg);
+    WTMLIB_ASSERT( ((wtmlib_TSCProbeThreadArg_t*)thread_arg)->pool);
+
+    wtmlib_TSCProbeThreadArg_t *arg = (wtmlib_TSCProbeThreadArg_t*)thread_arg;
+    wtmlib_TSCProbeThreadPool_t *pool = arg->pool;
+    uint64_t last_round = 0;
+    bool is_shutdown = false, is_active = false;
+    int ret = wtmlib_BindThreadToCPU( arg->cpu_set, arg->num_cpus, arg->err_msg,
+                                      sizeof( arg->err_msg));
+
+    /* Report the result of binding. The pool waits for all the threads to report before
+       starting the first round */
+    pthread_mutex_lock( &pool->mutex);
+    arg->ret = ret;
+    pool->num_done++;
+
+    if ( ret ) pool->num_exited++;
+
+    pthread_cond_broadcast( &pool->round_done);
+    pthread_mutex_unlock( &pool->mutex);
+
+    if ( ret ) return (void*)(long int)ret;
+
+    while ( true )
+    {
+        pthread_mutex_lock( &pool->mutex);
+        pthread_cleanup_push( wtmlib_UnlockMutex, &pool->mutex);
+
+        while ( pool->round == last_round && !pool->is_shutdown )
+        {
+            pthread_cond_wait( &pool->round_start, &pool->mutex);
+        }
+
+        last_round = pool->round;
+        is_shutdown = pool->is_shutdown;
+        is_active = arg->is_active;
+
+        /* Let the pool know that the thread is about to exit. After that the thread
+           can be safely joined without a timeout */
+        if ( is_shutdown )
+        {
+            pool->num_exited++;
+            pthread_cond_broadcast( &pool->round_done);
+        }
+
+        pthread_cleanup_pop( 1);
+
+        if ( is_shutdown ) break;
+
+        if ( !is_active ) continue;
+
+        pthread_setcanceltype( PTHREAD_CANCEL_ASYNCHRONOUS, 0);
+        wtmlib_CollectTSCProbes( arg);
+        pthread_setcanceltype( PTHREAD_CANCEL_DEFERRED, 0);
+        pthread_mutex_lock( &pool->mutex);
+        pool->num_done++;
+        pthread_cond_broadcast( &pool->round_done);
+        pthread_mutex_unlock( &pool->mutex);
+    }
+
     return 0;
 }
 
@@ -1620,187 +1892,448 @@ print_tsc_probe_sequence_out:
 #endif
 
 /**
- * Collect TSC probes
+ * Shut down a pool of TSC probe threads and release its resources
  *
- *   - probes_count probes is collected on each available CPU
- *   - the probes are collected by concurrently running threads (1 thread per each
- *     available CPU)
- *   - the probes are sequentially ordered. The order is ensured by means of compare-and-
- *     swap operation
+ * If the pool is "broken" (i.e. some round of probing timed out) or the threads don't
+ * acknowledge the shutdown in time, the threads are cancelled. If some threads cannot be
+ * joined, the memory shared with them is intentionally leaked (the threads may still
+ * access it)
  */
-static int wtmlib_CollectCASOrderedTSCProbes( int num_threads,
-                                              cpu_set_t **cpu_sets,
-                                              int num_cpus,
-                                              wtmlib_TSCProbe_t **tsc_probes,
-                                              uint64_t probes_count,
-                                              char *err_msg,
-                                              int err_msg_size)
+static int wtmlib_DestroyTSCProbeThreadPool( wtmlib_TSCProbeThreadPool_t *pool,
+                                             char *err_msg,
+                                             int err_msg_size)
 {
-    wtmlib_TSCProbeThreadArg_t *thread_args = 0;
-    pthread_t *thread_descs = 0;
-    int ret = 0;
-    uint64_t seq_counter = 0;
-    int ready_counter = 0;
-    /* The number of threads that were actually started */
-    int num_started = num_threads;
-    /* Number of times that thread cancellation failed */
-    int cancel_fails = false;
     char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
-    char create_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
-    char cancel_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
-
-    WTMLIB_ASSERT( num_threads && cpu_sets && tsc_probes);
-
-    /* We're going to assign a global sequence number to each TSC probe. The number is
-       of uint64_t type. Hence, the total number of probes cannot exceed UINT64_MAX */
-    if ( UINT64_MAX / num_threads < probes_count )
-    {
-        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "The number of probes per thread must "
-                         "not be bigger than %lu (%lu requested)",
-                         UINT64_MAX / num_threads, probes_count);
-
-        return WTMLIB_RET_GENERIC_ERR;
-    }
+    int ret = 0;
 
-    ret = wtmlib_AllocMemForTSCProbeThreads( num_threads, &thread_args, &thread_descs,
-                                             local_err_msg, sizeof( local_err_msg));
+    if ( !pool ) return 0;
 
-    if ( ret )
+    if ( pool->num_started && !pool->is_broken )
     {
-        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while allocating memory for "
-                         "TSC probe threads");
+        pthread_mutex_lock( &pool->mutex);
+        pool->is_shutdown = true;
+        pthread_cond_broadcast( &pool->round_start);
 
-        goto make_cas_ordered_tsc_probes_out;
-    }
+        /* Wait for the threads to acknowledge the shutdown */
+        struct timespec deadline = {.tv_sec = 0, .tv_nsec = 0};
 
-    /* Initialize thread arguments and start threads */
-    for ( int i = 0; i < num_threads; i++ )
-    {
-        thread_args[i].cpu_set = cpu_sets[i];
-        thread_args[i].num_cpus = num_cpus;
-        thread_args[i].tsc_probes = tsc_probes[i];
-        thread_args[i].probes_count = probes_count;
-        thread_args[i].seq_counter = &seq_counter;
-        thread_args[i].ready_counter = &ready_counter;
-        thread_args[i].num_threads = num_threads;
-        thread_args[i].err_msg[0] = '\0';
-        ret = pthread_create( &thread_descs[i], 0, wtmlib_TSCProbeThread,
-                              &thread_args[i]);
+        clock_gettime( CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += WTMLIB_TSC_PROBE_WAIT_AFTER_CANCEL;
 
-        if ( ret )
+        while ( pool->num_exited < pool->num_started )
         {
-            num_started = i;
-            
-            break;
+            if ( pthread_cond_timedwait( &pool->round_done, &pool->mutex, &deadline) ==
+                 ETIMEDOUT )
+            {
+                pool->is_broken = pool->num_exited < pool->num_started;
+
+                break;
+            }
         }
-    }
 
-    if ( num_started != num_threads )
-    {
-        WTMLIB_ASSERT( num_started < num_threads);
+        pthread_mutex_unlock( &pool->mutex);
 
-        /* Cancel threads that were started. If we don't do that, they will hang
-           forever waiting for the target value of the "ready counter" */
-        for ( int i = 0; i < num_started; num_started++ )
+        if ( !pool->is_broken )
         {
-            if ( pthread_cancel( thread_descs[i]) ) cancel_fails++;
+            /* All the threads are exiting. Joining them takes no time */
+            for ( int i = 0; i < pool->num_started; i++ )
+            {
+                pthread_join( pool->thread_descs[i], 0);
+            }
         }
     }
 
-    ret = wtmlib_WaitForTSCProbeThreads( thread_descs, num_started,
-                                         num_started != num_threads, local_err_msg,
-                                         sizeof( local_err_msg));
-
-    if ( num_started != num_threads )
+    if ( pool->num_started && pool->is_broken )
     {
-        snprintf( create_err_msg, sizeof( create_err_msg), "Couldn't start all "
-                  "TSC probe threads; only %d were started", num_started);
-
-        if ( cancel_fails )
-        {
-            snprintf( cancel_err_msg, sizeof( cancel_err_msg), "Cancel request "
-                      "failed for %d started threads", cancel_fails);
-        } else
+        for ( int i = 0; i < pool->num_started; i++ )
         {
-            snprintf( cancel_err_msg, sizeof( cancel_err_msg), "Cancel request "
-                      "successfully submitted to all started threads");
+            pthread_cancel( pool->thread_descs[i]);
         }
 
+        ret = wtmlib_WaitForTSCProbeThreads( pool->thread_descs, pool->num_started,
+                                             true, local_err_msg,
+                                             sizeof( local_err_msg));
+
         if ( ret )
         {
-            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "%s; %s; The following error occured "
-                             "while joining started threads: %s", create_err_msg,
-                             cancel_err_msg, local_err_msg);
-        } else
-        {
-            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "%s; %s; All started threads "
-                             "successfully joined", create_err_msg, cancel_err_msg);
-        }
-        
-        ret = WTMLIB_RET_GENERIC_ERR;
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while joining TSC probe "
+                             "threads: %s", local_err_msg);
 
-        goto make_cas_ordered_tsc_probes_out;
+            return ret;
+        }
     }
 
-#ifdef WTMLIB_LOG
-    for ( int i = 0; i < num_threads; i++ )
+    pthread_cond_destroy( &pool->round_start);
+    pthread_cond_destroy( &pool->round_done);
+    pthread_mutex_destroy( &pool->mutex);
+    wtmlib_DeallocMemForTSCProbeThreads( pool->thread_args, pool->thread_descs);
+
+    if ( pool->cpu_sets )
     {
-        if ( strcmp( thread_args[i].err_msg, "\0") )
+        for ( int i = 0; i < pool->num_threads; i++ )
         {
-            WTMLIB_OUT( "\t\t\tThread %d returned error message: %s\n", i,
-                        thread_args[i].err_msg);
+            if ( pool->cpu_sets[i] ) CPU_FREE( pool->cpu_sets[i]);
         }
+
+        free( pool->cpu_sets);
     }
-#endif
 
-    if ( ret )
-    {
-        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error encountered while joining "
-                         "TSC probe threads: %s", local_err_msg);
+    if ( pool->cpu_ids ) free( pool->cpu_ids);
 
-        goto make_cas_ordered_tsc_probes_out;
-    }
+    if ( pool->counters ) free( pool->counters);
 
-make_cas_ordered_tsc_probes_out:
-    wtmlib_DeallocMemForTSCProbeThreads( thread_args, thread_descs);
+    free( pool);
 
-    return ret;
+    return 0;
 }
 
 /**
- * Allocate memory required to collect CAS-ordered TSC probes
+ * Wait until "num_to_wait" threads report completion of the current round. The pool's
+ * mutex must be held by the caller
+ *
+ * Returns "zero" if the threads reported in time, and non-zero otherwise
  */
-static int wtmlib_AllocMemForCASOrderedProbes( int cline_size,
-                                               int num_cpus,
-                                               int num_cpu_sets,
-                                               int num_probes,
-                                               cpu_set_t ***cpu_sets_ret,
-                                               wtmlib_TSCProbe_t ***tsc_probes_ret,
-                                               char *err_msg,
-                                               int err_msg_size)
+static int wtmlib_WaitForTSCProbePoolRound( wtmlib_TSCProbeThreadPool_t *pool,
+                                            int num_to_wait)
 {
-    return wtmlib_AllocMemForTSCSampling( cline_size, num_cpus, num_cpu_sets,
-                                          num_probes, sizeof( wtmlib_TSCProbe_t),
-                                          cpu_sets_ret, (void***)tsc_probes_ret,
-                                          err_msg, err_msg_size);
+    WTMLIB_ASSERT( pool);
+
+    struct timespec deadline = {.tv_sec = 0, .tv_nsec = 0};
+
+    clock_gettime( CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += WTMLIB_TSC_PROBE_WAIT_TIME;
+
+    while ( pool->num_done < num_to_wait )
+    {
+        if ( pthread_cond_timedwait( &pool->round_done, &pool->mutex, &deadline) ==
+             ETIMEDOUT )
+        {
+            return pool->num_done < num_to_wait;
+        }
+    }
+
+    return 0;
 }
 
 /**
- * Deallocate memory allocated previously by "wtmlib_AllocMemForCASOrderedProbes()"
- * routine
+ * Start a pool of TSC probe threads. One thread is started for each CPU allowed by
+ * "cpu_constraint". Each thread is bound to its CPU
+ *
+ * Creating a thread and binding it to a CPU is much more expensive than collecting
+ * TSC probes for a single pair of CPUs. So, the threads are created only once and then
+ * re-used for all rounds of CAS-ordered probing.
+ *
+ * The pool must be destroyed after use by means of calling
+ * "wtmlib_DestroyTSCProbeThreadPool()"
  */
-static void wtmlib_DeallocMemForCASOrderedProbes( int num_cpu_sets,
-                                                  cpu_set_t **cpu_sets,
-                                                  wtmlib_TSCProbe_t **tsc_probes)
+static int wtmlib_CreateTSCProbeThreadPool( int num_cpus,
+                                            const cpu_set_t* const cpu_constraint,
+                                            int cline_size,
+                                            wtmlib_TSCProbeThreadPool_t **pool_ret,
+                                            char *err_msg,
+                                            int err_msg_size)
 {
-    wtmlib_DeallocMemForTSCSampling( num_cpu_sets, cpu_sets, (void**)tsc_probes);
+    WTMLIB_ASSERT( cpu_constraint && pool_ret);
 
-    return;
-}
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    int cpu_set_size = CPU_ALLOC_SIZE( num_cpus);
+    int num_threads = CPU_COUNT_S( cpu_set_size, cpu_constraint);
+    pthread_condattr_t cond_attr;
+    int ret = 0;
+    wtmlib_TSCProbeThreadPool_t *pool =
+        (wtmlib_TSCProbeThreadPool_t*)calloc( sizeof( wtmlib_TSCProbeThreadPool_t), 1);
 
-/**
- * Generic evaluation of consistency of TSC probes
- */
+    if ( !pool )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory for a pool "
+                         "of TSC probe threads");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    pthread_mutex_init( &pool->mutex, 0);
+    /* Timeouts are measured using monotonic clock */
+    pthread_condattr_init( &cond_attr);
+    pthread_condattr_setclock( &cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init( &pool->round_start, 0);
+    pthread_cond_init( &pool->round_done, &cond_attr);
+    pthread_condattr_destroy( &cond_attr);
+    pool->num_threads = num_threads;
+    pool->num_cpus = num_cpus;
+    pool->cline_size = cline_size;
+    pool->cpu_ids = (int*)calloc( sizeof( int), num_threads);
+    pool->cpu_sets = (cpu_set_t**)calloc( sizeof( cpu_set_t*), num_threads);
+    /* Counters used to order TSC probes are modified concurrently by the threads. Each
+       group of threads that collect probes simultaneously gets its own cache line. At
+       most "num_threads" groups can exist */
+    pool->counters = (char*)aligned_alloc( cline_size, cline_size * num_threads);
+
+    if ( !pool->cpu_ids || !pool->cpu_sets || !pool->counters )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory for a pool "
+                         "of TSC probe threads");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto create_tsc_probe_thread_pool_out;
+    }
+
+    ret = wtmlib_AllocMemForTSCProbeThreads( num_threads, &pool->thread_args,
+                                             &pool->thread_descs, local_err_msg,
+                                             sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while allocating memory for "
+                         "TSC probe threads: %s", local_err_msg);
+
+        goto create_tsc_probe_thread_pool_out;
+    }
+
+    for ( int cpu_id = 0, ind = 0; cpu_id < num_cpus; cpu_id++ )
+    {
+        if ( !CPU_ISSET_S( cpu_id, cpu_set_size, cpu_constraint) ) continue;
+
+        WTMLIB_ASSERT( ind < num_threads);
+        pool->cpu_ids[ind] = cpu_id;
+        pool->cpu_sets[ind] = CPU_ALLOC( num_cpus);
+
+        if ( !pool->cpu_sets[ind] )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory for a "
+                             "CPU set");
+            ret = WTMLIB_RET_GENERIC_ERR;
+
+            goto create_tsc_probe_thread_pool_out;
+        }
+
+        CPU_ZERO_S( cpu_set_size, pool->cpu_sets[ind]);
+        CPU_SET_S( cpu_id, cpu_set_size, pool->cpu_sets[ind]);
+        pool->thread_args[ind].cpu_set = pool->cpu_sets[ind];
+        pool->thread_args[ind].num_cpus = num_cpus;
+        pool->thread_args[ind].pool = pool;
+        ind++;
+    }
+
+    /* Start threads */
+    for ( int i = 0; i < num_threads; i++ )
+    {
+        if ( pthread_create( &pool->thread_descs[i], 0, wtmlib_TSCProbeThread,
+                             &pool->thread_args[i]) )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't start all TSC probe "
+                             "threads; only %d were started", i);
+            ret = WTMLIB_RET_GENERIC_ERR;
+
+            goto create_tsc_probe_thread_pool_out;
+        }
+
+        pool->num_started++;
+    }
+
+    /* Wait until all the threads bind themselves to their CPUs */
+    pthread_mutex_lock( &pool->mutex);
+    pool->is_broken = wtmlib_WaitForTSCProbePoolRound( pool, num_threads);
+    pthread_mutex_unlock( &pool->mutex);
+
+    if ( pool->is_broken )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "TSC probe threads didn't start in "
+                         "time");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto create_tsc_probe_thread_pool_out;
+    }
+
+    for ( int i = 0; i < num_threads; i++ )
+    {
+        if ( !pool->thread_args[i].ret ) continue;
+
+        /* The thread's message is bounded, so that it fits together with the prefix */
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "TSC probe thread for CPU %d failed to "
+                         "start: %.*s", pool->cpu_ids[i], WTMLIB_MAX_ERR_MSG_SIZE / 2,
+                         pool->thread_args[i].err_msg);
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto create_tsc_probe_thread_pool_out;
+    }
+
+create_tsc_probe_thread_pool_out:
+    if ( ret )
+    {
+        wtmlib_DestroyTSCProbeThreadPool( pool, 0, 0);
+    } else
+    {
+        *pool_ret = pool;
+    }
+
+    return ret;
+}
+
+/**
+ * Get index of a thread (in a pool of TSC probe threads) that is bound to the specified
+ * CPU. "-1" is returned if there is no such thread
+ */
+static int wtmlib_GetTSCProbeThreadIndex( wtmlib_TSCProbeThreadPool_t *pool, int cpu_id)
+{
+    WTMLIB_ASSERT( pool);
+
+    for ( int i = 0; i < pool->num_threads; i++ )
+    {
+        if ( pool->cpu_ids[i] == cpu_id ) return i;
+    }
+
+    return -1;
+}
+
+/**
+ * Collect TSC probes
+ *
+ *   - the probes are collected by a number of groups of threads taken from a pool of
+ *     TSC probe threads. Threads within a group run concurrently. Different groups
+ *     also run concurrently but independently of each other
+ *   - group "g" consists of "group_sizes[g]" threads. Indexes of the threads (in the
+ *     pool) are stored successively in "thread_inds". The first "group_sizes[0]" indexes
+ *     belong to group 0, the next "group_sizes[1]" indexes belong to group 1, and so on.
+ *     tsc_probes[i] receives probes collected by thread thread_inds[i]
+ *   - probes_count probes is collected by each thread
+ *   - the probes collected by a group are sequentially ordered. The order is ensured by
+ *     means of compare-and-swap operation
+ */
+static int wtmlib_CollectCASOrderedTSCProbesInGroups( wtmlib_TSCProbeThreadPool_t *pool,
+                                                      int num_groups,
+                                                      const int *group_sizes,
+                                                      const int *thread_inds,
+                                                      wtmlib_TSCProbe_t **tsc_probes,
+                                                      uint64_t probes_count,
+                                                      char *err_msg,
+                                                      int err_msg_size)
+{
+    WTMLIB_ASSERT( pool && group_sizes && thread_inds && tsc_probes);
+    WTMLIB_ASSERT( num_groups > 0 && num_groups <= pool->num_threads);
+
+    int num_active = 0;
+
+    if ( pool->is_broken )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "The pool of TSC probe threads is "
+                         "not usable after a previous failure");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    /* We're going to assign a global sequence number to each TSC probe. The number is
+       of uint64_t type. Hence, the total number of probes cannot exceed UINT64_MAX */
+    if ( UINT64_MAX / pool->num_threads < probes_count )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "The number of probes per thread must "
+                         "not be bigger than %lu (%lu requested)",
+                         UINT64_MAX / pool->num_threads, probes_count);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    pthread_mutex_lock( &pool->mutex);
+
+    for ( int i = 0; i < pool->num_threads; i++ ) pool->thread_args[i].is_active = false;
+
+    for ( int g = 0; g < num_groups; g++ )
+    {
+        char *group_counters = pool->counters + g * pool->cline_size;
+        uint64_t *seq_counter = (uint64_t*)group_counters;
+        int *ready_counter = (int*)(group_counters + sizeof( uint64_t));
+
+        *seq_counter = 0;
+        *ready_counter = 0;
+
+        for ( int j = 0; j < group_sizes[g]; j++, num_active++ )
+        {
+            wtmlib_TSCProbeThreadArg_t *arg = &pool->thread_args[thread_inds[num_active]];
+
+            WTMLIB_ASSERT( thread_inds[num_active] < pool->num_threads);
+            WTMLIB_ASSERT( !arg->is_active);
+            arg->is_active = true;
+            arg->tsc_probes = tsc_probes[num_active];
+            arg->probes_count = probes_count;
+            arg->seq_counter = seq_counter;
+            arg->ready_counter = ready_counter;
+            arg->num_threads = group_sizes[g];
+            arg->err_msg[0] = '\0';
+        }
+    }
+
+    pool->num_done = 0;
+    pool->round++;
+    pthread_cond_broadcast( &pool->round_start);
+    pool->is_broken = wtmlib_WaitForTSCProbePoolRound( pool, num_active);
+    pthread_mutex_unlock( &pool->mutex);
+
+    if ( pool->is_broken )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "TSC probe threads didn't complete "
+                         "collecting probes in time");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    return 0;
+}
+
+/**
+ * Collect TSC probes
+ *
+ *   - probes_count probes is collected by each of the specified threads taken from a
+ *     pool of TSC probe threads. tsc_probes[i] receives probes collected by thread
+ *     thread_inds[i]
+ *   - the probes are collected by concurrently running threads
+ *   - the probes are sequentially ordered. The order is ensured by means of compare-and-
+ *     swap operation
+ */
+static int wtmlib_CollectCASOrderedTSCProbes( wtmlib_TSCProbeThreadPool_t *pool,
+                                              int num_threads,
+                                              const int *thread_inds,
+                                              wtmlib_TSCProbe_t **tsc_probes,
+                                              uint64_t probes_count,
+                                              char *err_msg,
+                                              int err_msg_size)
+{
+    return wtmlib_CollectCASOrderedTSCProbesInGroups( pool, 1, &num_threads, thread_inds,
+                                                      tsc_probes, probes_count, err_msg,
+                                                      err_msg_size);
+}
+
+/**
+ * Allocate memory required to collect CAS-ordered TSC probes
+ *
+ * CPU sets are not allocated. Probe threads are bound to their CPUs by the thread pool
+ */
+static int wtmlib_AllocMemForCASOrderedProbes( int cline_size,
+                                               int num_probe_sets,
+                                               int num_probes,
+                                               wtmlib_TSCProbe_t ***tsc_probes_ret,
+                                               char *err_msg,
+                                               int err_msg_size)
+{
+    return wtmlib_AllocMemForTSCSampling( cline_size, 0, num_probe_sets, num_probes,
+                                          sizeof( wtmlib_TSCProbe_t), 0,
+                                          (void***)tsc_probes_ret, err_msg,
+                                          err_msg_size);
+}
+
+/**
+ * Deallocate memory allocated previously by "wtmlib_AllocMemForCASOrderedProbes()"
+ * routine
+ */
+static void wtmlib_DeallocMemForCASOrderedProbes( int num_probe_sets,
+                                                  wtmlib_TSCProbe_t **tsc_probes)
+{
+    wtmlib_DeallocMemForTSCSampling( num_probe_sets, 0, (void**)tsc_probes);
+
+    return;
+}
+
+/**
+ * Generic evaluation of consistency of TSC probes
+ */
 static int wtmlib_CheckTSCProbesConsistency( wtmlib_TSCProbe_t **tsc_probes,
                                              int num_avail_cpus,
                                              uint64_t num_probes,
@@ -2064,31 +2597,41 @@ static int wtmlib_CalcTSCDeltaRangeCOP( wtmlib_TSCProbe_t **tsc_probes,
  *
  * When "enclosing TSC range" is found, its size is calculated as a difference
  * between its upper and lower bounds
+ *
+ * Optionally, bounds of the shift between each CPU's TSC and TSC of the base CPU are
+ * returned via "cpu_delta_min" and "cpu_delta_max" arrays (indexed by CPU IDs; entries
+ * of the CPUs not allowed by "cpu_constraint" and of the base CPU are not modified)
  */
 static int wtmlib_CalcTSCEnclosingRangeCOP( int num_cpus,
                                             int base_cpu,
                                             const cpu_set_t* const cpu_constraint,
                                             int cline_size,
+                                            wtmlib_TSCProbeThreadPool_t *pool,
                                             int64_t *range_size,
+                                            int64_t *cpu_delta_min,
+                                            int64_t *cpu_delta_max,
                                             char *err_msg,
                                             int err_msg_size)
 {
-    WTMLIB_ASSERT( cpu_constraint);
+    WTMLIB_ASSERT( cpu_constraint && pool);
 
     char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
-    cpu_set_t **cpu_sets = 0;
     wtmlib_TSCProbe_t **tsc_probes = 0;
     int cpu_set_size = CPU_ALLOC_SIZE( num_cpus);
     int64_t delta_min = INT64_MAX, delta_max = INT64_MIN;
     int64_t l_bound = INT64_MAX, u_bound = INT64_MIN;
+    /* Indexes of the probe threads bound to the base CPU and to the other CPU */
+    int thread_inds[2] = {wtmlib_GetTSCProbeThreadIndex( pool, base_cpu), -1};
     int ret = 0;
 
+    WTMLIB_ASSERT( thread_inds[0] >= 0);
+
     WTMLIB_OUT( "\tCalculating an upper bound for shifts between TSC counters running "
                 "on different CPUs...\n");
     WTMLIB_OUT( "\t\tBase CPU ID: %d\n", base_cpu);
-    ret = wtmlib_AllocMemForCASOrderedProbes( cline_size, num_cpus, 2,
+    ret = wtmlib_AllocMemForCASOrderedProbes( cline_size, 2,
                                               WTMLIB_CALC_TSC_RANGE_PROBES_COUNT,
-                                              &cpu_sets, &tsc_probes, local_err_msg,
+                                              &tsc_probes, local_err_msg,
                                               sizeof( local_err_msg));
 
     if ( ret )
@@ -2099,10 +2642,6 @@ static int wtmlib_CalcTSCEnclosingRangeCOP( int num_cpus,
         goto calc_tsc_enclosing_range_cop_out;
     }
 
-    CPU_ZERO_S( cpu_set_size, cpu_sets[0]);
-    CPU_SET_S( base_cpu, cpu_set_size, cpu_sets[0]);
-    CPU_ZERO_S( cpu_set_size, cpu_sets[1]);
-
     for ( int cpu_id = 0; cpu_id < num_cpus; cpu_id++ )
     {
         if ( !CPU_ISSET_S( cpu_id, cpu_set_size, cpu_constraint) || cpu_id == base_cpu )
@@ -2110,10 +2649,11 @@ static int wtmlib_CalcTSCEnclosingRangeCOP( int num_cpus,
             continue;
         }
 
-        CPU_SET_S( cpu_id, cpu_set_size, cpu_sets[1]);
+        thread_inds[1] = wtmlib_GetTSCProbeThreadIndex( pool, cpu_id);
+        WTMLIB_ASSERT( thread_inds[1] >= 0);
         WTMLIB_OUT( "\n\t\tCollecting TSC probes on CPUs %d and %d...\n", base_cpu,
                     cpu_id);
-        ret = wtmlib_CollectCASOrderedTSCProbes( 2, cpu_sets, num_cpus, tsc_probes,
+        ret = wtmlib_CollectCASOrderedTSCProbes( pool, 2, thread_inds, tsc_probes,
                                                  WTMLIB_CALC_TSC_RANGE_PROBES_COUNT,
                                                  local_err_msg, sizeof( local_err_msg));
 
@@ -2149,8 +2689,10 @@ static int wtmlib_CalcTSCEnclosingRangeCOP( int num_cpus,
         u_bound = u_bound < delta_max ? delta_max : u_bound;
 
         WTMLIB_ASSERT( delta_max >= delta_min && u_bound >= l_bound);
-        /* Return CPU mask to the "clean" state */
-        CPU_CLR_S( cpu_id, cpu_set_size, cpu_sets[1]);
+
+        if ( cpu_delta_min ) cpu_delta_min[cpu_id] = delta_min;
+
+        if ( cpu_delta_max ) cpu_delta_max[cpu_id] = delta_max;
     }
 
     WTMLIB_OUT( "\n\t\tShift between TSC on any of the available CPUs and TSC on the "
@@ -2160,109 +2702,355 @@ static int wtmlib_CalcTSCEnclosingRangeCOP( int num_cpus,
     if ( range_size ) *range_size = u_bound - l_bound;
 
 calc_tsc_enclosing_range_cop_out:
-    wtmlib_DeallocMemForCASOrderedProbes( 2, cpu_sets, tsc_probes);
+    wtmlib_DeallocMemForCASOrderedProbes( 2, tsc_probes);
 
     return ret;
 }
 
 /**
- * Check whether TSC values monotonically increase along an ordered sequence of TSC
- * probes
+ * Calculate size of enclosing TSC range (using a sequence of CAS-ordered probes), taking
+ * measurements on many disjoint pairs of CPUs concurrently
  *
- * Monotonicity is evaluated in a straightforward way:
- *   - TSC probes have sequence numbers that reflect an order in which the probes were
- *     collected
- *   - the function traverses the probes in order of increasing sequence numbers and
- *     examines whether TSC values also increase
+ * "wtmlib_CalcTSCEnclosingRangeCOP()" compares each CPU with the base CPU, one pair at
+ * a time. Thus, it needs as many rounds of probing as there are CPUs. Here the pairs
+ * are scheduled according to a binomial tree rooted at the base CPU:
+ *   1) the available CPUs are enumerated so that the base CPU gets index 0. Other CPUs
+ *      are grouped by physical packages (sockets). CPUs of the base CPU's package come
+ *      first
+ *   2) during round "k" (k = 0, 1, 2, ...) CPU with index "i" is paired with CPU with
+ *      index "i + 2^k" for every "i < 2^k". Pairs of the same round are disjoint and
+ *      are probed concurrently. Thus, ceil(log2(N)) rounds are needed for N CPUs
+ *   3) in this schedule each CPU (except the base one) is paired exactly once with its
+ *      "parent" - a CPU whose index is obtained by clearing the highest set bit of the
+ *      CPU's index. The parent is always probed in an earlier round. Hence, bounds of
+ *      the shift between TSC of the parent and TSC of the base CPU are already known
+ *      when the CPU is probed
+ *   4) bounds of the shift between TSC of a CPU and TSC of the base CPU are obtained by
+ *      adding bounds of the shift between TSC of the CPU and TSC of its parent to the
+ *      parent's bounds
  *
- * Along with the examination described above the function also assess statistical
- * significance of the result. Let us use graph theory terms to explain how the
- * assessement is made (graph terminology is not important here; it just makes the
- * explanation simpler):
- *   - assume a graph such that allowed CPUs are its vertices. The graph is fully
- *     connected by undirected unweighted edges
- *   - we treat the sequence of TSC probes as a path in this graph. (The sequence of
- *     probes naturally transforms to a sequence of CPUs on which these probes were
- *     collected. And the sequence of CPUs - which is a sequence of vertices of the
- *     graph - represents some path in the graph)
- *   - we introduce the notion of "full loop". "Full loop" is a sub-sequence consisting
- *     of successive (!) points on the path such that:
- *        1) first and last CPUs in the sub-sequence are the same
- *        2) each of the available CPUs can be found at least once in the sub-sequence
- *        3) there is no shorter sub-sequence of successive points that has the same
- *           starting point and satisfies conditions 1) and 2)
- *     In other words, "full loop" is a sub-path of the path such that it starts at
- *     some CPU, passes through all other CPUs (all or some of them may be visited
- *     several times), and returns to the starting CPU (which also might be visited
- *     several times before the finish). And there should be no shorter sub-path with
- *     the same properties which starts at the same starting point.
- *   - positive result of monotonicity evaluation is considered more or less reliable
- *     (or statistically significant) if a "full loop" exists on the path. (If all
- *     available CPUs were visited on the path but no "full loop" exists, the result
- *     cannot be considered reliable. It's easy to understand why).
- *   - the more "full loops" exist the more reliable is the result
- *   - so, to assess statistical significance of monotinicity evaluation we count the
- *     number of "full loops" on the provided CPU path
- *   - there can exist overlapping "full loops" on the path. We don't take them into
- *     account. Taking them into account would complicate the algorithm significantly
- *     while not improving reliability assessment too much. So, we count only "full
- *     loops" that are located on the path strictly one after another
- *   - and we introduce one more simplification. We require that all "full loops" start
- *     with the same CPU (which is actually the first CPU in the TSC probe sequence).
- *     This simplification allows us to build a very simple and fast algorithm. Its
- *     complexity is O(num_probes) and additional memory is O(num_CPUs). But this
- *     algorithm is less precise than algorithm that allows "full loops" to start with
- *     arbitrary CPU. Consider an example. Assume that we have 4 CPUs and the following
- *     path: 3 2 1 3 4 2. There is no "full loop" here that starts with CPU 3. So,
- *     the algorithm implemented here will not find any "full loop" at all. But in the
- *     sequence above there exists a "full loop" that starts with CPU 2.
- *     An algorithm that doesn't impose constraint on the starting CPU can be easily
- *     implemented in a way that is very similar to what is seen in the function below.
- *     The complexity would be O(num_probes * num_CPUs) and additional memory would be
- *     O(num_CPUs ^ 2). But currently the simplified version works well. There is no
- *     need in higher precision. If higher precision will become a requirement, simple
- *     modifications of the below code will allow to have it.
+ * Because of the summation the bounds are somewhat wider than the bounds obtained by
+ * comparing each CPU directly with the base CPU (the path from any CPU to the base CPU
+ * consists of at most ceil(log2(N)) pairs). That's the price of the speed-up
  *
- * The algorithm we use to find "full loops" is the following:
- *   - we iterate over TSC probes from the first to the last
- *   - we have a counter of already found "full loops"
- *   - for each available CPU we have a flag indicating whether this CPU was seen since
- *     we have found the previous "full loop"
- *   - also we a have a variable that tracks the number of different CPUs seen since
- *     the last "full loop" was found
- *   - if this variable becomes equal to the number of available CPUs, and if we
- *     encounter the starting CPU after that, then we conclude that we have one more
- *     "full loop"
+ * Per-CPU bounds are optionally returned in the same way as by
+ * "wtmlib_CalcTSCEnclosingRangeCOP()"
  */
-static int wtmlib_IsProbeSequenceMonotonic( wtmlib_TSCProbe_t **tsc_probes,
-                                            uint64_t probes_num,
-                                            int num_avail_cpus,
-                                            bool *is_monotonic_ret,
-                                            char *err_msg,
-                                            int err_msg_size)
+static int wtmlib_CalcTSCEnclosingRangeCOPConcurrent( int num_cpus,
+                                                      int base_cpu,
+                                                      const cpu_set_t* const
+                                                          cpu_constraint,
+                                                      int cline_size,
+                                                      wtmlib_TSCProbeThreadPool_t *pool,
+                                                      int64_t *range_size,
+                                                      int64_t *cpu_delta_min,
+                                                      int64_t *cpu_delta_max,
+                                                      char *err_msg,
+                                                      int err_msg_size)
 {
-    WTMLIB_ASSERT( tsc_probes);
+    WTMLIB_ASSERT( cpu_constraint && pool);
 
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    wtmlib_TSCProbe_t **tsc_probes = 0;
+    int cpu_set_size = CPU_ALLOC_SIZE( num_cpus);
+    int num_cpus_avail = CPU_COUNT_S( cpu_set_size, cpu_constraint);
+    int base_package = wtmlib_GetCPUPackageID( base_cpu);
+    int64_t l_bound = INT64_MAX, u_bound = INT64_MIN;
+    /* cpu_ids[i] - ID of a CPU with index "i" */
+    int *cpu_ids = 0;
+    int *package_ids = 0;
+    /* Bounds of shifts between TSC of CPU with index "i" and TSC of the base CPU */
+    int64_t *delta_min = 0, *delta_max = 0;
+    /* Description of groups of threads that collect probes concurrently */
+    int *group_sizes = 0, *thread_inds = 0;
     int ret = 0;
-    uint64_t prev_tsc_val = 0;
-    bool is_monotonic = true;
-    /* Index of the first CPU in the TSC probes sequence */
-    int first_cpu_ind = -1;
-    /* Number of "full loops" there were already found */
-    uint64_t num_loops = 0;
-    /* Number of different CPUs seen while trying to find a new "full loop" */
-    int cpus_seen = 0;
-    /* indexes[cpu_ind] stores current index to an array of TSC probes collected on a CPU
-       that has index "cpu_ind" */
-    uint64_t *indexes = 0;
 
-    WTMLIB_OUT( "\t\tTesting monotonicity of the TSC probes sequence...\n");
-
-    if ( wtmlib_CheckTSCProbesConsistency( tsc_probes, num_avail_cpus, probes_num,
-                                           err_msg, err_msg_size) )
+    WTMLIB_OUT( "\tCalculating an upper bound for shifts between TSC counters running "
+                "on different CPUs (disjoint pairs of CPUs are probed "
+                "concurrently)...\n");
+    WTMLIB_OUT( "\t\tBase CPU ID: %d\n", base_cpu);
+    cpu_ids = (int*)calloc( sizeof( int), num_cpus_avail);
+    package_ids = (int*)calloc( sizeof( int), num_cpus_avail);
+    delta_min = (int64_t*)calloc( sizeof( int64_t), num_cpus_avail);
+    delta_max = (int64_t*)calloc( sizeof( int64_t), num_cpus_avail);
+    group_sizes = (int*)calloc( sizeof( int), num_cpus_avail);
+    thread_inds = (int*)calloc( sizeof( int), num_cpus_avail);
+
+    if ( !cpu_ids || !package_ids || !delta_min || !delta_max || !group_sizes
+         || !thread_inds )
     {
-        return WTMLIB_RET_TSC_INCONSISTENCY;
-    }
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory to schedule "
+                         "pairs of CPUs");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto calc_tsc_enclosing_range_cop_concurrent_out;
+    }
+
+    /* Each thread participates in at most one pair during a round. Hence, each thread
+       needs just one array of probes */
+    ret = wtmlib_AllocMemForCASOrderedProbes( cline_size, num_cpus_avail,
+                                              WTMLIB_CALC_TSC_RANGE_PROBES_COUNT,
+                                              &tsc_probes, local_err_msg,
+                                              sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory for CAS-"
+                         "ordered probes: %s", local_err_msg);
+
+        goto calc_tsc_enclosing_range_cop_concurrent_out;
+    }
+
+    /* Enumerate CPUs. The base CPU gets index "zero". Other CPUs are sorted by package
+       IDs (the base CPU's package goes first) and then by CPU IDs (insertion sort is
+       good enough here) */
+    cpu_ids[0] = base_cpu;
+    package_ids[0] = base_package;
+
+    for ( int cpu_id = 0, ind = 1; cpu_id < num_cpus; cpu_id++ )
+    {
+        if ( !CPU_ISSET_S( cpu_id, cpu_set_size, cpu_constraint) || cpu_id == base_cpu )
+        {
+            continue;
+        }
+
+        int package_id = wtmlib_GetCPUPackageID( cpu_id);
+        int pos = ind;
+
+        for ( ; pos > 1; pos-- )
+        {
+            bool is_prev_base = package_ids[pos - 1] == base_package;
+            bool is_base = package_id == base_package;
+
+            if ( is_prev_base && !is_base ) break;
+
+            if ( is_prev_base == is_base && package_ids[pos - 1] <= package_id ) break;
+
+            cpu_ids[pos] = cpu_ids[pos - 1];
+            package_ids[pos] = package_ids[pos - 1];
+        }
+
+        cpu_ids[pos] = cpu_id;
+        package_ids[pos] = package_id;
+        ind++;
+    }
+
+    for ( int i = 0; i < num_cpus_avail; i++ )
+    {
+        WTMLIB_OUT( "\t\tCPU ID %d maps to CPU index %d (package ID: %d)\n", cpu_ids[i],
+                    i, package_ids[i]);
+    }
+
+    delta_min[0] = delta_max[0] = 0;
+
+    for ( int step = 1; step < num_cpus_avail; step *= 2 )
+    {
+        int num_pairs = 0;
+
+        for ( int i = 0; i < step && i + step < num_cpus_avail; i++, num_pairs++ )
+        {
+            group_sizes[num_pairs] = 2;
+            thread_inds[2 * num_pairs] = wtmlib_GetTSCProbeThreadIndex( pool, cpu_ids[i]);
+            thread_inds[2 * num_pairs + 1] = wtmlib_GetTSCProbeThreadIndex( pool,
+                                                 cpu_ids[i + step]);
+            WTMLIB_ASSERT( thread_inds[2 * num_pairs] >= 0
+                           && thread_inds[2 * num_pairs + 1] >= 0);
+        }
+
+        WTMLIB_OUT( "\n\t\tCollecting TSC probes on %d pairs of CPUs concurrently "
+                    "(CPU index distance: %d)...\n", num_pairs, step);
+        ret = wtmlib_CollectCASOrderedTSCProbesInGroups(
+                  pool, num_pairs, group_sizes, thread_inds, tsc_probes,
+                  WTMLIB_CALC_TSC_RANGE_PROBES_COUNT, local_err_msg,
+                  sizeof( local_err_msg));
+
+        if ( ret )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while collecting CAS-ordered "
+                             "TSC probes: %s", local_err_msg);
+
+            goto calc_tsc_enclosing_range_cop_concurrent_out;
+        }
+
+        for ( int i = 0; i < num_pairs; i++ )
+        {
+            int64_t pair_min = 0, pair_max = 0;
+            int64_t new_min = 0, new_max = 0;
+
+            WTMLIB_OUT( "\n\t\tCPUs %d (parent) and %d:\n", cpu_ids[i],
+                        cpu_ids[i + step]);
+#ifdef WTMLIB_LOG
+            wtmlib_PrintTSCProbeSequence( 2, &tsc_probes[2 * i],
+                                          WTMLIB_CALC_TSC_RANGE_PROBES_COUNT, "\t\t");
+#endif
+            ret = wtmlib_CalcTSCDeltaRangeCOP( &tsc_probes[2 * i],
+                                               WTMLIB_CALC_TSC_RANGE_PROBES_COUNT,
+                                               &pair_min, &pair_max, local_err_msg,
+                                               sizeof( local_err_msg));
+
+            if ( ret )
+            {
+                WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Calculation of TSC delta range "
+                                 "for CPUs %d and %d failed: %s", cpu_ids[i],
+                                 cpu_ids[i + step], local_err_msg);
+
+                goto calc_tsc_enclosing_range_cop_concurrent_out;
+            }
+
+            if ( __builtin_add_overflow( delta_min[i], pair_min, &new_min)
+                 || __builtin_add_overflow( delta_max[i], pair_max, &new_max) )
+            {
+                WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Got overflow while calculating "
+                                 "shift between TSC on CPU %d and TSC on the base CPU",
+                                 cpu_ids[i + step]);
+                ret = WTMLIB_RET_TSC_INCONSISTENCY;
+
+                goto calc_tsc_enclosing_range_cop_concurrent_out;
+            }
+
+            delta_min[i + step] = new_min;
+            delta_max[i + step] = new_max;
+            WTMLIB_OUT( "\t\t\tShift between TSC on CPU %d and TSC on the base CPU "
+                        "belongs to range: [%ld, %ld]\n", cpu_ids[i + step], new_min,
+                        new_max);
+        }
+    }
+
+    /* Calculate bounds of the enclosing TSC range (the same way as it's done in
+       "wtmlib_CalcTSCEnclosingRangeCOP()") */
+    for ( int i = 1; i < num_cpus_avail; i++ )
+    {
+        l_bound = l_bound > delta_min[i] ? delta_min[i] : l_bound;
+
+        u_bound = u_bound < delta_max[i] ? delta_max[i] : u_bound;
+
+        if ( cpu_delta_min ) cpu_delta_min[cpu_ids[i]] = delta_min[i];
+
+        if ( cpu_delta_max ) cpu_delta_max[cpu_ids[i]] = delta_max[i];
+    }
+
+    WTMLIB_OUT( "\n\t\tShift between TSC on any of the available CPUs and TSC on the "
+                "base CPU belongs to range: [%ld, %ld]\n", l_bound, u_bound);
+    WTMLIB_OUT( "\t\tUpper bound for shifts between TSCs is: %ld\n", u_bound - l_bound);
+
+    if ( range_size ) *range_size = u_bound - l_bound;
+
+calc_tsc_enclosing_range_cop_concurrent_out:
+    wtmlib_DeallocMemForCASOrderedProbes( num_cpus_avail, tsc_probes);
+
+    if ( cpu_ids ) free( cpu_ids);
+
+    if ( package_ids ) free( package_ids);
+
+    if ( delta_min ) free( delta_min);
+
+    if ( delta_max ) free( delta_max);
+
+    if ( group_sizes ) free( group_sizes);
+
+    if ( thread_inds ) free( thread_inds);
+
+    return ret;
+}
+
+/**
+ * Check whether TSC values monotonically increase along an ordered sequence of TSC
+ * probes
+ *
+ * Monotonicity is evaluated in a straightforward way:
+ *   - TSC probes have sequence numbers that reflect an order in which the probes were
+ *     collected
+ *   - the function traverses the probes in order of increasing sequence numbers and
+ *     examines whether TSC values also increase
+ *
+ * Along with the examination described above the function also assess statistical
+ * significance of the result. Let us use graph theory terms to explain how the
+ * assessement is made (graph terminology is not important here; it just makes the
+ * explanation simpler):
+ *   - assume a graph such that allowed CPUs are its vertices. The graph is fully
+ *     connected by undirected unweighted edges
+ *   - we treat the sequence of TSC probes as a path in this graph. (The sequence of
+ *     probes naturally transforms to a sequence of CPUs on which these probes were
+ *     collected. And the sequence of CPUs - which is a sequence of vertices of the
+ *     graph - represents some path in the graph)
+ *   - we introduce the notion of "full loop". "Full loop" is a sub-sequence consisting
+ *     of successive (!) points on the path such that:
+ *        1) first and last CPUs in the sub-sequence are the same
+ *        2) each of the available CPUs can be found at least once in the sub-sequence
+ *        3) there is no shorter sub-sequence of successive points that has the same
+ *           starting point and satisfies conditions 1) and 2)
+ *     In other words, "full loop" is a sub-path of the path such that it starts at
+ *     some CPU, passes through all other CPUs (all or some of them may be visited
+ *     several times), and returns to the starting CPU (which also might be visited
+ *     several times before the finish). And there should be no shorter sub-path with
+ *     the same properties which starts at the same starting point.
+ *   - positive result of monotonicity evaluation is considered more or less reliable
+ *     (or statistically significant) if a "full loop" exists on the path. (If all
+ *     available CPUs were visited on the path but no "full loop" exists, the result
+ *     cannot be considered reliable. It's easy to understand why).
+ *   - the more "full loops" exist the more reliable is the result
+ *   - so, to assess statistical significance of monotinicity evaluation we count the
+ *     number of "full loops" on the provided CPU path
+ *   - there can exist overlapping "full loops" on the path. We don't take them into
+ *     account. Taking them into account would complicate the algorithm significantly
+ *     while not improving reliability assessment too much. So, we count only "full
+ *     loops" that are located on the path strictly one after another
+ *   - and we introduce one more simplification. We require that all "full loops" start
+ *     with the same CPU (which is actually the first CPU in the TSC probe sequence).
+ *     This simplification allows us to build a very simple and fast algorithm. Its
+ *     complexity is O(num_probes) and additional memory is O(num_CPUs). But this
+ *     algorithm is less precise than algorithm that allows "full loops" to start with
+ *     arbitrary CPU. Consider an example. Assume that we have 4 CPUs and the following
+ *     path: 3 2 1 3 4 2. There is no "full loop" here that starts with CPU 3. So,
+ *     the algorithm implemented here will not find any "full loop" at all. But in the
+ *     sequence above there exists a "full loop" that starts with CPU 2.
+ *     An algorithm that doesn't impose constraint on the starting CPU can be easily
+ *     implemented in a way that is very similar to what is seen in the function below.
+ *     The complexity would be O(num_probes * num_CPUs) and additional memory would be
+ *     O(num_CPUs ^ 2). But currently the simplified version works well. There is no
+ *     need in higher precision. If higher precision will become a requirement, simple
+ *     modifications of the below code will allow to have it.
+ *
+ * The algorithm we use to find "full loops" is the following:
+ *   - we iterate over TSC probes from the first to the last
+ *   - we have a counter of already found "full loops"
+ *   - for each available CPU we have a flag indicating whether this CPU was seen since
+ *     we have found the previous "full loop"
+ *   - also we a have a variable that tracks the number of different CPUs seen since
+ *     the last "full loop" was found
+ *   - if this variable becomes equal to the number of available CPUs, and if we
+ *     encounter the starting CPU after that, then we conclude that we have one more
+ *     "full loop"
+ */
+static int wtmlib_IsProbeSequenceMonotonic( wtmlib_TSCProbe_t **tsc_probes,
+                                            uint64_t probes_num,
+                                            int num_avail_cpus,
+                                            bool *is_monotonic_ret,
+                                            char *err_msg,
+                                            int err_msg_size)
+{
+    WTMLIB_ASSERT( tsc_probes);
+
+    int ret = 0;
+    uint64_t prev_tsc_val = 0;
+    bool is_monotonic = true;
+    /* Index of the first CPU in the TSC probes sequence */
+    int first_cpu_ind = -1;
+    /* Number of "full loops" there were already found */
+    uint64_t num_loops = 0;
+    /* Number of different CPUs seen while trying to find a new "full loop" */
+    int cpus_seen = 0;
+    /* indexes[cpu_ind] stores current index to an array of TSC probes collected on a CPU
+       that has index "cpu_ind" */
+    uint64_t *indexes = 0;
+
+    WTMLIB_OUT( "\t\tTesting monotonicity of the TSC probes sequence...\n");
+
+    if ( wtmlib_CheckTSCProbesConsistency( tsc_probes, num_avail_cpus, probes_num,
+                                           err_msg, err_msg_size) )
+    {
+        return WTMLIB_RET_TSC_INCONSISTENCY;
+    }
 
     /* If (cpu_seen_num[ind] == num_loops + 1) then it means that we've already seen CPU
        with index "ind" while trying to find a new "full loop". CPU index may not be equal
@@ -2400,18 +3188,20 @@ is_probe_sequence_monotonic_out:
 static int wtmlib_EvalTSCMonotonicityCOP( int num_cpus,
                                           const cpu_set_t* const cpu_constraint,
                                           int cline_size,
+                                          wtmlib_TSCProbeThreadPool_t *pool,
                                           bool *is_monotonic_ret,
                                           char *err_msg,
                                           int err_msg_size)
 {
-    WTMLIB_ASSERT( cpu_constraint);
+    WTMLIB_ASSERT( cpu_constraint && pool);
 
     char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
-    cpu_set_t **cpu_sets = 0;
     wtmlib_TSCProbe_t **tsc_probes = 0;
     int cpu_set_size = CPU_ALLOC_SIZE( num_cpus);
     /* Number of CPUs available to the current thread */
     int num_cpus_avail = 0;
+    /* Indexes of probe threads that participate in probing */
+    int *thread_inds = 0;
     bool is_monotonic = false;
     int ret = 0;
 
@@ -2423,9 +3213,9 @@ static int wtmlib_EvalTSCMonotonicityCOP( int num_cpus,
         if ( CPU_ISSET_S( cpu_id, cpu_set_size, cpu_constraint) ) num_cpus_avail++;
     }
 
-    ret = wtmlib_AllocMemForCASOrderedProbes( cline_size, num_cpus, num_cpus_avail,
+    ret = wtmlib_AllocMemForCASOrderedProbes( cline_size, num_cpus_avail,
                                               WTMLIB_EVAL_TSC_MONOTCTY_PROBES_COUNT,
-                                              &cpu_sets, &tsc_probes, local_err_msg,
+                                              &tsc_probes, local_err_msg,
                                               sizeof( local_err_msg));
 
     if ( ret )
@@ -2436,20 +3226,31 @@ static int wtmlib_EvalTSCMonotonicityCOP( int num_cpus,
         goto eval_tsc_monotonicity_cop_out;
     }
 
-    /* Initialize CPU sets */
+    thread_inds = (int*)calloc( sizeof( int), num_cpus_avail);
+
+    if ( !thread_inds )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory for indexes "
+                         "of TSC probe threads");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto eval_tsc_monotonicity_cop_out;
+    }
+
+    /* Map available CPUs to probe threads */
     for ( int cpu_id = 0, set_inx = 0; cpu_id < num_cpus; cpu_id++ )
     {
         if ( !CPU_ISSET_S( cpu_id, cpu_set_size, cpu_constraint) ) continue;
 
         WTMLIB_ASSERT( set_inx < num_cpus_avail);
         WTMLIB_OUT( "\t\tCPU ID %d maps to CPU index %d\n", cpu_id, set_inx);
-        CPU_ZERO_S( cpu_set_size, cpu_sets[set_inx]);
-        CPU_SET_S( cpu_id, cpu_set_size, cpu_sets[set_inx]);
+        thread_inds[set_inx] = wtmlib_GetTSCProbeThreadIndex( pool, cpu_id);
+        WTMLIB_ASSERT( thread_inds[set_inx] >= 0);
         set_inx++;
     }
 
-    ret = wtmlib_CollectCASOrderedTSCProbes( num_cpus_avail, cpu_sets,
-                                             num_cpus, tsc_probes,
+    ret = wtmlib_CollectCASOrderedTSCProbes( pool, num_cpus_avail, thread_inds,
+                                             tsc_probes,
                                              WTMLIB_EVAL_TSC_MONOTCTY_PROBES_COUNT,
                                              local_err_msg, sizeof( local_err_msg));
 
@@ -2479,29 +3280,33 @@ static int wtmlib_EvalTSCMonotonicityCOP( int num_cpus,
     }
 
 eval_tsc_monotonicity_cop_out:
-    wtmlib_DeallocMemForCASOrderedProbes( num_cpus_avail, cpu_sets, tsc_probes);
+    wtmlib_DeallocMemForCASOrderedProbes( num_cpus_avail, tsc_probes);
+
+    if ( thread_inds ) free( thread_inds);
 
     if ( !ret && is_monotonic_ret ) *is_monotonic_ret = is_monotonic;
 
     return ret;
 }
 
-/**                                       
+/**
  * Check whether time-stamp counters can be reliably used for measuring wall-clock time
+ * (using a method of "CAS-Ordered Probes")
  *
- * Data required by the calculations is collected using a method of "CAS-Ordered Probes" -
- * concurrently running threads (one per each available CPU) take all the needed
- * measurements. The measurements are sequentially ordered by means of compare-and-swap
- * operation
+ * If "is_concurrent" is "true", shifts between TSCs are evaluated by probing disjoint
+ * pairs of CPUs concurrently
  */
-int wtmlib_EvalTSCReliabilityCOP( int64_t *tsc_range_length_ret,
-                                  bool *is_monotonic_ret,
-                                  char *err_msg,
-                                  int err_msg_size)
+static int wtmlib_EvalTSCReliabilityCOPImpl( bool is_concurrent,
+                                             int64_t *tsc_range_length_ret,
+                                             bool *is_monotonic_ret,
+                                             char *err_msg,
+                                             int err_msg_size)
 {
     char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
     /* Process and system state */
     wtmlib_ProcAndSysState_t ps_state;
+    /* Pool of TSC probe threads */
+    wtmlib_TSCProbeThreadPool_t *pool = 0;
     int64_t tsc_range_length = -1;
     bool is_monotonic = false;
     int ret = 0;
@@ -2519,10 +3324,36 @@ int wtmlib_EvalTSCReliabilityCOP( int64_t *tsc_range_length_ret,
         goto eval_tsc_reliability_cop_out;
     }
 
-    ret = wtmlib_CalcTSCEnclosingRangeCOP( ps_state.num_cpus, ps_state.initial_cpu,
-                                           ps_state.initial_cpu_set,
-                                           ps_state.cline_size, &tsc_range_length,
-                                           local_err_msg, sizeof( local_err_msg));
+    /* The same set of probe threads is used for all rounds of probing */
+    ret = wtmlib_CreateTSCProbeThreadPool( ps_state.num_cpus, ps_state.initial_cpu_set,
+                                           ps_state.cline_size, &pool, local_err_msg,
+                                           sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't start TSC probe threads: %s",
+                         local_err_msg);
+
+        goto eval_tsc_reliability_cop_out;
+    }
+
+    if ( is_concurrent )
+    {
+        ret = wtmlib_CalcTSCEnclosingRangeCOPConcurrent( ps_state.num_cpus,
+                                                         ps_state.initial_cpu,
+                                                         ps_state.initial_cpu_set,
+                                                         ps_state.cline_size, pool,
+                                                         &tsc_range_length, 0, 0,
+                                                         local_err_msg,
+                                                         sizeof( local_err_msg));
+    } else
+    {
+        ret = wtmlib_CalcTSCEnclosingRangeCOP( ps_state.num_cpus, ps_state.initial_cpu,
+                                               ps_state.initial_cpu_set,
+                                               ps_state.cline_size, pool,
+                                               &tsc_range_length, 0, 0, local_err_msg,
+                                               sizeof( local_err_msg));
+    }
 
     if ( ret )
     {
@@ -2533,7 +3364,7 @@ int wtmlib_EvalTSCReliabilityCOP( int64_t *tsc_range_length_ret,
     }
 
     ret = wtmlib_EvalTSCMonotonicityCOP( ps_state.num_cpus, ps_state.initial_cpu_set,
-                                         ps_state.cline_size, &is_monotonic,
+                                         ps_state.cline_size, pool, &is_monotonic,
                                          local_err_msg, sizeof( local_err_msg));
 
     if ( ret )
@@ -2549,34 +3380,281 @@ int wtmlib_EvalTSCReliabilityCOP( int64_t *tsc_range_length_ret,
     if ( is_monotonic_ret) *is_monotonic_ret = is_monotonic;
 
 eval_tsc_reliability_cop_out:
+    if ( pool && wtmlib_DestroyTSCProbeThreadPool( pool, local_err_msg,
+                                                   sizeof( local_err_msg)) && !ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't stop TSC probe threads: %s",
+                         local_err_msg);
+        ret = WTMLIB_RET_GENERIC_ERR;
+    }
+
     wtmlib_DeallocProcAndSysState( &ps_state);
 
     return ret;
 }
 
 /**
- * Calculate delta in nanoseconds between two timespec values
+ * Check whether time-stamp counters can be reliably used for measuring wall-clock time
+ *
+ * Data required by the calculations is collected using a method of "CAS-Ordered Probes" -
+ * concurrently running threads (one per each available CPU) take all the needed
+ * measurements. The measurements are sequentially ordered by means of compare-and-swap
+ * operation
  */
-static int wtmlib_CalcDeltaInNsecs( const struct timespec *start_time,
-                                    const struct timespec *end_time,
-                                    uint64_t *delta,
-                                    char *err_msg,
-                                    int err_msg_size)
+int wtmlib_EvalTSCReliabilityCOP( int64_t *tsc_range_length_ret,
+                                  bool *is_monotonic_ret,
+                                  char *err_msg,
+                                  int err_msg_size)
 {
-    WTMLIB_ASSERT( start_time && end_time);
-    WTMLIB_ASSERT( start_time->tv_nsec < 1000000000 && end_time->tv_nsec < 1000000000);
-
-    if ( start_time->tv_sec > end_time->tv_sec )
-    {
-        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Start time has %lu seconds while "
-                         "end time has a smaller amount of seconds (%lu)",
-                         start_time->tv_sec, end_time->tv_sec);
-
-        return WTMLIB_RET_GENERIC_ERR;
-    }
-
-    uint64_t num_nsecs = 0;
-    uint64_t num_secs = end_time->tv_sec - start_time->tv_sec;
+    return wtmlib_EvalTSCReliabilityCOPImpl( false, tsc_range_length_ret,
+                                             is_monotonic_ret, err_msg, err_msg_size);
+}
+
+/**
+ * Check whether time-stamp counters can be reliably used for measuring wall-clock time
+ *
+ * The same as "wtmlib_EvalTSCReliabilityCOP()" but disjoint pairs of CPUs are probed
+ * concurrently (see "wtmlib_CalcTSCEnclosingRangeCOPConcurrent()")
+ */
+int wtmlib_EvalTSCReliabilityCOPConcurrent( int64_t *tsc_range_length_ret,
+                                            bool *is_monotonic_ret,
+                                            char *err_msg,
+                                            int err_msg_size)
+{
+    return wtmlib_EvalTSCReliabilityCOPImpl( true, tsc_range_length_ret,
+                                             is_monotonic_ret, err_msg, err_msg_size);
+}
+
+/**
+ * Check that ID of the current CPU can be read along with TSC (by means of
+ * WTMLIB_GET_TSC_AND_CPU())
+ */
+static int wtmlib_CheckTSCAndCPUReading( int num_cpus,
+                                         char *err_msg,
+                                         int err_msg_size)
+{
+#ifdef WTMLIB_ARCH_X86_64
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+    /* Is RDTSCP supported? */
+    if ( !__get_cpuid( 0x80000001, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 27)) )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "RDTSCP instruction is not supported");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    /* Only 12 bits of TSC_AUX are used by Linux to store CPU ID */
+    if ( num_cpus > 0x1000 )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Too many CPUs (%d) to identify them "
+                         "using RDTSCP", num_cpus);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+#endif
+    /* The thread may migrate to a different CPU between the two readings of CPU ID. So,
+       several attempts are made */
+    for ( int i = 0; i < 10; i++ )
+    {
+        int cpu_id = -1;
+
+        WTMLIB_GET_TSC_AND_CPU( &cpu_id);
+
+        if ( cpu_id == sched_getcpu() ) return 0;
+    }
+
+    WTMLIB_BUFF_MSG( err_msg, err_msg_size, "CPU ID read along with TSC doesn't match "
+                     "ID of the current CPU");
+
+    return WTMLIB_RET_GENERIC_ERR;
+}
+
+/**
+ * Build a table of per-CPU TSC offsets
+ */
+int wtmlib_GetTSCOffsetTable( bool is_concurrent,
+                              wtmlib_TSCOffsetTable_t *table_ret,
+                              char *err_msg,
+                              int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    wtmlib_ProcAndSysState_t ps_state;
+    wtmlib_TSCProbeThreadPool_t *pool = 0;
+    wtmlib_TSCOffsetTable_t table = {.num_cpus = 0, .base_cpu = -1, .offsets = 0,
+                                     .offsets_min = 0, .offsets_max = 0,
+                                     .max_uncertainty = 0};
+    int64_t tsc_range_length = -1;
+    int num_clines = 0;
+    int ret = 0;
+
+    WTMLIB_OUT( "Building a table of per-CPU TSC offsets...\n");
+    wtmlib_InitProcAndSysState( &ps_state);
+    ret = wtmlib_GetProcAndSystemState( &ps_state, local_err_msg, sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't obtain details of the "
+                         "system and process state: %s", local_err_msg);
+
+        goto get_tsc_offset_table_out;
+    }
+
+    ret = wtmlib_CheckTSCAndCPUReading( ps_state.num_cpus, local_err_msg,
+                                        sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Corrected TSC values cannot be read: "
+                         "%s", local_err_msg);
+
+        goto get_tsc_offset_table_out;
+    }
+
+    table.num_cpus = ps_state.num_cpus;
+    table.base_cpu = ps_state.initial_cpu;
+    /* The array of offsets is read each time a corrected TSC value is read. Hence, it's
+       aligned to the cache line size and isolated from any mutable data */
+    num_clines = (sizeof( int64_t) * table.num_cpus) / ps_state.cline_size;
+
+    if ( (sizeof( int64_t) * table.num_cpus) % ps_state.cline_size ) num_clines++;
+
+    table.offsets = (int64_t*)aligned_alloc( ps_state.cline_size,
+                                             num_clines * ps_state.cline_size);
+    table.offsets_min = (int64_t*)calloc( sizeof( int64_t), table.num_cpus);
+    table.offsets_max = (int64_t*)calloc( sizeof( int64_t), table.num_cpus);
+
+    if ( !table.offsets || !table.offsets_min || !table.offsets_max )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory for a table "
+                         "of TSC offsets");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto get_tsc_offset_table_out;
+    }
+
+    ret = wtmlib_CreateTSCProbeThreadPool( ps_state.num_cpus, ps_state.initial_cpu_set,
+                                           ps_state.cline_size, &pool, local_err_msg,
+                                           sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't start TSC probe threads: %s",
+                         local_err_msg);
+
+        goto get_tsc_offset_table_out;
+    }
+
+    if ( is_concurrent )
+    {
+        ret = wtmlib_CalcTSCEnclosingRangeCOPConcurrent( ps_state.num_cpus,
+                                                         ps_state.initial_cpu,
+                                                         ps_state.initial_cpu_set,
+                                                         ps_state.cline_size, pool,
+                                                         &tsc_range_length,
+                                                         table.offsets_min,
+                                                         table.offsets_max,
+                                                         local_err_msg,
+                                                         sizeof( local_err_msg));
+    } else
+    {
+        ret = wtmlib_CalcTSCEnclosingRangeCOP( ps_state.num_cpus, ps_state.initial_cpu,
+                                               ps_state.initial_cpu_set,
+                                               ps_state.cline_size, pool,
+                                               &tsc_range_length, table.offsets_min,
+                                               table.offsets_max, local_err_msg,
+                                               sizeof( local_err_msg));
+    }
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while calculating shifts between "
+                         "TSCs: %s", local_err_msg);
+
+        goto get_tsc_offset_table_out;
+    }
+
+    for ( int cpu_id = 0; cpu_id < table.num_cpus; cpu_id++ )
+    {
+        int64_t uncertainty = table.offsets_max[cpu_id] - table.offsets_min[cpu_id];
+
+        WTMLIB_ASSERT( uncertainty >= 0);
+        /* Written this way to avoid overflow */
+        table.offsets[cpu_id] = table.offsets_min[cpu_id] + uncertainty / 2;
+
+        if ( uncertainty > table.max_uncertainty ) table.max_uncertainty = uncertainty;
+
+        WTMLIB_OUT( "\tCPU %d: TSC offset %ld [%ld, %ld]\n", cpu_id,
+                    table.offsets[cpu_id], table.offsets_min[cpu_id],
+                    table.offsets_max[cpu_id]);
+    }
+
+get_tsc_offset_table_out:
+    if ( pool && wtmlib_DestroyTSCProbeThreadPool( pool, local_err_msg,
+                                                   sizeof( local_err_msg)) && !ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't stop TSC probe threads: %s",
+                         local_err_msg);
+        ret = WTMLIB_RET_GENERIC_ERR;
+    }
+
+    wtmlib_DeallocProcAndSysState( &ps_state);
+
+    if ( ret || !table_ret )
+    {
+        wtmlib_FreeTSCOffsetTable( &table);
+    } else
+    {
+        *table_ret = table;
+    }
+
+    return ret;
+}
+
+/**
+ * Release memory allocated by "wtmlib_GetTSCOffsetTable()"
+ */
+void wtmlib_FreeTSCOffsetTable( wtmlib_TSCOffsetTable_t *table)
+{
+    if ( !table ) return;
+
+    if ( table->offsets ) free( table->offsets);
+
+    if ( table->offsets_min ) free( table->offsets_min);
+
+    if ( table->offsets_max ) free( table->offsets_max);
+
+    table->offsets = 0;
+    table->offsets_min = 0;
+    table->offsets_max = 0;
+    table->num_cpus = 0;
+
+    return;
+}
+
+/**
+ * Calculate delta in nanoseconds between two timespec values
+ */
+static int wtmlib_CalcDeltaInNsecs( const struct timespec *start_time,
+                                    const struct timespec *end_time,
+                                    uint64_t *delta,
+                                    char *err_msg,
+                                    int err_msg_size)
+{
+    WTMLIB_ASSERT( start_time && end_time);
+    WTMLIB_ASSERT( start_time->tv_nsec < 1000000000 && end_time->tv_nsec < 1000000000);
+
+    if ( start_time->tv_sec > end_time->tv_sec )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Start time has %lu seconds while "
+                         "end time has a smaller amount of seconds (%lu)",
+                         start_time->tv_sec, end_time->tv_sec);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    uint64_t num_nsecs = 0;
+    uint64_t num_secs = end_time->tv_sec - start_time->tv_sec;
 
     if ( !num_secs && start_time->tv_nsec > end_time->tv_nsec )
     {
@@ -2700,6 +3778,110 @@ static int wtmlib_CalcTSCCountPerSecond( uint64_t time_period_usecs,
     return 0;
 }
 
+/**
+ * Calculate an average of samples "cleaned" from random noise
+ *
+ * Samples that deviate from the mean by more than the corrected sample standard
+ * deviation are considered statistical outliers and are ignored. Besides the average
+ * the function optionally returns the number of "good" samples and the standard error
+ * of their mean. If there is only one "good" sample, the standard error is infinite
+ */
+static int wtmlib_CalcFreeFromNoiseAverage( const uint64_t *samples,
+                                            uint64_t num_samples,
+                                            uint64_t *average_ret,
+                                            uint64_t *num_good_samples_ret,
+                                            double *std_error_ret,
+                                            char *err_msg,
+                                            int err_msg_size)
+{
+    WTMLIB_ASSERT( samples && num_samples);
+
+    /* Calculate "mean" and "standard deviation" of the samples
+       We use incremental formulas for computing both. Classical formulas are less
+       stable. E.g. classical formula for calculating "mean" suffers from the
+       necessity to summ up all the data points. That can result in overflow
+       (especially when data set is large). Though, we need to admit that overflow
+       is very unlikely in our case. Because to collect a lot of data points one
+       needs to spend a lot of time measuring time intervals. Which not a very good
+       use case for the library */
+    double mean = 0.0, S = 0.0, delta = 0.0;
+
+    for ( uint64_t i = 0; i < num_samples; i++ )
+    {
+        delta = samples[i] - mean;
+        mean += delta / (i + 1.0);
+        S += delta * (samples[i] - mean);
+    }
+
+    double sigma = 0.0;
+    uint64_t max_sample = 0, min_sample = UINT64_MAX;
+    uint64_t num_good_samples = 0, average = 0;
+    /* "Mean" and "S" of "good" samples. Needed to evaluate precision of the average */
+    double good_mean = 0.0, good_S = 0.0;
+
+    /* We use "corrected sample standard deviation" here, and thus, "S" is divided
+       not by the number of samples but by the number of samples minus 1 */
+    sigma = num_samples > 1 ? sqrt( S / (num_samples - 1.0)) : sqrt( S);
+
+    /* Find minimum and maximum samples */
+    for ( uint64_t i = 0; i < num_samples; i++ )
+    {
+        max_sample = samples[i] > max_sample ? samples[i] : max_sample;
+        min_sample = samples[i] < min_sample ? samples[i] : min_sample;
+    }
+
+    /* Filter out statistical outliers and calculate an average */
+    for ( uint64_t i = 0; i < num_samples; i++ )
+    {
+        if ( ABS_DIFF( (double)samples[i], mean) > sigma ) continue;
+
+        num_good_samples++;
+        delta = samples[i] - good_mean;
+        good_mean += delta / num_good_samples;
+        good_S += delta * (samples[i] - good_mean);
+
+        /* Samples can be pretty big (though, it's very-very unlikely). We don't want to
+           get overflow while calculating their cumulative summ. That's why we summ up not
+           them but their distances from the minimum sample */
+        /* Still, check that we will not get overflow... */
+        if ( UINT64_MAX - average < samples[i] - min_sample )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Got overflow while calculating an "
+                             "average of \"good\" samples");
+
+            return WTMLIB_RET_GENERIC_ERR;
+        }
+
+        average += (samples[i] - min_sample);
+    }
+
+    average /= num_good_samples;
+    /* Take into account that the cumulative summ was "shifted" by
+       "num_good_samples * min_sample"
+       Cannot get overflow here (an average cannot be bigger than the maximum sample) */
+    average += min_sample;
+    WTMLIB_OUT( "\t\tMinimum sample: %lu, maximum sample: %lu\n", min_sample,
+                max_sample);
+    WTMLIB_OUT( "\t\tMean: %f, corrected sample standard deviation: %f\n",
+                mean, sigma);
+    WTMLIB_OUT( "\t\tAverage \"cleaned\" from statistical noise: %lu\n", average);
+
+    double std_error = HUGE_VAL;
+
+    if ( num_good_samples > 1 )
+    {
+        std_error = sqrt( good_S / (num_good_samples - 1.0) / num_good_samples);
+    }
+
+    if ( average_ret ) *average_ret = average;
+
+    if ( num_good_samples_ret ) *num_good_samples_ret = num_good_samples;
+
+    if ( std_error_ret ) *std_error_ret = std_error;
+
+    return 0;
+}
+
 /**
  * Given a series of TSC-per-sec values and using some basic statistics concepts,
  * calculate a single TSC-per-sec value which would be free from random "noise"
@@ -2755,85 +3937,44 @@ static int wtmlib_CalcTSCCountPerSecond( uint64_t time_period_usecs,
  *          measurements (so that system call overhead becomes negligible compared to
  *          the overall duration of the experiment)
  *       2) calculate "the minimal possible overhead" somehow
+ *
+ * Besides the "cleaned" average the function optionally returns its precision. The
+ * precision is a half-width of the confidence interval of the average computed over the
+ * "good" samples (see WTMLIB_ADAPTIVE_CALIB_Z_SCORE). It is expressed in parts per
+ * million of the average. If there is only one "good" sample, the precision is infinite
  */
 static int wtmlib_CalcFreeFromNoiseTSCPerSec( uint64_t *tsc_per_sec,
                                               uint64_t num_samples,
                                               uint64_t *tsc_per_sec_ret,
+                                              double *precision_ppm_ret,
                                               char *err_msg,
                                               int err_msg_size)
 {
+    uint64_t average = 0;
+    double std_error = HUGE_VAL;
+
     WTMLIB_ASSERT( tsc_per_sec && num_samples);
     WTMLIB_OUT( "\t\"Cleaning\" collected TSC-per-second values from random noise\n");
 
-    /* Calculate "mean" and "standard deviation" of TSC-per-second observable value
-       We use incremental formulas for computing both. Classical formulas are less
-       stable. E.g. classical formula for calculating "mean" suffers from the
-       necessity to summ up all the data points. That can result in overflow
-       (especially when data set is large). Though, we need to admit that overflow
-       is very unlikely in our case. Because to collect a lot of data points one
-       needs to spend a lot of time measuring time intervals. Which not a very good
-       use case for the library */
-    double mean = 0.0, S = 0.0, delta = 0.0;
-
-    for ( uint64_t i = 0; i < num_samples; i++ )
-    {
-        delta = tsc_per_sec[i] - mean;
-        mean += delta / (i + 1.0);
-        S += delta * (tsc_per_sec[i] - mean);
-    }
+    int ret = wtmlib_CalcFreeFromNoiseAverage( tsc_per_sec, num_samples, &average, 0,
+                                               &std_error, err_msg, err_msg_size);
 
-    double sigma = 0.0;
-    uint64_t max_sample = 0, min_sample = UINT64_MAX;
-    uint64_t num_good_samples = 0, average = 0;
+    if ( ret ) return ret;
 
-    /* We use "corrected sample standard deviation" here, and thus, "S" is divided
-       not by the number of samples but by the number of samples minus 1 */
-    sigma = num_samples > 1 ? sqrt( S / (num_samples - 1.0)) : sqrt( S);
+    double precision_ppm = HUGE_VAL;
 
-    /* Find minimum and maximum samples */
-    for ( uint64_t i = 0; i < num_samples; i++ )
+    if ( std_error != HUGE_VAL )
     {
-        max_sample = tsc_per_sec[i] > max_sample ? tsc_per_sec[i] : max_sample;
-        min_sample = tsc_per_sec[i] < min_sample ? tsc_per_sec[i] : min_sample;
+        precision_ppm = WTMLIB_ADAPTIVE_CALIB_Z_SCORE * std_error * 1000000.0 / average;
+        WTMLIB_OUT( "\t\tPrecision of the average: %f ppm\n", precision_ppm);
     }
 
-    /* Filter out statistical outliers and calculate an average */
-    for ( uint64_t i = 0; i < num_samples; i++ )
-    {
-        if ( ABS_DIFF( (double)tsc_per_sec[i], mean) > sigma ) continue;
-
-        num_good_samples++;
-
-        /* Samples can be pretty big (though, it's very-very unlikely). We don't want to
-           get overflow while calculating their cumulative summ. That's why we summ up not
-           them but their distances from the minimum sample */
-        /* Still, check that we will not get overflow... */
-        if ( UINT64_MAX - average < tsc_per_sec[i] - min_sample )
-        {
-            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Got overflow while calculating an "
-                             "average of \"good\" samples");
+    if ( tsc_per_sec_ret ) *tsc_per_sec_ret = average;
 
-            return WTMLIB_RET_GENERIC_ERR;
-        }
+    if ( precision_ppm_ret ) *precision_ppm_ret = precision_ppm;
 
-        average += (tsc_per_sec[i] - min_sample);
-    }
-
-    average /= num_good_samples;
-    /* Take into account that the cumulative summ was "shifted" by
-       "num_good_samples * min_sample"
-       Cannot get overflow here (an average cannot be bigger than the maximum sample) */
-    average += min_sample;
-    WTMLIB_OUT( "\t\tMinimum sample: %lu, maximum sample: %lu\n", min_sample,
-                max_sample);
-    WTMLIB_OUT( "\t\tMean: %f, corrected sample standard deviation: %f\n",
-                mean, sigma);
-    WTMLIB_OUT( "\t\tAverage \"cleaned\" from statistical noise: %lu\n", average);
-
-    if ( tsc_per_sec_ret ) *tsc_per_sec_ret = average;
-
-    return 0;
-}
+    return 0;
+}
 
 /**
  * Calculate parameters that aid in converting measured TSC ticks into nanoseconds. Given
@@ -3034,6 +4175,70 @@ static int wtmlib_CalcTSCToNsecConversionParams( uint64_t tsc_per_sec,
     WTMLIB_OUT( "\t\tNanoseconds per TSC modulus: %lu\n", nsecs_per_tsc_modulus);
     WTMLIB_OUT( "\t\tBitmask to extract TSC remainder: %016lx\n", tsc_remainder_bitmask);
 
+    /* Find the 64-bit fixed-point factor used for conversion by means of 128-bit
+       multiplication: the biggest shift such that the factor still fits 64 bits.
+       1000000000 < 2^30. So, shifting it by up to 97 bits doesn't overflow */
+    uint64_t wide_mult = 0;
+    int wide_shift = 0;
+
+#ifdef __SIZEOF_INT128__
+    while ( wide_shift < 97 &&
+            ((unsigned __int128)1000000000 << (wide_shift + 1)) / tsc_per_sec <=
+            UINT64_MAX )
+    {
+        wide_shift++;
+    }
+
+    wide_mult = (uint64_t)(((unsigned __int128)1000000000 << wide_shift) / tsc_per_sec);
+#endif /* __SIZEOF_INT128__ */
+
+    WTMLIB_OUT( "\t\tWide shift: %d, wide multiplicator: %lu\n", wide_shift, wide_mult);
+
+    /* Parameters of the reverse conversion (nanoseconds to TSC ticks) are calculated the
+       same way as the parameters of the direct conversion. Just the roles of TSC ticks
+       and nanoseconds are swapped */
+    if ( UINT64_MAX / WTMLIB_TIME_CONVERSION_MODULUS < 1000000000 )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Configured time conversion modulus is "
+                         "too big. Nanosecond worth of this period doesn't fit 64-bit "
+                         "cell");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    uint64_t nsec_worth_of_modulus = WTMLIB_TIME_CONVERSION_MODULUS * 1000000000ull;
+    uint64_t nsec_to_tsc_mult_bound = UINT64_MAX / nsec_worth_of_modulus;
+    /* Multiplication here will not produce overflow because 1000000000 is smaller than
+       nsec_worth_of_modulus */
+    uint64_t nsec_to_tsc_factor_bound = nsec_to_tsc_mult_bound * 1000000000 / tsc_per_sec;
+    int nsec_to_tsc_shift = 0;
+
+    while ( nsec_to_tsc_factor_bound > 1 )
+    {
+        nsec_to_tsc_factor_bound >>= 1;
+        nsec_to_tsc_shift++;
+    }
+
+    /* Cannot get overflow here. By calculation the product doesn't exceed
+       nsec_to_tsc_mult_bound * 1000000000 */
+    uint64_t nsec_to_tsc_mult = (1ull << nsec_to_tsc_shift) * tsc_per_sec / 1000000000;
+    int nsec_remainder_length = 0;
+
+    while ( (nsec_worth_of_modulus >> nsec_remainder_length) > 1 )
+    {
+        nsec_remainder_length++;
+    }
+
+    uint64_t nsec_modulus = 1ull << nsec_remainder_length;
+    uint64_t tscs_per_nsec_modulus = (nsec_modulus * nsec_to_tsc_mult) >>
+                                     nsec_to_tsc_shift;
+    uint64_t nsec_remainder_bitmask = nsec_modulus - 1;
+
+    WTMLIB_OUT( "\t\tReverse conversion. Shift: %d, multiplicator: %lu, length of "
+                "nanosecond remainder in bits: %d, TSC ticks per nanosecond modulus: "
+                "%lu\n", nsec_to_tsc_shift, nsec_to_tsc_mult, nsec_remainder_length,
+                tscs_per_nsec_modulus);
+
     if ( conv_params_ret )
     {
         conv_params_ret->mult = mult;
@@ -3042,6 +4247,21 @@ static int wtmlib_CalcTSCToNsecConversionParams( uint64_t tsc_per_sec,
         conv_params_ret->tsc_remainder_length = tsc_remainder_length;
         conv_params_ret->tsc_remainder_bitmask = tsc_remainder_bitmask;
         conv_params_ret->tsc_ticks_per_sec = tsc_per_sec;
+        conv_params_ret->wide_mult = wide_mult;
+        conv_params_ret->wide_shift = wide_shift;
+        conv_params_ret->nsec_to_tsc_mult = nsec_to_tsc_mult;
+        conv_params_ret->nsec_to_tsc_shift = nsec_to_tsc_shift;
+        conv_params_ret->tscs_per_nsec_modulus = tscs_per_nsec_modulus;
+        conv_params_ret->nsec_remainder_length = nsec_remainder_length;
+        conv_params_ret->nsec_remainder_bitmask = nsec_remainder_bitmask;
+        /* The overhead of reading TSC is measured separately (see
+           "wtmlib_MeasureTSCReadOverhead()") */
+        memset( &conv_params_ret->plain_read_overhead, 0,
+                sizeof( conv_params_ret->plain_read_overhead));
+        memset( &conv_params_ret->fenced_read_overhead, 0,
+                sizeof( conv_params_ret->fenced_read_overhead));
+        memset( &conv_params_ret->mfenced_read_overhead, 0,
+                sizeof( conv_params_ret->mfenced_read_overhead));
     }
 
     return 0;
@@ -3141,6 +4361,73 @@ static int wtmlib_CalcTimeBeforeTSCWrap( wtmlib_TSCConversionParams_t *conv_para
     return 0;
 }
 
+/*
+   Ways of reading TSC whose overhead can be measured by
+   "wtmlib_SampleTSCReadOverhead()"
+*/
+/* WTMLIB_GET_TSC() at both ends */
+#define WTMLIB_TSC_READ_PLAIN 0
+/* WTMLIB_GET_TSC_START() / WTMLIB_GET_TSC_END() pair */
+#define WTMLIB_TSC_READ_FENCED 1
+/* WTMLIB_GET_TSC_MFENCED() at both ends */
+#define WTMLIB_TSC_READ_MFENCED 2
+
+/**
+ * Measure the overhead of reading TSC on the current CPU
+ *
+ * Each sample is the difference between two back-to-back reads of TSC done in the
+ * specified way. Samples with negative difference (possible if the thread migrates to a
+ * different CPU in-between) are dropped. The function returns the number of samples
+ * stored to "samples"
+ */
+static int wtmlib_SampleTSCReadOverhead( int read_type,
+                                         uint64_t *samples,
+                                         int num_measurements)
+{
+    WTMLIB_ASSERT( samples && num_measurements > 0);
+
+    int num_samples = 0;
+
+    for ( int i = 0; i < num_measurements; i++ )
+    {
+        uint64_t start_tsc = 0, end_tsc = 0;
+
+        switch ( read_type )
+        {
+            case WTMLIB_TSC_READ_PLAIN:
+                start_tsc = WTMLIB_GET_TSC();
+                end_tsc = WTMLIB_GET_TSC();
+                break;
+            case WTMLIB_TSC_READ_FENCED:
+                start_tsc = WTMLIB_GET_TSC_START();
+                end_tsc = WTMLIB_GET_TSC_END();
+                break;
+            default:
+                WTMLIB_ASSERT( read_type == WTMLIB_TSC_READ_MFENCED);
+                start_tsc = WTMLIB_GET_TSC_MFENCED();
+                end_tsc = WTMLIB_GET_TSC_MFENCED();
+        }
+
+        if ( end_tsc < start_tsc ) continue;
+
+        samples[num_samples++] = end_tsc - start_tsc;
+    }
+
+    return num_samples;
+}
+
+/**
+ * Compare two uint64_t values. Used by "qsort()"
+ */
+static int wtmlib_CompareUInt64( const void *a,
+                                 const void *b)
+{
+    uint64_t val_a = *(const uint64_t*)a;
+    uint64_t val_b = *(const uint64_t*)b;
+
+    return val_a < val_b ? -1 : (val_a > val_b ? 1 : 0);
+}
+
 /**
  * Calculate parameters used to convert TSC ticks into nanoseconds. Also
  * calculate time remaining before the earliest TSC wrap
@@ -3197,7 +4484,7 @@ int wtmlib_GetTSCToNsecConversionParams( wtmlib_TSCConversionParams_t *conv_para
 
     ret = wtmlib_CalcFreeFromNoiseTSCPerSec( tsc_per_sec,
                                              WTMLIB_TSC_PER_SEC_SAMPLE_COUNT,
-                                             &tsc_per_sec_golden, local_err_msg,
+                                             &tsc_per_sec_golden, 0, local_err_msg,
                                              sizeof( local_err_msg));
 
     if ( ret )
@@ -3239,3 +4526,4878 @@ calc_tsc_to_nsec_conversion_params_out:
 
     return ret;
 }
+
+/**
+ * Measure the overhead of reading TSC and store it to the conversion parameters
+ */
+int wtmlib_MeasureTSCReadOverhead( wtmlib_TSCConversionParams_t *conv_params,
+                                   char *err_msg,
+                                   int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    wtmlib_ProcAndSysState_t ps_state;
+    wtmlib_TSCReadOverhead_t overheads[3];
+    int num_measurements = WTMLIB_TSC_READ_OVERHEAD_MEASUREMENTS;
+    uint64_t *samples = 0;
+    /* Per-CPU medians for each type of reading */
+    uint64_t *medians[3] = {0, 0, 0};
+    int num_cpus_measured = 0;
+    int cpu_set_size = 0;
+    cpu_set_t *cpu_set = 0;
+    int ret = 0;
+
+    WTMLIB_OUT( "Measuring overhead of reading TSC...\n");
+
+    if ( !conv_params )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Conversion parameters are not "
+                         "specified");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    wtmlib_InitProcAndSysState( &ps_state);
+    ret = wtmlib_GetProcAndSystemState( &ps_state, local_err_msg, sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't obtain details of the "
+                         "system and process state: %s", local_err_msg);
+
+        goto measure_tsc_read_overhead_out;
+    }
+
+    cpu_set_size = CPU_ALLOC_SIZE( ps_state.num_cpus);
+    cpu_set = CPU_ALLOC( ps_state.num_cpus);
+    samples = (uint64_t*)calloc( sizeof( uint64_t), num_measurements);
+
+    for ( int i = 0; i < 3; i++ )
+    {
+        medians[i] = (uint64_t*)calloc( sizeof( uint64_t), ps_state.num_cpus);
+        overheads[i].min = UINT64_MAX;
+        overheads[i].median = 0;
+    }
+
+    if ( !cpu_set || !samples || !medians[0] || !medians[1] || !medians[2] )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory for samples "
+                         "of TSC reading overhead");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto measure_tsc_read_overhead_out;
+    }
+
+    for ( int cpu_id = 0; cpu_id < ps_state.num_cpus; cpu_id++ )
+    {
+        if ( !CPU_ISSET_S( cpu_id, cpu_set_size, ps_state.initial_cpu_set) ) continue;
+
+        CPU_ZERO_S( cpu_set_size, cpu_set);
+        CPU_SET_S( cpu_id, cpu_set_size, cpu_set);
+        ret = wtmlib_BindThreadToCPU( cpu_set, ps_state.num_cpus, local_err_msg,
+                                      sizeof( local_err_msg));
+
+        if ( ret )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't move the current thread "
+                             "to CPU %d: %s", cpu_id, local_err_msg);
+
+            goto measure_tsc_read_overhead_out;
+        }
+
+        for ( int read_type = 0; read_type < 3; read_type++ )
+        {
+            int num_samples = wtmlib_SampleTSCReadOverhead( read_type, samples,
+                                                            num_measurements);
+
+            if ( !num_samples )
+            {
+                WTMLIB_BUFF_MSG( err_msg, err_msg_size, "All measurements of TSC "
+                                 "reading overhead failed on CPU %d", cpu_id);
+                ret = WTMLIB_RET_GENERIC_ERR;
+
+                goto measure_tsc_read_overhead_out;
+            }
+
+            qsort( samples, num_samples, sizeof( uint64_t), wtmlib_CompareUInt64);
+            medians[read_type][num_cpus_measured] = samples[num_samples / 2];
+
+            if ( samples[0] < overheads[read_type].min )
+            {
+                overheads[read_type].min = samples[0];
+            }
+
+            WTMLIB_OUT( "\tCPU %d, read type %d: min %lu, median %lu TSC ticks\n",
+                        cpu_id, read_type, samples[0], samples[num_samples / 2]);
+        }
+
+        num_cpus_measured++;
+    }
+
+    WTMLIB_ASSERT( num_cpus_measured > 0);
+
+    for ( int read_type = 0; read_type < 3; read_type++ )
+    {
+        qsort( medians[read_type], num_cpus_measured, sizeof( uint64_t),
+               wtmlib_CompareUInt64);
+        overheads[read_type].median = medians[read_type][num_cpus_measured / 2];
+    }
+
+measure_tsc_read_overhead_out:
+    if ( ps_state.initial_cpu_set &&
+         wtmlib_RestoreInitialProcState( &ps_state, local_err_msg,
+                                         sizeof( local_err_msg)) && !ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't restore initial state of "
+                         "the current process: %s", local_err_msg);
+        ret = WTMLIB_RET_GENERIC_ERR;
+    }
+
+    if ( !ret )
+    {
+        conv_params->plain_read_overhead = overheads[WTMLIB_TSC_READ_PLAIN];
+        conv_params->fenced_read_overhead = overheads[WTMLIB_TSC_READ_FENCED];
+        conv_params->mfenced_read_overhead = overheads[WTMLIB_TSC_READ_MFENCED];
+    }
+
+    if ( cpu_set ) CPU_FREE( cpu_set);
+
+    if ( samples ) free( samples);
+
+    for ( int i = 0; i < 3; i++ )
+    {
+        if ( medians[i] ) free( medians[i]);
+    }
+
+    wtmlib_DeallocProcAndSysState( &ps_state);
+
+    return ret;
+}
+
+/**
+ * Measure TSC frequency with the requested precision using as few measurements as
+ * possible
+ *
+ * Measurements start with a short time period. Precision of the "cleaned" average is
+ * re-evaluated after every measurement. If the precision target is not met after
+ * WTMLIB_ADAPTIVE_CALIB_SAMPLES_PER_PERIOD measurements, the period is doubled and the
+ * collected samples are discarded (samples obtained with different periods have
+ * different variance and thus cannot be mixed). Once the period reaches
+ * WTMLIB_TIME_PERIOD_TO_MATCH_WITH_TSC it is not increased anymore, and up to
+ * WTMLIB_TSC_PER_SEC_SAMPLE_COUNT samples are collected with it.
+ *
+ * The procedure stops when the target is met, when the time budget is exhausted or when
+ * all the samples are collected. The most precise estimate seen so far is returned.
+ * It's an error if no estimate could be made within the time budget
+ */
+static int wtmlib_CalcTSCPerSecAdaptive( double target_ppm,
+                                         uint64_t time_budget_msecs,
+                                         uint64_t *tsc_per_sec_ret,
+                                         double *achieved_ppm_ret,
+                                         char *err_msg,
+                                         int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    struct timespec start_time = {.tv_sec = 0, .tv_nsec = 0};
+    struct timespec cur_time = {.tv_sec = 0, .tv_nsec = 0};
+    uint64_t period_usecs = WTMLIB_ADAPTIVE_CALIB_INITIAL_PERIOD;
+    uint64_t max_samples = WTMLIB_ADAPTIVE_CALIB_SAMPLES_PER_PERIOD;
+    uint64_t num_samples = 0, elapsed_nsecs = 0;
+    uint64_t best_tsc_per_sec = 0;
+    double best_ppm = HUGE_VAL;
+    int ret = 0;
+    uint64_t sample_capacity = WTMLIB_TSC_PER_SEC_SAMPLE_COUNT >
+                               WTMLIB_ADAPTIVE_CALIB_SAMPLES_PER_PERIOD ?
+                               WTMLIB_TSC_PER_SEC_SAMPLE_COUNT :
+                               WTMLIB_ADAPTIVE_CALIB_SAMPLES_PER_PERIOD;
+    uint64_t *tsc_per_sec = (uint64_t*)calloc( sizeof( uint64_t), sample_capacity);
+
+    if ( !tsc_per_sec )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory to keep "
+                         "tsc-per-second values");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    if ( clock_gettime( CLOCK_MONOTONIC_RAW, &start_time) )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "A call to 'clock_gettime()' failed: %s",
+                         WTMLIB_STRERROR_R( local_err_msg, sizeof( local_err_msg)));
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto calc_tsc_per_sec_adaptive_out;
+    }
+
+    if ( period_usecs >= WTMLIB_TIME_PERIOD_TO_MATCH_WITH_TSC )
+    {
+        period_usecs = WTMLIB_TIME_PERIOD_TO_MATCH_WITH_TSC;
+        max_samples = WTMLIB_TSC_PER_SEC_SAMPLE_COUNT;
+    }
+
+    while ( best_ppm > target_ppm )
+    {
+        if ( clock_gettime( CLOCK_MONOTONIC_RAW, &cur_time) )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "A call to 'clock_gettime()' "
+                             "failed: %s", WTMLIB_STRERROR_R( local_err_msg,
+                                                              sizeof( local_err_msg)));
+            ret = WTMLIB_RET_GENERIC_ERR;
+
+            goto calc_tsc_per_sec_adaptive_out;
+        }
+
+        ret = wtmlib_CalcDeltaInNsecs( &start_time, &cur_time, &elapsed_nsecs,
+                                       local_err_msg, sizeof( local_err_msg));
+
+        if ( ret )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while calculating difference "
+                             "between system time values: %s", local_err_msg);
+
+            goto calc_tsc_per_sec_adaptive_out;
+        }
+
+        /* Don't start a measurement that cannot complete within the time budget */
+        if ( elapsed_nsecs + period_usecs * 1000 > time_budget_msecs * 1000000 )
+        {
+            WTMLIB_OUT( "\t\tTime budget is exhausted\n");
+
+            break;
+        }
+
+        if ( num_samples == max_samples )
+        {
+            /* Precision target was not met with the current period */
+            if ( period_usecs == WTMLIB_TIME_PERIOD_TO_MATCH_WITH_TSC ) break;
+
+            period_usecs *= 2;
+            num_samples = 0;
+
+            if ( period_usecs >= WTMLIB_TIME_PERIOD_TO_MATCH_WITH_TSC )
+            {
+                period_usecs = WTMLIB_TIME_PERIOD_TO_MATCH_WITH_TSC;
+                max_samples = WTMLIB_TSC_PER_SEC_SAMPLE_COUNT;
+            }
+
+            continue;
+        }
+
+        ret = wtmlib_CalcTSCCountPerSecond( period_usecs, &tsc_per_sec[num_samples],
+                                            local_err_msg, sizeof( local_err_msg));
+
+        if ( ret )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while calculating TSC worth "
+                             "of a second: %s", local_err_msg);
+
+            goto calc_tsc_per_sec_adaptive_out;
+        }
+
+        WTMLIB_OUT( "\t\t[Period %lu usecs, measurement %lu] TSC ticks per sec: %lu\n",
+                    period_usecs, num_samples, tsc_per_sec[num_samples]);
+        num_samples++;
+
+        if ( num_samples < WTMLIB_ADAPTIVE_CALIB_MIN_SAMPLES ) continue;
+
+        uint64_t cur_tsc_per_sec = 0;
+        double cur_ppm = HUGE_VAL;
+
+        ret = wtmlib_CalcFreeFromNoiseTSCPerSec( tsc_per_sec, num_samples,
+                                                 &cur_tsc_per_sec, &cur_ppm,
+                                                 local_err_msg, sizeof( local_err_msg));
+
+        if ( ret )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while \"cleaning\" "
+                             "TSC-per-second samples from random noise: %s",
+                             local_err_msg);
+
+            goto calc_tsc_per_sec_adaptive_out;
+        }
+
+        /* Samples may be identical (e.g. when system time is itself derived from TSC).
+           A single measurement cannot be more precise than one nanosecond of the
+           measured period though */
+        double resolution_ppm = 1000.0 / period_usecs;
+
+        cur_ppm = cur_ppm < resolution_ppm ? resolution_ppm : cur_ppm;
+
+        if ( !best_tsc_per_sec || cur_ppm < best_ppm )
+        {
+            best_tsc_per_sec = cur_tsc_per_sec;
+            best_ppm = cur_ppm;
+        }
+    }
+
+    if ( !best_tsc_per_sec )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Time budget (%lu msecs) is too small "
+                         "to collect %d samples of %lu usecs each", time_budget_msecs,
+                         WTMLIB_ADAPTIVE_CALIB_MIN_SAMPLES,
+                         (uint64_t)WTMLIB_ADAPTIVE_CALIB_INITIAL_PERIOD);
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto calc_tsc_per_sec_adaptive_out;
+    }
+
+    WTMLIB_OUT( "\t\tTSC ticks per sec: %lu (precision: %f ppm, target: %f ppm)\n",
+                best_tsc_per_sec, best_ppm, target_ppm);
+
+    if ( tsc_per_sec_ret ) *tsc_per_sec_ret = best_tsc_per_sec;
+
+    if ( achieved_ppm_ret ) *achieved_ppm_ret = best_ppm;
+
+calc_tsc_per_sec_adaptive_out:
+    free( tsc_per_sec);
+
+    return ret;
+}
+
+/**
+ * Calculate parameters used to convert TSC ticks into nanoseconds spending only as much
+ * time as needed to reach the requested precision. Also calculate time remaining before
+ * the earliest TSC wrap
+ */
+int wtmlib_GetTSCToNsecConversionParamsAdaptive( double target_ppm,
+                                                 uint64_t time_budget_msecs,
+                                                 wtmlib_TSCConversionParams_t
+                                                     *conv_params_ret,
+                                                 uint64_t *secs_before_wrap_ret,
+                                                 double *achieved_ppm_ret,
+                                                 char *err_msg,
+                                                 int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    wtmlib_TSCConversionParams_t conv_params;
+    uint64_t tsc_per_sec = 0, secs_before_wrap = 0;
+    double achieved_ppm = HUGE_VAL;
+
+    WTMLIB_OUT( "Calculating TSC-to-nanoseconds conversion parameters (target "
+                "precision: %f ppm, time budget: %lu msecs)...\n", target_ppm,
+                time_budget_msecs);
+
+    int ret = wtmlib_CalcTSCPerSecAdaptive( target_ppm, time_budget_msecs, &tsc_per_sec,
+                                            &achieved_ppm, local_err_msg,
+                                            sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while measuring TSC frequency: %s",
+                         local_err_msg);
+
+        return ret;
+    }
+
+    ret = wtmlib_CalcTSCToNsecConversionParams( tsc_per_sec, &conv_params, local_err_msg,
+                                                sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while calculating TSC-to-"
+                         "nanoseconds conversion parameters: %s", local_err_msg);
+
+        return ret;
+    }
+
+    ret = wtmlib_CalcTimeBeforeTSCWrap( &conv_params, &secs_before_wrap, local_err_msg,
+                                        sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while calculating time "
+                         "before the earliest TSC wrap: %s", local_err_msg);
+
+        return ret;
+    }
+
+    if ( conv_params_ret ) *conv_params_ret = conv_params;
+
+    if ( secs_before_wrap_ret ) *secs_before_wrap_ret = secs_before_wrap;
+
+    if ( achieved_ppm_ret ) *achieved_ppm_ret = achieved_ppm;
+
+    return 0;
+}
+
+/**
+ * First line of a calibration cache file. Identifies the file format and its version
+ */
+#define WTMLIB_CALIB_CACHE_MAGIC "wtmlib_calibration_cache 1"
+
+/**
+ * Size of string fields of a machine fingerprint
+ */
+#define WTMLIB_FINGERPRINT_FIELD_SIZE 256
+
+/**
+ * Machine properties that persistently stored TSC-to-nanoseconds conversion parameters
+ * are bound to. If any of these properties changes, the stored parameters cannot be
+ * trusted anymore
+ */
+typedef struct
+{
+    /* CPU model as reported by /proc/cpuinfo */
+    char cpu_model[WTMLIB_FINGERPRINT_FIELD_SIZE];
+    /* ID of the current boot of the OS kernel. Changes with every reboot */
+    char boot_id[WTMLIB_FINGERPRINT_FIELD_SIZE];
+    /* TSC-related CPU flags reported by /proc/cpuinfo (comma-separated) */
+    char tsc_flags[WTMLIB_FINGERPRINT_FIELD_SIZE];
+    /* TSC frequency in kHz as reported by the kernel (perf_event page) or the hardware.
+       "Zero" if neither of them reports the frequency */
+    uint64_t tsc_khz;
+} wtmlib_MachineFingerprint_t;
+
+/**
+ * Given a line of /proc/cpuinfo, return a pointer to the value part of the line (or
+ * zero if the line doesn't describe the requested key)
+ */
+static char *wtmlib_GetCPUInfoValue( char *line, const char *key)
+{
+    WTMLIB_ASSERT( line && key);
+
+    size_t key_len = strlen( key);
+
+    if ( strncmp( line, key, key_len) ) return 0;
+
+    /* The key must be followed by (optional) white space and a colon */
+    char *pos = line + key_len;
+
+    while ( *pos == ' ' || *pos == '\t' ) pos++;
+
+    if ( *pos != ':' ) return 0;
+
+    pos++;
+
+    while ( *pos == ' ' || *pos == '\t' ) pos++;
+
+    pos[strcspn( pos, "\n")] = '\0';
+
+    return pos;
+}
+
+/* Defined below together with the other ways of getting TSC frequency quickly */
+static int wtmlib_GetTSCPerSecFromPerfEvent( uint64_t *tsc_per_sec_ret, char *err_msg,
+                                             int err_msg_size);
+static int wtmlib_GetTSCPerSecFromArch( uint64_t *tsc_per_sec_ret, char *err_msg,
+                                        int err_msg_size);
+
+/**
+ * Collect a fingerprint of the current machine
+ *
+ * The fingerprint consists of the properties that affect TSC frequency or the way it is
+ * reported: CPU model, TSC-related CPU flags, reported TSC frequency, and ID
+ * of the current boot (TSC frequency is re-calibrated by the kernel on each boot. So, we
+ * conservatively assume that it may change between boots)
+ */
+static int wtmlib_GetMachineFingerprint( wtmlib_MachineFingerprint_t *fingerprint,
+                                         char *err_msg,
+                                         int err_msg_size)
+{
+    WTMLIB_ASSERT( fingerprint);
+
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    /* "flags" line of /proc/cpuinfo can be pretty long on modern x86 CPUs */
+    char line[8192] = "";
+    uint64_t tsc_per_sec = 0;
+    FILE *cpuinfo = 0;
+    int ret = 0;
+
+    fingerprint->cpu_model[0] = '\0';
+    fingerprint->boot_id[0] = '\0';
+    fingerprint->tsc_flags[0] = '\0';
+    fingerprint->tsc_khz = 0;
+    ret = wtmlib_ReadFirstLine( "/proc/sys/kernel/random/boot_id", fingerprint->boot_id,
+                                sizeof( fingerprint->boot_id), local_err_msg,
+                                sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't get boot ID: %s",
+                         local_err_msg);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    /* TSC frequency is not always reported. It's not an error. The sources are the same
+       as used by wtmlib_GetTSCToNsecConversionParamsFast(). The cross-check is not
+       needed, since the cached parameters are checked anyway */
+    if ( !wtmlib_GetTSCPerSecFromPerfEvent( &tsc_per_sec, 0, 0) ||
+         !wtmlib_GetTSCPerSecFromArch( &tsc_per_sec, 0, 0) )
+    {
+        fingerprint->tsc_khz = tsc_per_sec / 1000;
+    }
+
+    cpuinfo = fopen( "/proc/cpuinfo", "r");
+
+    if ( !cpuinfo )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't open /proc/cpuinfo: %s",
+                         WTMLIB_STRERROR_R( local_err_msg, sizeof( local_err_msg)));
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    /* It's enough to look at the description of the first CPU. WTMLIB expects to be
+       executed on a system with homogenous CPUs */
+    while ( fgets( line, sizeof( line), cpuinfo) )
+    {
+        char *value = 0;
+
+        if ( line[0] == '\n' ) break;
+
+#ifdef WTMLIB_ARCH_X86_64
+        if ( (value = wtmlib_GetCPUInfoValue( line, "model name")) )
+        {
+            snprintf( fingerprint->cpu_model, sizeof( fingerprint->cpu_model), "%s",
+                      value);
+        } else if ( (value = wtmlib_GetCPUInfoValue( line, "flags")) )
+        {
+            const char *tsc_flags[] = {"tsc", "rdtscp", "constant_tsc", "nonstop_tsc",
+                                       "tsc_known_freq", "tsc_reliable", "tsc_adjust"};
+            char *save_ptr = 0;
+
+            for ( char *flag = strtok_r( value, " ", &save_ptr); flag;
+                  flag = strtok_r( 0, " ", &save_ptr) )
+            {
+                for ( size_t i = 0; i < sizeof( tsc_flags) / sizeof( tsc_flags[0]); i++ )
+                {
+                    if ( strcmp( flag, tsc_flags[i]) ) continue;
+
+                    size_t len = strlen( fingerprint->tsc_flags);
+
+                    snprintf( fingerprint->tsc_flags + len,
+                              sizeof( fingerprint->tsc_flags) - len, "%s%s",
+                              len ? "," : "", flag);
+                }
+            }
+        }
+#elif WTMLIB_ARCH_PPC_64
+        /* There are no TSC flags on PowerPC. Time base frequency is reported instead */
+        if ( (value = wtmlib_GetCPUInfoValue( line, "cpu")) )
+        {
+            snprintf( fingerprint->cpu_model, sizeof( fingerprint->cpu_model), "%s",
+                      value);
+        } else if ( (value = wtmlib_GetCPUInfoValue( line, "timebase")) )
+        {
+            snprintf( fingerprint->tsc_flags, sizeof( fingerprint->tsc_flags),
+                      "timebase=%s", value);
+        }
+#endif
+    }
+
+    fclose( cpuinfo);
+
+    if ( !fingerprint->cpu_model[0] )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't find CPU model in "
+                         "/proc/cpuinfo");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    return 0;
+}
+
+/**
+ * Load TSC-to-nanoseconds conversion parameters from a calibration cache file
+ *
+ * The function succeeds only if the file is well-formed, the machine fingerprint stored
+ * in the file matches the provided fingerprint, and the stored parameters are consistent
+ * with the current configuration of the library
+ */
+static int wtmlib_LoadCalibrationCache( const char *cache_path,
+                                        const wtmlib_MachineFingerprint_t *fingerprint,
+                                        wtmlib_TSCConversionParams_t *conv_params_ret,
+                                        char *err_msg,
+                                        int err_msg_size)
+{
+    WTMLIB_ASSERT( cache_path && fingerprint);
+
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    char line[WTMLIB_FINGERPRINT_FIELD_SIZE + 64] = "";
+    wtmlib_MachineFingerprint_t cached_fp;
+    wtmlib_TSCConversionParams_t cached_params, calc_params;
+    uint64_t modulus = 0;
+    /* Bitmask of the keys found in the file. Each key must be present exactly once */
+    uint64_t keys_found = 0;
+    int ret = 0;
+    FILE *file = fopen( cache_path, "r");
+
+    if ( !file )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't open the cache file: %s",
+                         WTMLIB_STRERROR_R( local_err_msg, sizeof( local_err_msg)));
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    memset( &cached_fp, 0, sizeof( cached_fp));
+    memset( &cached_params, 0, sizeof( cached_params));
+
+    if ( !fgets( line, sizeof( line), file)
+         || strcmp( line, WTMLIB_CALIB_CACHE_MAGIC "\n") )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Unrecognized cache file format");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto load_calibration_cache_out;
+    }
+
+    while ( fgets( line, sizeof( line), file) )
+    {
+        const char *keys[] = {"cpu_model", "boot_id", "tsc_flags", "tsc_khz",
+                              "time_conversion_modulus", "tsc_ticks_per_sec", "mult",
+                              "shift", "nsecs_per_tsc_modulus", "tsc_remainder_length",
+                              "tsc_remainder_bitmask"};
+        int num_keys = sizeof( keys) / sizeof( keys[0]);
+        int key_ind = 0;
+        char *value = 0;
+
+        line[strcspn( line, "\n")] = '\0';
+
+        for ( ; key_ind < num_keys; key_ind++ )
+        {
+            size_t key_len = strlen( keys[key_ind]);
+
+            if ( !strncmp( line, keys[key_ind], key_len) && line[key_len] == ' ' )
+            {
+                value = line + key_len + 1;
+
+                break;
+            }
+        }
+
+        if ( key_ind == num_keys || (keys_found & (1ull << key_ind)) )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Unexpected or duplicate line in "
+                             "the cache file: \"%s\"", line);
+            ret = WTMLIB_RET_GENERIC_ERR;
+
+            goto load_calibration_cache_out;
+        }
+
+        keys_found |= 1ull << key_ind;
+
+        switch ( key_ind )
+        {
+            case 0:
+                snprintf( cached_fp.cpu_model, sizeof( cached_fp.cpu_model), "%s", value);
+
+                break;
+            case 1:
+                snprintf( cached_fp.boot_id, sizeof( cached_fp.boot_id), "%s", value);
+
+                break;
+            case 2:
+                snprintf( cached_fp.tsc_flags, sizeof( cached_fp.tsc_flags), "%s", value);
+
+                break;
+            case 3:
+                cached_fp.tsc_khz = strtoull( value, 0, 10);
+
+                break;
+            case 4:
+                modulus = strtoull( value, 0, 10);
+
+                break;
+            case 5:
+                cached_params.tsc_ticks_per_sec = strtoull( value, 0, 10);
+
+                break;
+            case 6:
+                cached_params.mult = strtoull( value, 0, 10);
+
+                break;
+            case 7:
+                cached_params.shift = atoi( value);
+
+                break;
+            case 8:
+                cached_params.nsecs_per_tsc_modulus = strtoull( value, 0, 10);
+
+                break;
+            case 9:
+                cached_params.tsc_remainder_length = atoi( value);
+
+                break;
+            case 10:
+                cached_params.tsc_remainder_bitmask = strtoull( value, 0, 16);
+
+                break;
+            default:
+                WTMLIB_ASSERT( 0);
+        }
+    }
+
+    if ( keys_found != (1ull << 11) - 1 )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "The cache file is incomplete");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto load_calibration_cache_out;
+    }
+
+    if ( strcmp( cached_fp.cpu_model, fingerprint->cpu_model)
+         || strcmp( cached_fp.boot_id, fingerprint->boot_id)
+         || strcmp( cached_fp.tsc_flags, fingerprint->tsc_flags)
+         || cached_fp.tsc_khz != fingerprint->tsc_khz )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Machine fingerprint has changed");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto load_calibration_cache_out;
+    }
+
+    if ( modulus != WTMLIB_TIME_CONVERSION_MODULUS )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "The cache was produced with different "
+                         "time conversion modulus (%lu instead of %d)", modulus,
+                         WTMLIB_TIME_CONVERSION_MODULUS);
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto load_calibration_cache_out;
+    }
+
+    /* Conversion parameters are fully defined by TSC frequency. Re-calculate them and
+       make sure they match the stored ones. This protects against corrupted or manually
+       edited cache files */
+    if ( !cached_params.tsc_ticks_per_sec
+         || wtmlib_CalcTSCToNsecConversionParams( cached_params.tsc_ticks_per_sec,
+                                                  &calc_params, 0, 0)
+         || calc_params.mult != cached_params.mult
+         || calc_params.shift != cached_params.shift
+         || calc_params.nsecs_per_tsc_modulus != cached_params.nsecs_per_tsc_modulus
+         || calc_params.tsc_remainder_length != cached_params.tsc_remainder_length
+         || calc_params.tsc_remainder_bitmask != cached_params.tsc_remainder_bitmask )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Conversion parameters stored in the "
+                         "cache are inconsistent");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto load_calibration_cache_out;
+    }
+
+    if ( conv_params_ret ) *conv_params_ret = calc_params;
+
+load_calibration_cache_out:
+    fclose( file);
+
+    return ret;
+}
+
+/**
+ * Store TSC-to-nanoseconds conversion parameters to a calibration cache file
+ *
+ * The file is first written under a temporary name and then atomically renamed. Thus,
+ * concurrently starting processes never observe a partially written cache. The
+ * temporary file is created next to the cache file under an unpredictable name by means
+ * of mkstemp(). mkstemp() never opens an existing file (or follows a symbolic link).
+ * Thus, a file planted in a shared directory (like /var/tmp) can't be overwritten
+ */
+static int wtmlib_StoreCalibrationCache( const char *cache_path,
+                                         const wtmlib_MachineFingerprint_t *fingerprint,
+                                         const wtmlib_TSCConversionParams_t *conv_params,
+                                         char *err_msg,
+                                         int err_msg_size)
+{
+    WTMLIB_ASSERT( cache_path && fingerprint && conv_params);
+
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    char tmp_path[PATH_MAX] = "";
+    FILE *file = 0;
+    int fd = -1;
+    int written = 0;
+
+    if ( snprintf( tmp_path, sizeof( tmp_path), "%s.XXXXXX", cache_path)
+         >= (int)sizeof( tmp_path) )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Path to the cache file is too long");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    fd = mkstemp( tmp_path);
+
+    if ( fd == -1 )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't create a temporary file next "
+                         "to \"%s\": %s", cache_path, WTMLIB_STRERROR_R( local_err_msg,
+                         sizeof( local_err_msg)));
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    /* mkstemp() makes the file accessible only by its owner. The cache may be read by
+       processes of other users too */
+    if ( fchmod( fd, 0644) || !(file = fdopen( fd, "w")) )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't open \"%s\": %s", tmp_path,
+                         WTMLIB_STRERROR_R( local_err_msg, sizeof( local_err_msg)));
+        close( fd);
+        unlink( tmp_path);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    written = fprintf( file, WTMLIB_CALIB_CACHE_MAGIC "\n"
+                       "cpu_model %s\nboot_id %s\ntsc_flags %s\ntsc_khz %lu\n"
+                       "time_conversion_modulus %d\ntsc_ticks_per_sec %lu\nmult %lu\n"
+                       "shift %d\nnsecs_per_tsc_modulus %lu\ntsc_remainder_length %d\n"
+                       "tsc_remainder_bitmask %lx\n", fingerprint->cpu_model,
+                       fingerprint->boot_id, fingerprint->tsc_flags,
+                       fingerprint->tsc_khz, WTMLIB_TIME_CONVERSION_MODULUS,
+                       conv_params->tsc_ticks_per_sec, conv_params->mult,
+                       conv_params->shift, conv_params->nsecs_per_tsc_modulus,
+                       conv_params->tsc_remainder_length,
+                       conv_params->tsc_remainder_bitmask);
+
+    if ( written < 0 || fflush( file) || fsync( fileno( file)) )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't write to \"%s\": %s", tmp_path,
+                         WTMLIB_STRERROR_R( local_err_msg, sizeof( local_err_msg)));
+        fclose( file);
+        unlink( tmp_path);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    fclose( file);
+
+    if ( rename( tmp_path, cache_path) )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't rename \"%s\" to \"%s\": %s",
+                         tmp_path, cache_path, WTMLIB_STRERROR_R( local_err_msg,
+                         sizeof( local_err_msg)));
+        unlink( tmp_path);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    return 0;
+}
+
+/**
+ * Quickly check that the provided TSC frequency agrees with the actual one
+ *
+ * TSC worth of a short time period is measured several times. The check succeeds if at
+ * least one measurement agrees with the expected frequency within the given tolerance
+ * (measured in parts per million). Random noise can only make a measurement look worse.
+ * So, several attempts make the check robust without making it less strict
+ */
+static int wtmlib_CheckTSCPerSec( uint64_t expected_tsc_per_sec,
+                                  uint64_t time_period_usecs,
+                                  int num_attempts,
+                                  uint64_t tolerance_ppm,
+                                  char *err_msg,
+                                  int err_msg_size)
+{
+    WTMLIB_ASSERT( expected_tsc_per_sec);
+
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    uint64_t best_deviation = UINT64_MAX;
+
+    for ( int i = 0; i < num_attempts; i++ )
+    {
+        uint64_t tsc_per_sec = 0;
+        int ret = wtmlib_CalcTSCCountPerSecond( time_period_usecs, &tsc_per_sec,
+                                                local_err_msg, sizeof( local_err_msg));
+
+        if ( ret )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while measuring TSC worth of "
+                             "a second: %s", local_err_msg);
+
+            return ret;
+        }
+
+        /* Deviation in parts per million */
+        uint64_t deviation = (uint64_t)(fabs( (double)tsc_per_sec -
+                                              (double)expected_tsc_per_sec) * 1000000.0 /
+                                        expected_tsc_per_sec);
+
+        WTMLIB_OUT( "\t\t[Attempt %d] TSC ticks per sec: %lu (deviation: %lu ppm)\n", i,
+                    tsc_per_sec, deviation);
+
+        if ( deviation <= tolerance_ppm ) return 0;
+
+        best_deviation = deviation < best_deviation ? deviation : best_deviation;
+    }
+
+    WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Measured TSC frequency deviates from the "
+                     "expected one by at least %lu ppm (%lu ppm allowed)", best_deviation,
+                     tolerance_ppm);
+
+    return WTMLIB_RET_GENERIC_ERR;
+}
+
+/**
+ * Get parameters used to convert TSC ticks into nanoseconds using a persistent
+ * calibration cache. Also calculate time remaining before the earliest TSC wrap
+ */
+int wtmlib_GetTSCToNsecConversionParamsCached( const char *cache_path,
+                                               wtmlib_TSCConversionParams_t
+                                                   *conv_params_ret,
+                                               uint64_t *secs_before_wrap_ret,
+                                               bool *is_cache_hit_ret,
+                                               char *err_msg,
+                                               int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    wtmlib_MachineFingerprint_t fingerprint;
+    wtmlib_TSCConversionParams_t conv_params;
+    uint64_t secs_before_wrap = 0;
+    int ret = 0;
+
+    WTMLIB_OUT( "Getting TSC-to-nanoseconds conversion parameters (using calibration "
+                "cache \"%s\")...\n", cache_path ? cache_path : "");
+
+    if ( !cache_path )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Path to the cache file is not "
+                         "specified");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    ret = wtmlib_GetMachineFingerprint( &fingerprint, local_err_msg,
+                                        sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't get fingerprint of the "
+                         "machine: %s", local_err_msg);
+
+        return ret;
+    }
+
+    if ( !wtmlib_LoadCalibrationCache( cache_path, &fingerprint, &conv_params,
+                                       local_err_msg, sizeof( local_err_msg)) )
+    {
+        WTMLIB_OUT( "\tValidating the cached TSC frequency (%lu ticks per second)...\n",
+                    conv_params.tsc_ticks_per_sec);
+
+        if ( !WTMLIB_CALIB_CACHE_CHECK_PERIOD
+             || !wtmlib_CheckTSCPerSec( conv_params.tsc_ticks_per_sec,
+                                        WTMLIB_CALIB_CACHE_CHECK_PERIOD,
+                                        WTMLIB_CALIB_CACHE_CHECK_ATTEMPTS,
+                                        WTMLIB_CALIB_CACHE_CHECK_TOLERANCE,
+                                        local_err_msg, sizeof( local_err_msg)) )
+        {
+            ret = wtmlib_CalcTimeBeforeTSCWrap( &conv_params, &secs_before_wrap,
+                                                local_err_msg, sizeof( local_err_msg));
+
+            if ( ret )
+            {
+                WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while calculating time "
+                                 "before the earliest TSC wrap: %s", local_err_msg);
+
+                return ret;
+            }
+
+            if ( conv_params_ret ) *conv_params_ret = conv_params;
+
+            if ( secs_before_wrap_ret ) *secs_before_wrap_ret = secs_before_wrap;
+
+            if ( is_cache_hit_ret ) *is_cache_hit_ret = true;
+
+            return 0;
+        }
+    }
+
+    /* The cache is absent, stale, or invalid. Fall back to the full calibration */
+    WTMLIB_OUT( "\tCouldn't use the cache (%s). Re-calibrating...\n", local_err_msg);
+    ret = wtmlib_GetTSCToNsecConversionParams( &conv_params, &secs_before_wrap,
+                                               local_err_msg, sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "%s", local_err_msg);
+
+        return ret;
+    }
+
+    /* Failure to store the cache is not critical. The freshly calculated parameters are
+       valid anyway. The next call will just have to re-calibrate once again */
+    if ( wtmlib_StoreCalibrationCache( cache_path, &fingerprint, &conv_params,
+                                       local_err_msg, sizeof( local_err_msg)) )
+    {
+        WTMLIB_OUT( "\tCouldn't store the calibration cache: %s\n", local_err_msg);
+    }
+
+    if ( conv_params_ret ) *conv_params_ret = conv_params;
+
+    if ( secs_before_wrap_ret ) *secs_before_wrap_ret = secs_before_wrap;
+
+    if ( is_cache_hit_ret ) *is_cache_hit_ret = false;
+
+    return 0;
+}
+
+/**
+ * Get TSC frequency from the perf_event mmap page
+ *
+ * When TSC is used as a source of the kernel's scheduler clock, the kernel exports
+ * parameters that convert TSC ticks into nanoseconds to user space. These parameters
+ * ("time_mult" and "time_shift") are located in the first page of a memory-mapped
+ * perf_event. The kernel converts TSC ticks to nanoseconds as follows:
+ *      nsecs = (tsc_ticks * time_mult) >> time_shift
+ * Thus, TSC ticks per second are: (1000000000 << time_shift) / time_mult
+ *
+ * A "dummy" software event is used. It doesn't count anything and is allowed for
+ * unprivileged processes (as long as perf_event_paranoid is not bigger than 2)
+ */
+static int wtmlib_GetTSCPerSecFromPerfEvent( uint64_t *tsc_per_sec_ret,
+                                             char *err_msg,
+                                             int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    struct perf_event_attr attr;
+    long page_size = sysconf( _SC_PAGESIZE);
+    uint32_t seq = 0, time_mult = 0;
+    uint16_t time_shift = 0;
+    bool cap_user_time = false;
+
+    memset( &attr, 0, sizeof( attr));
+    attr.size = sizeof( attr);
+    attr.type = PERF_TYPE_SOFTWARE;
+    attr.config = PERF_COUNT_SW_DUMMY;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    int fd = syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0);
+
+    if ( fd < 0 )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "perf_event_open() failed: %s",
+                         WTMLIB_STRERROR_R( local_err_msg, sizeof( local_err_msg)));
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    void *page = mmap( 0, page_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    if ( page == MAP_FAILED )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't map perf_event page: %s",
+                         WTMLIB_STRERROR_R( local_err_msg, sizeof( local_err_msg)));
+        close( fd);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    volatile struct perf_event_mmap_page *pc =
+        (volatile struct perf_event_mmap_page*)page;
+
+    /* The kernel may update the page concurrently. "lock" field plays a role of a
+       sequence counter */
+    do
+    {
+        seq = pc->lock;
+        __sync_synchronize();
+        cap_user_time = pc->cap_user_time;
+        time_mult = pc->time_mult;
+        time_shift = pc->time_shift;
+        __sync_synchronize();
+    } while ( pc->lock != seq );
+
+    munmap( page, page_size);
+    close( fd);
+
+    if ( !cap_user_time || !time_mult )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "The kernel doesn't export TSC-to-"
+                         "nanoseconds conversion parameters via perf_event page");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    /* Round to the nearest integer. The shifted value may not fit 64 bits if the kernel
+       chooses a large shift. Hence, 128-bit arithmetic */
+    unsigned __int128 tsc_per_sec = (((unsigned __int128)1000000000 << time_shift) +
+                                     time_mult / 2) / time_mult;
+
+    if ( !tsc_per_sec || tsc_per_sec > UINT64_MAX )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "perf_event page contains insane "
+                         "conversion parameters (mult: %u, shift: %u)", time_mult,
+                         time_shift);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    WTMLIB_OUT( "\t\tperf_event page: time_mult = %u, time_shift = %u\n", time_mult,
+                time_shift);
+
+    if ( tsc_per_sec_ret ) *tsc_per_sec_ret = (uint64_t)tsc_per_sec;
+
+    return 0;
+}
+
+/**
+ * Get TSC frequency reported by the hardware
+ *
+ * On x86-64 the following CPUID leaves are consulted (in this order):
+ *   1) leaf 0x15 - "Time Stamp Counter and Nominal Core Crystal Clock Information".
+ *      TSC frequency is "crystal_hz * ebx / eax". If crystal frequency is not enumerated
+ *      (ecx == 0), then - similarly to the Linux kernel - processor base frequency
+ *      reported by leaf 0x16 is used as TSC frequency
+ *   2) hypervisor leaf 0x40000010 - TSC frequency in kHz reported by some hypervisors
+ *      (leaf 0x15 is often not exposed to virtual machines). The leaf has no common
+ *      definition. So, it's used only if the hypervisor is known to define it that way:
+ *      VMware or KVM (when KVM advertises the leaf; e.g. QEMU's "vmware-cpuid-freq")
+ * On PPC64 time base frequency is reported by the kernel in /proc/cpuinfo
+ */
+static int wtmlib_GetTSCPerSecFromArch( uint64_t *tsc_per_sec_ret,
+                                        char *err_msg,
+                                        int err_msg_size)
+{
+    uint64_t tsc_per_sec = 0;
+#ifdef WTMLIB_ARCH_X86_64
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    unsigned int max_leaf = __get_cpuid_max( 0, 0);
+
+    if ( max_leaf >= 0x15 )
+    {
+        __cpuid_count( 0x15, 0, eax, ebx, ecx, edx);
+
+        if ( eax && ebx )
+        {
+            if ( ecx )
+            {
+                tsc_per_sec = (uint64_t)ecx * ebx / eax;
+                WTMLIB_OUT( "\t\tCPUID 0x15: crystal = %u Hz, ratio = %u/%u\n", ecx, ebx,
+                            eax);
+            } else if ( max_leaf >= 0x16 )
+            {
+                __cpuid_count( 0x16, 0, eax, ebx, ecx, edx);
+                tsc_per_sec = (uint64_t)(eax & 0xffff) * 1000000;
+                WTMLIB_OUT( "\t\tCPUID 0x16: base frequency = %u MHz\n", eax & 0xffff);
+            }
+        }
+    }
+
+    /* Is there a hypervisor? */
+    __cpuid( 1, eax, ebx, ecx, edx);
+
+    if ( !tsc_per_sec && (ecx & (1u << 31)) )
+    {
+        /* Hypervisor vendor signature (12 bytes, not zero-terminated) */
+        char vendor[13] = "";
+
+        __cpuid( 0x40000000, eax, ebx, ecx, edx);
+        memcpy( vendor, &ebx, 4);
+        memcpy( vendor + 4, &ecx, 4);
+        memcpy( vendor + 8, &edx, 4);
+
+        if ( eax >= 0x40000010 && (!memcmp( vendor, "VMwareVMware", 12) ||
+                                   !memcmp( vendor, "KVMKVMKVM\0\0\0", 12)) )
+        {
+            __cpuid( 0x40000010, eax, ebx, ecx, edx);
+            tsc_per_sec = (uint64_t)eax * 1000;
+            WTMLIB_OUT( "\t\tCPUID 0x40000010 (%s): TSC frequency = %u kHz\n", vendor,
+                        eax);
+        } else
+        {
+            WTMLIB_OUT( "\t\tHypervisor \"%s\" doesn't report TSC frequency in CPUID "
+                        "leaf 0x40000010\n", vendor);
+        }
+    }
+
+    if ( !tsc_per_sec )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "TSC frequency is not enumerated by "
+                         "CPUID");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+#elif WTMLIB_ARCH_PPC_64
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    char line[1024] = "";
+    FILE *cpuinfo = fopen( "/proc/cpuinfo", "r");
+
+    if ( !cpuinfo )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't open /proc/cpuinfo: %s",
+                         WTMLIB_STRERROR_R( local_err_msg, sizeof( local_err_msg)));
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    while ( fgets( line, sizeof( line), cpuinfo) )
+    {
+        char *value = wtmlib_GetCPUInfoValue( line, "timebase");
+
+        if ( !value ) continue;
+
+        tsc_per_sec = strtoull( value, 0, 10);
+
+        break;
+    }
+
+    fclose( cpuinfo);
+
+    if ( !tsc_per_sec )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Time base frequency is not found in "
+                         "/proc/cpuinfo");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+#endif
+
+    if ( tsc_per_sec_ret ) *tsc_per_sec_ret = tsc_per_sec;
+
+    return 0;
+}
+
+/**
+ * Get TSC frequency reported by the kernel or the hardware. If "cross_check" is "true",
+ * the reported frequency is also checked against the system clock
+ */
+static int wtmlib_GetReportedTSCPerSec( bool cross_check,
+                                        uint64_t *tsc_per_sec_ret,
+                                        int *freq_source_ret,
+                                        char *err_msg,
+                                        int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    uint64_t tsc_per_sec = 0;
+    int freq_source = WTMLIB_TSC_FREQ_SRC_PERF_MMAP;
+
+    /* The perf_event page is preferred. It contains the value calibrated (and possibly
+       refined) by the kernel at boot time */
+    if ( wtmlib_GetTSCPerSecFromPerfEvent( &tsc_per_sec, local_err_msg,
+                                           sizeof( local_err_msg)) )
+    {
+        WTMLIB_OUT( "\tperf_event page is not usable: %s\n", local_err_msg);
+        freq_source = WTMLIB_TSC_FREQ_SRC_ARCH;
+
+        if ( wtmlib_GetTSCPerSecFromArch( &tsc_per_sec, local_err_msg,
+                                          sizeof( local_err_msg)) )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Hardware doesn't report TSC "
+                             "frequency: %s", local_err_msg);
+
+            return WTMLIB_RET_GENERIC_ERR;
+        }
+    }
+
+    WTMLIB_OUT( "\tReported TSC frequency: %lu ticks per second\n", tsc_per_sec);
+
+    if ( cross_check && wtmlib_CheckTSCPerSec( tsc_per_sec,
+                                               WTMLIB_FAST_CALIB_CHECK_PERIOD,
+                                               WTMLIB_FAST_CALIB_CHECK_ATTEMPTS,
+                                               WTMLIB_FAST_CALIB_CHECK_TOLERANCE,
+                                               local_err_msg, sizeof( local_err_msg)) )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Cross-check failed: %s",
+                         local_err_msg);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    if ( tsc_per_sec_ret ) *tsc_per_sec_ret = tsc_per_sec;
+
+    if ( freq_source_ret ) *freq_source_ret = freq_source;
+
+    return 0;
+}
+
+/**
+ * Get parameters used to convert TSC ticks into nanoseconds using TSC frequency reported
+ * by the kernel or the hardware. Fall back to the statistical method if neither of them
+ * reports the frequency. Also calculate time remaining before the earliest TSC wrap
+ */
+int wtmlib_GetTSCToNsecConversionParamsFast( bool cross_check,
+                                             wtmlib_TSCConversionParams_t
+                                                 *conv_params_ret,
+                                             uint64_t *secs_before_wrap_ret,
+                                             int *freq_source_ret,
+                                             char *err_msg,
+                                             int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    wtmlib_TSCConversionParams_t conv_params;
+    uint64_t tsc_per_sec = 0;
+    uint64_t secs_before_wrap = 0;
+    int freq_source = WTMLIB_TSC_FREQ_SRC_MEASURED;
+    int ret = 0;
+
+    WTMLIB_OUT( "Getting TSC-to-nanoseconds conversion parameters (using reported TSC "
+                "frequency)...\n");
+
+    if ( wtmlib_GetReportedTSCPerSec( cross_check, &tsc_per_sec, &freq_source,
+                                      local_err_msg, sizeof( local_err_msg)) )
+    {
+        WTMLIB_OUT( "\t%s\n", local_err_msg);
+        freq_source = WTMLIB_TSC_FREQ_SRC_MEASURED;
+    }
+
+    if ( freq_source == WTMLIB_TSC_FREQ_SRC_MEASURED )
+    {
+        WTMLIB_OUT( "\tFalling back to measuring TSC frequency...\n");
+        ret = wtmlib_GetTSCToNsecConversionParams( &conv_params, &secs_before_wrap,
+                                                   local_err_msg, sizeof( local_err_msg));
+
+        if ( ret )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "%s", local_err_msg);
+
+            return ret;
+        }
+    } else
+    {
+        ret = wtmlib_CalcTSCToNsecConversionParams( tsc_per_sec, &conv_params,
+                                                    local_err_msg,
+                                                    sizeof( local_err_msg));
+
+        if ( ret )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while calculating TSC-to-"
+                             "nanoseconds conversion parameters: %s", local_err_msg);
+
+            return ret;
+        }
+
+        ret = wtmlib_CalcTimeBeforeTSCWrap( &conv_params, &secs_before_wrap,
+                                            local_err_msg, sizeof( local_err_msg));
+
+        if ( ret )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while calculating time "
+                             "before the earliest TSC wrap: %s", local_err_msg);
+
+            return ret;
+        }
+    }
+
+    if ( conv_params_ret ) *conv_params_ret = conv_params;
+
+    if ( secs_before_wrap_ret ) *secs_before_wrap_ret = secs_before_wrap;
+
+    if ( freq_source_ret ) *freq_source_ret = freq_source;
+
+    return 0;
+}
+
+/**
+ * Type that describes an argument of a thread that measures TSC worth of a second
+ */
+typedef struct
+{
+    /* CPU set that represents a CPU that the thread must be executed on */
+    cpu_set_t *cpu_set;
+    /* Number of CPUs in the system */
+    int num_cpus;
+    /* Array of TSC-per-second values measured by the thread */
+    uint64_t *tsc_per_sec;
+    /* The number of values to measure */
+    uint64_t samples_count;
+    /* System time period (in microseconds) that is matched with a change of TSC */
+    uint64_t time_period_usecs;
+    /* A reference to a variable shared by all the threads. Has the same meaning as
+       in wtmlib_TSCProbeThreadArg_t */
+    int *ready_counter;
+    /* The number of threads. Serves as a target value for the "ready counter" */
+    int num_threads;
+    /* A buffer for storing error message generated by the thread (if any) */
+    char err_msg[WTMLIB_MAX_ERR_MSG_SIZE];
+} wtmlib_TSCPerSecThreadArg_t;
+
+/**
+ * Thread that measures TSC worth of a second on a designated CPU
+ *
+ * NOTE: the same restrictions as for TSC probe threads apply (see the note for
+ *       "wtmlib_TSCProbeThread()")
+ */
+static void *wtmlib_TSCPerSecThread( void *thread_arg)
+{
+    WTMLIB_ASSERT( thread_arg);
+
+    wtmlib_TSCPerSecThreadArg_t *arg = (wtmlib_TSCPerSecThreadArg_t*)thread_arg;
+    int ret = wtmlib_PrepareMeasurementThread( arg->cpu_set, arg->num_cpus,
+                                               arg->ready_counter, arg->num_threads,
+                                               arg->err_msg, sizeof( arg->err_msg));
+
+    if ( ret ) return (void*)(long int)ret;
+
+    for ( uint64_t i = 0; i < arg->samples_count; i++ )
+    {
+        ret = wtmlib_CalcTSCCountPerSecond( arg->time_period_usecs, &arg->tsc_per_sec[i],
+                                            arg->err_msg, sizeof( arg->err_msg));
+
+        if ( ret ) return (void*)(long int)ret;
+    }
+
+    return 0;
+}
+
+/**
+ * Measure TSC worth of a second concurrently on several CPUs
+ *
+ *   - samples_count values are measured on each CPU
+ *   - the values are measured by concurrently running threads (1 thread per CPU)
+ */
+static int wtmlib_CollectTSCPerSecInParallel( int num_threads,
+                                              cpu_set_t **cpu_sets,
+                                              int num_cpus,
+                                              uint64_t **tsc_per_sec,
+                                              uint64_t samples_count,
+                                              char *err_msg,
+                                              int err_msg_size)
+{
+    WTMLIB_ASSERT( num_threads && cpu_sets && tsc_per_sec);
+
+    wtmlib_TSCPerSecThreadArg_t *thread_args = 0;
+    pthread_t *thread_descs = 0;
+    int ret = 0;
+    int ready_counter = 0;
+    /* The number of threads that were actually started */
+    int num_started = num_threads;
+    /* Number of times that thread cancellation failed */
+    int cancel_fails = 0;
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+
+    /* The arguments are not modified by the threads except for error messages which are
+       written only when the thread fails. Thus, no alignment to the cache line size */
+    thread_args = (wtmlib_TSCPerSecThreadArg_t*)calloc( sizeof(
+                                                            wtmlib_TSCPerSecThreadArg_t),
+                                                        num_threads);
+    thread_descs = (pthread_t*)calloc( sizeof( pthread_t), num_threads);
+
+    if ( !thread_args || !thread_descs )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory for "
+                         "TSC-per-second measurement threads");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto collect_tsc_per_sec_in_parallel_out;
+    }
+
+    /* Initialize thread arguments and start threads */
+    for ( int i = 0; i < num_threads; i++ )
+    {
+        thread_args[i].cpu_set = cpu_sets[i];
+        thread_args[i].num_cpus = num_cpus;
+        thread_args[i].tsc_per_sec = tsc_per_sec[i];
+        thread_args[i].samples_count = samples_count;
+        thread_args[i].time_period_usecs = WTMLIB_TIME_PERIOD_TO_MATCH_WITH_TSC;
+        thread_args[i].ready_counter = &ready_counter;
+        thread_args[i].num_threads = num_threads;
+        thread_args[i].err_msg[0] = '\0';
+
+        if ( pthread_create( &thread_descs[i], 0, wtmlib_TSCPerSecThread,
+                             &thread_args[i]) )
+        {
+            num_started = i;
+
+            break;
+        }
+    }
+
+    if ( num_started != num_threads )
+    {
+        /* Cancel threads that were started. If we don't do that, they will hang
+           forever waiting for the target value of the "ready counter" */
+        for ( int i = 0; i < num_started; i++ )
+        {
+            if ( pthread_cancel( thread_descs[i]) ) cancel_fails++;
+        }
+    }
+
+    ret = wtmlib_WaitForTSCProbeThreads( thread_descs, num_started,
+                                         num_started != num_threads, local_err_msg,
+                                         sizeof( local_err_msg));
+
+    if ( num_started != num_threads )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't start all TSC-per-second "
+                         "measurement threads; only %d were started (cancel request "
+                         "failed for %d of them); %s", num_started, cancel_fails,
+                         ret ? local_err_msg : "all started threads successfully "
+                         "joined");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto collect_tsc_per_sec_in_parallel_out;
+    }
+
+    if ( ret )
+    {
+        /* Report the first error message generated by a thread (if any). It's much more
+           informative than the summary produced by the joining procedure */
+        for ( int i = 0; i < num_threads; i++ )
+        {
+            if ( !thread_args[i].err_msg[0] ) continue;
+
+            /* Both messages are bounded, so that they fit together */
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Thread %d failed: %.*s (%.*s)", i,
+                             WTMLIB_MAX_ERR_MSG_SIZE / 2, thread_args[i].err_msg,
+                             WTMLIB_MAX_ERR_MSG_SIZE / 4, local_err_msg);
+
+            goto collect_tsc_per_sec_in_parallel_out;
+        }
+
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error encountered while joining "
+                         "TSC-per-second measurement threads: %s", local_err_msg);
+
+        goto collect_tsc_per_sec_in_parallel_out;
+    }
+
+collect_tsc_per_sec_in_parallel_out:
+    if ( thread_args ) free( thread_args);
+
+    if ( thread_descs ) free( thread_descs);
+
+    return ret;
+}
+
+/**
+ * Calculate parameters used to convert TSC ticks into nanoseconds by measuring TSC
+ * frequency concurrently on all available CPUs. Also calculate time remaining before
+ * the earliest TSC wrap
+ *
+ * WTMLIB_TSC_PER_SEC_SAMPLE_COUNT measurements are evenly distributed among the
+ * available CPUs (but at least WTMLIB_PARALLEL_CALIB_MIN_SAMPLES_PER_CPU measurements
+ * are done on every CPU). All the samples are pooled together and "cleaned" from random
+ * noise. Thus, the calibration takes a fraction of the time needed by the sequential
+ * procedure.
+ *
+ * Besides that, samples collected on CPUs that belong to the same physical package
+ * (socket) are "cleaned" separately. The biggest difference between per-socket TSC
+ * frequencies is reported in parts per million. If it exceeds
+ * WTMLIB_PARALLEL_CALIB_MAX_DISAGREEMENT, TSCs are considered inconsistent
+ */
+int wtmlib_GetTSCToNsecConversionParamsParallel( wtmlib_TSCConversionParams_t
+                                                     *conv_params_ret,
+                                                 uint64_t *secs_before_wrap_ret,
+                                                 double *disagreement_ppm_ret,
+                                                 char *err_msg,
+                                                 int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    wtmlib_ProcAndSysState_t ps_state;
+    wtmlib_TSCConversionParams_t conv_params;
+    cpu_set_t **cpu_sets = 0;
+    uint64_t **tsc_per_sec = 0;
+    uint64_t *pooled_samples = 0;
+    int *package_ids = 0;
+    int num_cpus_avail = 0, cpu_set_size = 0;
+    uint64_t samples_per_cpu = 0, num_pooled = 0;
+    uint64_t tsc_per_sec_golden = 0, secs_before_wrap = 0;
+    uint64_t max_socket_tsc_per_sec = 0, min_socket_tsc_per_sec = UINT64_MAX;
+    double disagreement_ppm = 0.0;
+    int ret = 0;
+
+    WTMLIB_OUT( "Calculating TSC-to-nanoseconds conversion parameters (TSC frequency is "
+                "measured concurrently on all available CPUs)...\n");
+    wtmlib_InitProcAndSysState( &ps_state);
+    ret = wtmlib_GetProcAndSystemState( &ps_state, local_err_msg, sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't obtain details of the "
+                         "system and process state: %s", local_err_msg);
+
+        goto get_tsc_to_nsec_conv_params_parallel_out;
+    }
+
+    cpu_set_size = CPU_ALLOC_SIZE( ps_state.num_cpus);
+    num_cpus_avail = CPU_COUNT_S( cpu_set_size, ps_state.initial_cpu_set);
+    samples_per_cpu = WTMLIB_TSC_PER_SEC_SAMPLE_COUNT / num_cpus_avail;
+
+    if ( WTMLIB_TSC_PER_SEC_SAMPLE_COUNT % num_cpus_avail ) samples_per_cpu++;
+
+    if ( samples_per_cpu < WTMLIB_PARALLEL_CALIB_MIN_SAMPLES_PER_CPU )
+    {
+        samples_per_cpu = WTMLIB_PARALLEL_CALIB_MIN_SAMPLES_PER_CPU;
+    }
+
+    ret = wtmlib_AllocMemForTSCSampling( ps_state.cline_size, ps_state.num_cpus,
+                                         num_cpus_avail, samples_per_cpu,
+                                         sizeof( uint64_t), &cpu_sets,
+                                         (void***)&tsc_per_sec, local_err_msg,
+                                         sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory for "
+                         "TSC-per-second samples: %s", local_err_msg);
+
+        goto get_tsc_to_nsec_conv_params_parallel_out;
+    }
+
+    pooled_samples = (uint64_t*)calloc( sizeof( uint64_t),
+                                        num_cpus_avail * samples_per_cpu);
+    package_ids = (int*)calloc( sizeof( int), num_cpus_avail);
+
+    if ( !pooled_samples || !package_ids )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory to pool "
+                         "TSC-per-second samples");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto get_tsc_to_nsec_conv_params_parallel_out;
+    }
+
+    /* Initialize CPU sets */
+    for ( int cpu_id = 0, set_inx = 0; cpu_id < ps_state.num_cpus; cpu_id++ )
+    {
+        if ( !CPU_ISSET_S( cpu_id, cpu_set_size, ps_state.initial_cpu_set) ) continue;
+
+        WTMLIB_ASSERT( set_inx < num_cpus_avail);
+        package_ids[set_inx] = wtmlib_GetCPUPackageID( cpu_id);
+        WTMLIB_OUT( "\tCPU ID %d maps to CPU index %d (package ID: %d)\n", cpu_id,
+                    set_inx, package_ids[set_inx]);
+        CPU_ZERO_S( cpu_set_size, cpu_sets[set_inx]);
+        CPU_SET_S( cpu_id, cpu_set_size, cpu_sets[set_inx]);
+        set_inx++;
+    }
+
+    WTMLIB_OUT( "\tMeasuring TSC worth of a second (%lu measurements per CPU)\n",
+                samples_per_cpu);
+    ret = wtmlib_CollectTSCPerSecInParallel( num_cpus_avail, cpu_sets,
+                                             ps_state.num_cpus, tsc_per_sec,
+                                             samples_per_cpu, local_err_msg,
+                                             sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while measuring TSC worth of a "
+                         "second: %s", local_err_msg);
+
+        goto get_tsc_to_nsec_conv_params_parallel_out;
+    }
+
+    /* "Clean" samples of each socket separately. Sockets are processed in the order
+       of the first appearance of their IDs. Samples of a socket are pooled in the
+       beginning of the "pooled_samples" array */
+    for ( int i = 0; i < num_cpus_avail; i++ )
+    {
+        bool is_processed = false;
+        uint64_t socket_tsc_per_sec = 0;
+
+        for ( int j = 0; j < i; j++ )
+        {
+            if ( package_ids[j] == package_ids[i] ) is_processed = true;
+        }
+
+        if ( is_processed ) continue;
+
+        num_pooled = 0;
+
+        for ( int j = i; j < num_cpus_avail; j++ )
+        {
+            if ( package_ids[j] != package_ids[i] ) continue;
+
+            for ( uint64_t k = 0; k < samples_per_cpu; k++ )
+            {
+                WTMLIB_OUT( "\t\t[CPU index %d, measurement %lu] TSC ticks per sec: "
+                            "%lu\n", j, k, tsc_per_sec[j][k]);
+                pooled_samples[num_pooled++] = tsc_per_sec[j][k];
+            }
+        }
+
+        WTMLIB_OUT( "\tPackage ID %d:\n", package_ids[i]);
+        ret = wtmlib_CalcFreeFromNoiseTSCPerSec( pooled_samples, num_pooled,
+                                                 &socket_tsc_per_sec, 0, local_err_msg,
+                                                 sizeof( local_err_msg));
+
+        if ( ret )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while \"cleaning\" "
+                             "TSC-per-second samples of package %d from random noise: "
+                             "%s", package_ids[i], local_err_msg);
+
+            goto get_tsc_to_nsec_conv_params_parallel_out;
+        }
+
+        if ( socket_tsc_per_sec > max_socket_tsc_per_sec )
+        {
+            max_socket_tsc_per_sec = socket_tsc_per_sec;
+        }
+
+        if ( socket_tsc_per_sec < min_socket_tsc_per_sec )
+        {
+            min_socket_tsc_per_sec = socket_tsc_per_sec;
+        }
+    }
+
+    /* Now pool all the samples together */
+    num_pooled = 0;
+
+    for ( int i = 0; i < num_cpus_avail; i++ )
+    {
+        for ( uint64_t k = 0; k < samples_per_cpu; k++ )
+        {
+            pooled_samples[num_pooled++] = tsc_per_sec[i][k];
+        }
+    }
+
+    WTMLIB_OUT( "\tAll packages:\n");
+    ret = wtmlib_CalcFreeFromNoiseTSCPerSec( pooled_samples, num_pooled,
+                                             &tsc_per_sec_golden, 0, local_err_msg,
+                                             sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while \"cleaning\" TSC-per-second "
+                         "samples from random noise: %s", local_err_msg);
+
+        goto get_tsc_to_nsec_conv_params_parallel_out;
+    }
+
+    disagreement_ppm = (double)(max_socket_tsc_per_sec - min_socket_tsc_per_sec) *
+                       1000000.0 / tsc_per_sec_golden;
+    WTMLIB_OUT( "\tDisagreement between packages: %f ppm\n", disagreement_ppm);
+
+    if ( disagreement_ppm > WTMLIB_PARALLEL_CALIB_MAX_DISAGREEMENT )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "TSC frequencies measured on different "
+                         "packages disagree by %f ppm (TSC ticks per second vary from "
+                         "%lu to %lu)", disagreement_ppm, min_socket_tsc_per_sec,
+                         max_socket_tsc_per_sec);
+        ret = WTMLIB_RET_TSC_INCONSISTENCY;
+
+        goto get_tsc_to_nsec_conv_params_parallel_out;
+    }
+
+    ret = wtmlib_CalcTSCToNsecConversionParams( tsc_per_sec_golden, &conv_params,
+                                                local_err_msg, sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while calculating TSC-to-"
+                         "nanoseconds conversion parameters: %s", local_err_msg);
+
+        goto get_tsc_to_nsec_conv_params_parallel_out;
+    }
+
+    ret = wtmlib_CalcTimeBeforeTSCWrap( &conv_params, &secs_before_wrap, local_err_msg,
+                                        sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Error while calculating time "
+                         "before the earliest TSC wrap: %s", local_err_msg);
+
+        goto get_tsc_to_nsec_conv_params_parallel_out;
+    }
+
+    if ( conv_params_ret ) *conv_params_ret = conv_params;
+
+    if ( secs_before_wrap_ret ) *secs_before_wrap_ret = secs_before_wrap;
+
+    if ( disagreement_ppm_ret ) *disagreement_ppm_ret = disagreement_ppm;
+
+get_tsc_to_nsec_conv_params_parallel_out:
+    wtmlib_DeallocMemForTSCSampling( num_cpus_avail, cpu_sets, (void**)tsc_per_sec);
+
+    if ( pooled_samples ) free( pooled_samples);
+
+    if ( package_ids ) free( package_ids);
+
+    wtmlib_DeallocProcAndSysState( &ps_state);
+
+    return ret;
+}
+
+/**
+ * Measure the overhead of fenced TSC reading
+ */
+int wtmlib_GetFencedTSCReadOverhead( uint64_t *overhead_ticks_ret,
+                                     char *err_msg,
+                                     int err_msg_size)
+{
+    uint64_t overhead_ticks = UINT64_MAX;
+    int num_samples = 0;
+    uint64_t *samples = (uint64_t*)calloc( sizeof( uint64_t),
+                                           WTMLIB_TSC_READ_OVERHEAD_MEASUREMENTS);
+
+    WTMLIB_OUT( "Measuring overhead of fenced TSC reading...\n");
+
+    if ( !samples )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory for samples "
+                         "of TSC reading overhead");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    num_samples = wtmlib_SampleTSCReadOverhead( WTMLIB_TSC_READ_FENCED, samples,
+                                                WTMLIB_TSC_READ_OVERHEAD_MEASUREMENTS);
+
+    for ( int i = 0; i < num_samples; i++ )
+    {
+        if ( samples[i] < overhead_ticks ) overhead_ticks = samples[i];
+    }
+
+    free( samples);
+
+    if ( !num_samples )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "All measurements of fenced TSC reading "
+                         "overhead failed");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    WTMLIB_OUT( "\tOverhead: %lu TSC ticks\n", overhead_ticks);
+
+    if ( overhead_ticks_ret ) *overhead_ticks_ret = overhead_ticks;
+
+    return 0;
+}
+
+/**
+ * Call the system's "clock_gettime()"
+ *
+ * "clock_gettime()" may be replaced by "wtmlib_clock_gettime()" (see the clock shim).
+ * Hence, the system's implementation is looked up explicitly
+ */
+static int wtmlib_RealClockGettime( clockid_t clk_id,
+                                    struct timespec *tp)
+{
+    typedef int (*clock_gettime_t)( clockid_t, struct timespec*);
+    static clock_gettime_t real_clock_gettime = 0;
+    clock_gettime_t func = __atomic_load_n( &real_clock_gettime, __ATOMIC_RELAXED);
+
+    if ( !func )
+    {
+        func = (clock_gettime_t)dlsym( RTLD_NEXT, "clock_gettime");
+
+        if ( !func ) return syscall( SYS_clock_gettime, clk_id, tp);
+
+        __atomic_store_n( &real_clock_gettime, func, __ATOMIC_RELAXED);
+    }
+
+    return func( clk_id, tp);
+}
+
+/**
+ * Record an anchor that ties TSC to CLOCK_REALTIME and CLOCK_MONOTONIC
+ */
+int wtmlib_GetTSCAnchor( wtmlib_TSCAnchor_t *anchor_ret,
+                         char *err_msg,
+                         int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    wtmlib_TSCAnchor_t anchor = {.tsc = 0, .realtime_nsec = 0, .monotonic_nsec = 0,
+                                 .bracket_ticks = UINT64_MAX};
+
+    WTMLIB_OUT( "Recording TSC anchor...\n");
+
+    for ( int i = 0; i < WTMLIB_TSC_ANCHOR_ATTEMPTS; i++ )
+    {
+        struct timespec realtime, monotonic;
+        uint64_t start_tsc = WTMLIB_GET_TSC_START();
+        int ret_rt = wtmlib_RealClockGettime( CLOCK_REALTIME, &realtime);
+        int ret_mono = wtmlib_RealClockGettime( CLOCK_MONOTONIC, &monotonic);
+        uint64_t end_tsc = WTMLIB_GET_TSC_END();
+
+        if ( ret_rt || ret_mono )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "A call to 'clock_gettime()' "
+                             "failed: %s",
+                             WTMLIB_STRERROR_R( local_err_msg, sizeof( local_err_msg)));
+
+            return WTMLIB_RET_GENERIC_ERR;
+        }
+
+        /* TSC may go backwards if the thread migrates to a different CPU in-between */
+        if ( end_tsc < start_tsc || end_tsc - start_tsc >= anchor.bracket_ticks )
+        {
+            continue;
+        }
+
+        anchor.tsc = start_tsc + (end_tsc - start_tsc) / 2;
+        anchor.realtime_nsec = (uint64_t)realtime.tv_sec * 1000000000 + realtime.tv_nsec;
+        anchor.monotonic_nsec = (uint64_t)monotonic.tv_sec * 1000000000 +
+                                monotonic.tv_nsec;
+        anchor.bracket_ticks = end_tsc - start_tsc;
+    }
+
+    if ( anchor.bracket_ticks == UINT64_MAX )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "All attempts to read system clocks "
+                         "inside a TSC interval failed");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    WTMLIB_OUT( "\tTSC: %lu, realtime: %lu ns, monotonic: %lu ns, bracket: %lu ticks\n",
+                anchor.tsc, anchor.realtime_nsec, anchor.monotonic_nsec,
+                anchor.bracket_ticks);
+
+    if ( anchor_ret ) *anchor_ret = anchor;
+
+    return 0;
+}
+
+/**
+ * Re-initialize a condition variable, so that timeouts of waiting on it are measured
+ * using CLOCK_MONOTONIC
+ */
+static void wtmlib_InitMonotonicCond( pthread_cond_t *cond)
+{
+    pthread_condattr_t cond_attr;
+
+    pthread_cond_destroy( cond);
+    pthread_condattr_init( &cond_attr);
+    pthread_condattr_setclock( &cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init( cond, &cond_attr);
+    pthread_condattr_destroy( &cond_attr);
+
+    return;
+}
+
+/**
+ * Wait for "period_usecs" microseconds or until "*must_stop" becomes "true" (whatever
+ * happens first). "cond" must be initialized by means of wtmlib_InitMonotonicCond().
+ * "mutex" must be locked by the caller. The function returns the value of "*must_stop"
+ */
+static bool wtmlib_WaitForStopRequest( pthread_cond_t *cond,
+                                       pthread_mutex_t *mutex,
+                                       const bool *must_stop,
+                                       uint64_t period_usecs)
+{
+    struct timespec deadline;
+
+    wtmlib_RealClockGettime( CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += period_usecs / 1000000;
+    deadline.tv_nsec += (period_usecs % 1000000) * 1000;
+
+    if ( deadline.tv_nsec >= 1000000000 )
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    while ( !*must_stop )
+    {
+        if ( pthread_cond_timedwait( cond, mutex, &deadline) == ETIMEDOUT ) break;
+    }
+
+    return *must_stop;
+}
+
+/**
+ * State of the TSC-based system clock read by "wtmlib_clock_gettime()"
+ *
+ * The state is protected by a sequence lock. All fields are accessed atomically. The
+ * fields used by the fast path fit a single cache line. Times are stored split into
+ * seconds and nanoseconds, so that the fast path doesn't divide
+ */
+typedef struct
+{
+    /* Sequence counter. It's odd while the state is being updated */
+    uint32_t seq;
+    /* Shift used to convert TSC ticks to nanoseconds (see "mult") */
+    uint32_t shift;
+    /* TSC value at the beginning of the current segment */
+    uint64_t base_tsc;
+    /* Maximum number of TSC ticks after "base_tsc" during which the state can be used.
+       Zero if the clock is not operational */
+    uint64_t max_age_ticks;
+    /* Nanoseconds elapsed since "base_tsc" are: (ticks * mult) >> shift */
+    uint64_t mult;
+    /* CLOCK_MONOTONIC and CLOCK_REALTIME at the beginning of the current segment */
+    uint64_t monotonic_sec;
+    uint64_t realtime_sec;
+    uint32_t monotonic_nsec;
+    uint32_t realtime_nsec;
+    /* CLOCK_MONOTONIC (in nanoseconds) that is not smaller than any value returned (or
+       that can be returned) by the TSC-based clock using this state. When the clock
+       falls back to the system's CLOCK_MONOTONIC, the result is clamped to this value.
+       Thus, CLOCK_MONOTONIC never goes backwards */
+    uint64_t floor_monotonic_nsec;
+} wtmlib_ClockState_t;
+
+/* The state is read on every call to "wtmlib_clock_gettime()". It's aligned, so that it
+   doesn't share cache lines with any other data */
+static wtmlib_ClockState_t wtmlib_clock_state __attribute__((aligned(128))) =
+    {.seq = 0, .shift = 0, .base_tsc = 0, .max_age_ticks = 0, .mult = 0,
+     .monotonic_sec = 0, .realtime_sec = 0, .monotonic_nsec = 0, .realtime_nsec = 0,
+     .floor_monotonic_nsec = 0};
+
+/**
+ * Control structure of the thread that maintains the TSC-based system clock
+ */
+typedef struct
+{
+    /* Protects all the fields below except the copy of the published state */
+    pthread_mutex_t mutex;
+    /* Signalled when the thread must stop and when the clock becomes operational (or
+       fails to) */
+    pthread_cond_t cond;
+    /* Whether "cond" was initialized to use CLOCK_MONOTONIC */
+    bool is_cond_initialized;
+    /* Whether the handler that resets the clock in a child process was registered */
+    bool is_atfork_registered;
+    /* Whether the thread is started. Remains "true" until the thread is joined */
+    bool is_started;
+    /* Whether the thread is being stopped */
+    bool is_stopping;
+    /* Whether the thread must stop */
+    bool must_stop;
+    /* Whether the thread finished its start-up (successfully or not) */
+    bool is_start_done;
+    /* Return code of the start-up */
+    int start_ret;
+    /* Error message of the start-up */
+    char start_err_msg[WTMLIB_MAX_ERR_MSG_SIZE];
+    /* Thread descriptor */
+    pthread_t thread;
+    /* Copy of the published state. Accessed only by the (single) writer of the state */
+    bool is_segment_valid;
+    uint64_t segment_base_tsc;
+    uint64_t segment_base_monotonic_nsec;
+    uint64_t segment_mult;
+    int segment_shift;
+    uint64_t floor_monotonic_nsec;
+} wtmlib_ClockControl_t;
+
+static wtmlib_ClockControl_t wtmlib_clock_ctrl = {.mutex = PTHREAD_MUTEX_INITIALIZER,
+                                                  .cond = PTHREAD_COND_INITIALIZER,
+                                                  .is_cond_initialized = false,
+                                                  .is_atfork_registered = false,
+                                                  .is_started = false,
+                                                  .is_stopping = false,
+                                                  .must_stop = false,
+                                                  .is_start_done = false,
+                                                  .start_ret = 0,
+                                                  .start_err_msg = "",
+                                                  .thread = 0,
+                                                  .is_segment_valid = false,
+                                                  .segment_base_tsc = 0,
+                                                  .segment_base_monotonic_nsec = 0,
+                                                  .segment_mult = 0,
+                                                  .segment_shift = 0,
+                                                  .floor_monotonic_nsec = 0};
+
+/**
+ * Read TSC in the TSC-based system clock
+ *
+ * Subsequent loads are not executed until TSC is read. Unlike WTMLIB_GET_TSC_END(), the
+ * read is not delayed until the preceding loads complete (it's not needed here). That
+ * is enough for the clock and cheaper
+ */
+static inline uint64_t wtmlib_GetClockTSC( void)
+{
+#ifdef WTMLIB_ARCH_X86_64
+    uint32_t eax, edx;
+
+    __asm__ __volatile__( "rdtsc\n\tlfence": "=a" (eax), "=d" (edx) :: "memory");
+
+    return ((uint64_t)edx << 32U) | eax;
+#else
+    return WTMLIB_GET_TSC_END();
+#endif
+}
+
+/**
+ * Convert TSC ticks elapsed since the beginning of a clock segment to nanoseconds
+ */
+static inline uint64_t wtmlib_ClockTicksToNsec( uint64_t ticks,
+                                                uint64_t mult,
+                                                int shift)
+{
+#ifdef __SIZEOF_INT128__
+    return (uint64_t)(((unsigned __int128)ticks * mult) >> shift);
+#else
+    /* "mult" is smaller than 2^32 and "shift" doesn't exceed 32 (see
+       wtmlib_CalcClockMultShift()). So, neither product overflows for the ticks that
+       fit the maximum age of a segment */
+    return (((ticks >> 32) * mult) << (32 - shift)) +
+           (((ticks & 0xffffffff) * mult) >> shift);
+#endif
+}
+
+/**
+ * Calculate "mult" and "shift" that convert TSC ticks to nanoseconds at the given rate
+ * (TSC ticks per second)
+ */
+static void wtmlib_CalcClockMultShift( double tsc_per_sec,
+                                       uint64_t *mult_ret,
+                                       int *shift_ret)
+{
+    double mult = 1000000000.0 * 4294967296.0 / tsc_per_sec;
+    int shift = 32;
+
+    /* "mult" is kept below 2^32 (see wtmlib_ClockTicksToNsec()) */
+    while ( mult >= 4294967296.0 && shift > 0 )
+    {
+        mult /= 2;
+        shift--;
+    }
+
+    *mult_ret = (uint64_t)(mult + 0.5);
+    *shift_ret = shift;
+
+    return;
+}
+
+/**
+ * Value (in nanoseconds) that the published segment of the TSC-based system clock gives
+ * for the given TSC value. Must be called by the writer of the state only
+ */
+static uint64_t wtmlib_GetClockSegmentNsec( uint64_t tsc)
+{
+    wtmlib_ClockControl_t *ctrl = &wtmlib_clock_ctrl;
+
+    WTMLIB_ASSERT( ctrl->is_segment_valid);
+
+    if ( tsc < ctrl->segment_base_tsc ) tsc = ctrl->segment_base_tsc;
+
+    return ctrl->segment_base_monotonic_nsec +
+           wtmlib_ClockTicksToNsec( tsc - ctrl->segment_base_tsc, ctrl->segment_mult,
+                                    ctrl->segment_shift);
+}
+
+/**
+ * Publish a new state of the TSC-based system clock
+ *
+ * If "is_continuous" is "true", the new segment starts at the TSC value read after the
+ * state was marked as being updated, at the time that the current segment gives for
+ * that TSC value. Every reader that used the current segment read TSC before that
+ * moment (see wtmlib_ReadClockState()). Thus, the clock doesn't go backwards when its
+ * rate changes. Otherwise, the new segment starts at "base_tsc" and
+ * "base_monotonic_nsec" (but not below the values that were already returned)
+ *
+ * If "max_age_ticks" is zero, the clock becomes non-operational. "mult" and "shift" are
+ * not used in that case
+ */
+static void wtmlib_PublishClockState( bool is_continuous,
+                                      uint64_t base_tsc,
+                                      uint64_t base_monotonic_nsec,
+                                      uint64_t realtime_offset_nsec,
+                                      uint64_t max_age_ticks,
+                                      uint64_t mult,
+                                      int shift)
+{
+    wtmlib_ClockControl_t *ctrl = &wtmlib_clock_ctrl;
+    wtmlib_ClockState_t *state = &wtmlib_clock_state;
+    uint32_t seq = __atomic_load_n( &state->seq, __ATOMIC_RELAXED);
+    uint64_t realtime_nsec = 0, tsc = 0;
+
+    WTMLIB_ASSERT( !(seq & 1));
+    /* There is a single writer. So, the sequence counter is simply incremented */
+    __atomic_store_n( &state->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence( __ATOMIC_RELEASE);
+    /* TSC is read only after the odd sequence counter became visible to other CPUs */
+    tsc = WTMLIB_GET_TSC_MFENCED();
+
+    /* Readers that used the previous state got values that don't exceed its value at
+       "tsc" */
+    if ( ctrl->is_segment_valid )
+    {
+        ctrl->floor_monotonic_nsec = wtmlib_GetClockSegmentNsec( tsc);
+    }
+
+    if ( max_age_ticks && is_continuous && ctrl->is_segment_valid )
+    {
+        base_monotonic_nsec = ctrl->floor_monotonic_nsec;
+        base_tsc = tsc > ctrl->segment_base_tsc ? tsc : ctrl->segment_base_tsc;
+    } else if ( base_monotonic_nsec < ctrl->floor_monotonic_nsec )
+    {
+        base_monotonic_nsec = ctrl->floor_monotonic_nsec;
+    }
+
+    ctrl->is_segment_valid = max_age_ticks != 0;
+
+    if ( max_age_ticks )
+    {
+        ctrl->segment_base_tsc = base_tsc;
+        ctrl->segment_base_monotonic_nsec = base_monotonic_nsec;
+        ctrl->segment_mult = mult;
+        ctrl->segment_shift = shift;
+        /* No reader gets a bigger value from this segment: older states are not
+           used */
+        ctrl->floor_monotonic_nsec = wtmlib_GetClockSegmentNsec( base_tsc +
+                                                                 max_age_ticks);
+    }
+
+    realtime_nsec = base_monotonic_nsec + realtime_offset_nsec;
+    __atomic_store_n( &state->shift, (uint32_t)shift, __ATOMIC_RELAXED);
+    __atomic_store_n( &state->base_tsc, base_tsc, __ATOMIC_RELAXED);
+    __atomic_store_n( &state->max_age_ticks, max_age_ticks, __ATOMIC_RELAXED);
+    __atomic_store_n( &state->mult, mult, __ATOMIC_RELAXED);
+    __atomic_store_n( &state->monotonic_sec, base_monotonic_nsec / 1000000000,
+                      __ATOMIC_RELAXED);
+    __atomic_store_n( &state->monotonic_nsec,
+                      (uint32_t)(base_monotonic_nsec % 1000000000), __ATOMIC_RELAXED);
+    __atomic_store_n( &state->realtime_sec, realtime_nsec / 1000000000,
+                      __ATOMIC_RELAXED);
+    __atomic_store_n( &state->realtime_nsec, (uint32_t)(realtime_nsec % 1000000000),
+                      __ATOMIC_RELAXED);
+    __atomic_store_n( &state->floor_monotonic_nsec, ctrl->floor_monotonic_nsec,
+                      __ATOMIC_RELAXED);
+    __atomic_store_n( &state->seq, seq + 2, __ATOMIC_RELEASE);
+
+    return;
+}
+
+/**
+ * Get current value of CLOCK_MONOTONIC or CLOCK_REALTIME computed by the TSC-based
+ * system clock. The function returns "false" if the clock is not operational or the
+ * state is too old. In that case the floor of CLOCK_MONOTONIC (see
+ * wtmlib_ClockState_t) is returned
+ */
+static inline bool wtmlib_ReadClockState( bool is_realtime,
+                                          struct timespec *tp,
+                                          uint64_t *floor_monotonic_nsec_ret)
+{
+    wtmlib_ClockState_t *state = &wtmlib_clock_state;
+    uint64_t base_tsc, max_age_ticks, mult, sec, floor_monotonic_nsec, tsc, nsec;
+    uint32_t seq, shift;
+
+    do
+    {
+        seq = __atomic_load_n( &state->seq, __ATOMIC_ACQUIRE);
+        shift = __atomic_load_n( &state->shift, __ATOMIC_RELAXED);
+        base_tsc = __atomic_load_n( &state->base_tsc, __ATOMIC_RELAXED);
+        max_age_ticks = __atomic_load_n( &state->max_age_ticks, __ATOMIC_RELAXED);
+        mult = __atomic_load_n( &state->mult, __ATOMIC_RELAXED);
+        sec = is_realtime ? __atomic_load_n( &state->realtime_sec, __ATOMIC_RELAXED) :
+                            __atomic_load_n( &state->monotonic_sec, __ATOMIC_RELAXED);
+        nsec = is_realtime ? __atomic_load_n( &state->realtime_nsec, __ATOMIC_RELAXED) :
+                             __atomic_load_n( &state->monotonic_nsec, __ATOMIC_RELAXED);
+        floor_monotonic_nsec = __atomic_load_n( &state->floor_monotonic_nsec,
+                                                __ATOMIC_RELAXED);
+        /* TSC is read inside the loop. The read completes before the sequence counter
+           is re-checked. So, a validated TSC value always precedes any update of the
+           state (see wtmlib_PublishClockState()) */
+        tsc = wtmlib_GetClockTSC();
+        __atomic_thread_fence( __ATOMIC_ACQUIRE);
+    } while ( (seq & 1) || seq != __atomic_load_n( &state->seq, __ATOMIC_RELAXED) );
+
+    /* TSC smaller than "base_tsc" (e.g. read on a CPU with a slightly shifted TSC) is
+       treated as "base_tsc" */
+    tsc = tsc > base_tsc ? tsc - base_tsc : 0;
+
+    if ( tsc >= max_age_ticks )
+    {
+        *floor_monotonic_nsec_ret = floor_monotonic_nsec;
+
+        return false;
+    }
+
+    nsec += wtmlib_ClockTicksToNsec( tsc, mult, shift);
+
+    /* The segment is short. So, this loop is cheaper than a division */
+    while ( nsec >= 1000000000 )
+    {
+        nsec -= 1000000000;
+        sec++;
+    }
+
+    tp->tv_sec = sec;
+    tp->tv_nsec = nsec;
+
+    return true;
+}
+
+/**
+ * Drop-in replacement for "clock_gettime()"
+ */
+int wtmlib_clock_gettime( clockid_t clk_id,
+                          struct timespec *tp)
+{
+    uint64_t floor_monotonic_nsec = 0;
+    int ret = 0;
+
+    if ( (clk_id != CLOCK_MONOTONIC && clk_id != CLOCK_REALTIME) || !tp )
+    {
+        return wtmlib_RealClockGettime( clk_id, tp);
+    }
+
+    if ( __builtin_expect( wtmlib_ReadClockState( clk_id == CLOCK_REALTIME, tp,
+                                                  &floor_monotonic_nsec), 1) )
+    {
+        return 0;
+    }
+
+    ret = wtmlib_RealClockGettime( clk_id, tp);
+
+    /* The system's CLOCK_MONOTONIC may lag slightly behind the values returned by the
+       TSC-based clock. CLOCK_REALTIME is not monotonic anyway */
+    if ( !ret && clk_id == CLOCK_MONOTONIC &&
+         (uint64_t)tp->tv_sec * 1000000000 + tp->tv_nsec < floor_monotonic_nsec )
+    {
+        tp->tv_sec = floor_monotonic_nsec / 1000000000;
+        tp->tv_nsec = floor_monotonic_nsec % 1000000000;
+    }
+
+    return ret;
+}
+
+/**
+ * Re-anchor the TSC-based system clock and publish the new segment
+ *
+ * The rate of the new segment is chosen so that the clock catches up with
+ * CLOCK_MONOTONIC by the end of the next refresh period. If the clock is not operational
+ * yet or lags too far behind CLOCK_MONOTONIC, it's stepped forward to the current value
+ * of CLOCK_MONOTONIC
+ */
+static int wtmlib_RefreshClockState( uint64_t tsc_per_sec,
+                                     char *err_msg,
+                                     int err_msg_size)
+{
+    wtmlib_ClockControl_t *ctrl = &wtmlib_clock_ctrl;
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    wtmlib_TSCAnchor_t anchor;
+    uint64_t period_nsec = (uint64_t)WTMLIB_CLOCK_REFRESH_PERIOD * 1000;
+    uint64_t period_ticks = (uint64_t)((double)tsc_per_sec * period_nsec / 1000000000);
+    uint64_t curr_nsec = 0, mult = 0;
+    double rate = tsc_per_sec;
+    bool is_continuous = false;
+    int shift = 0;
+    int ret = wtmlib_GetTSCAnchor( &anchor, local_err_msg, sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't anchor TSC to system clocks: "
+                         "%s", local_err_msg);
+
+        return ret;
+    }
+
+    if ( ctrl->is_segment_valid )
+    {
+        /* Value that the current segment gives at the anchor */
+        curr_nsec = wtmlib_GetClockSegmentNsec( anchor.tsc);
+        is_continuous = curr_nsec + WTMLIB_CLOCK_MAX_CORRECTION >= anchor.monotonic_nsec;
+    }
+
+    if ( is_continuous )
+    {
+        uint64_t target_nsec = anchor.monotonic_nsec + period_nsec;
+
+        rate = curr_nsec < target_nsec ?
+               (double)period_ticks * 1000000000 / (target_nsec - curr_nsec) :
+               2.0 * tsc_per_sec;
+
+        /* The rate is limited, so that a single bad anchor cannot distort the clock
+           significantly */
+        if ( rate > 2.0 * tsc_per_sec ) rate = 2.0 * tsc_per_sec;
+
+        if ( rate < 0.5 * tsc_per_sec ) rate = 0.5 * tsc_per_sec;
+    }
+
+    wtmlib_CalcClockMultShift( rate, &mult, &shift);
+    wtmlib_PublishClockState( is_continuous, anchor.tsc, anchor.monotonic_nsec,
+                              anchor.realtime_nsec - anchor.monotonic_nsec,
+                              period_ticks * WTMLIB_CLOCK_MAX_ANCHOR_AGE, mult, shift);
+
+    return 0;
+}
+
+/**
+ * Get TSC frequency used by the TSC-based system clock
+ *
+ * The clock is re-anchored to CLOCK_MONOTONIC on every refresh. So, an approximate
+ * frequency is enough. The frequency reported by the kernel or the hardware is used if
+ * available. Otherwise, TSC is sampled against CLOCK_MONOTONIC twice, one refresh
+ * period apart. The full statistical calibration is never performed. If a stop is
+ * requested while the function waits, "must_stop_ret" is set to "true" and zero
+ * frequency is returned
+ */
+static int wtmlib_GetClockTSCPerSec( uint64_t *tsc_per_sec_ret,
+                                     bool *must_stop_ret,
+                                     char *err_msg,
+                                     int err_msg_size)
+{
+    wtmlib_ClockControl_t *ctrl = &wtmlib_clock_ctrl;
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    wtmlib_TSCAnchor_t start_anchor, end_anchor;
+    uint64_t tsc_per_sec = 0;
+    bool must_stop = false;
+
+    if ( !wtmlib_GetReportedTSCPerSec( true, &tsc_per_sec, 0, local_err_msg,
+                                       sizeof( local_err_msg)) )
+    {
+        goto get_clock_tsc_per_sec_out;
+    }
+
+    WTMLIB_OUT( "\t%s\n\tSampling TSC against CLOCK_MONOTONIC...\n", local_err_msg);
+
+    if ( wtmlib_GetTSCAnchor( &start_anchor, local_err_msg, sizeof( local_err_msg)) )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't anchor TSC to system clocks: "
+                         "%s", local_err_msg);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    pthread_mutex_lock( &ctrl->mutex);
+    must_stop = wtmlib_WaitForStopRequest( &ctrl->cond, &ctrl->mutex, &ctrl->must_stop,
+                                           WTMLIB_CLOCK_REFRESH_PERIOD);
+    pthread_mutex_unlock( &ctrl->mutex);
+
+    if ( must_stop ) goto get_clock_tsc_per_sec_out;
+
+    if ( wtmlib_GetTSCAnchor( &end_anchor, local_err_msg, sizeof( local_err_msg)) )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't anchor TSC to system clocks: "
+                         "%s", local_err_msg);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    if ( end_anchor.tsc <= start_anchor.tsc ||
+         end_anchor.monotonic_nsec <= start_anchor.monotonic_nsec )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "TSC or CLOCK_MONOTONIC didn't advance "
+                         "while sampling TSC frequency");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    tsc_per_sec = (uint64_t)((double)(end_anchor.tsc - start_anchor.tsc) * 1000000000 /
+                             (end_anchor.monotonic_nsec - start_anchor.monotonic_nsec));
+
+get_clock_tsc_per_sec_out:
+    if ( tsc_per_sec_ret ) *tsc_per_sec_ret = tsc_per_sec;
+
+    if ( must_stop_ret ) *must_stop_ret = must_stop;
+
+    return 0;
+}
+
+/**
+ * Thread that maintains the TSC-based system clock
+ */
+static void *wtmlib_ClockThread( void *arg __attribute__((unused)))
+{
+    wtmlib_ClockControl_t *ctrl = &wtmlib_clock_ctrl;
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    uint64_t tsc_per_sec = 0;
+    bool must_stop = false;
+    int ret = wtmlib_GetClockTSCPerSec( &tsc_per_sec, &must_stop, local_err_msg,
+                                        sizeof( local_err_msg));
+
+    if ( !ret && !must_stop )
+    {
+        ret = wtmlib_RefreshClockState( tsc_per_sec, local_err_msg,
+                                        sizeof( local_err_msg));
+    }
+
+    pthread_mutex_lock( &ctrl->mutex);
+    ctrl->is_start_done = true;
+    ctrl->start_ret = ret;
+    snprintf( ctrl->start_err_msg, sizeof( ctrl->start_err_msg), "%s", local_err_msg);
+    pthread_cond_broadcast( &ctrl->cond);
+    must_stop = ctrl->must_stop || ret;
+
+    while ( !must_stop )
+    {
+        if ( wtmlib_WaitForStopRequest( &ctrl->cond, &ctrl->mutex, &ctrl->must_stop,
+                                        WTMLIB_CLOCK_REFRESH_PERIOD) ) break;
+
+        pthread_mutex_unlock( &ctrl->mutex);
+
+        /* A failed refresh is not fatal. If refreshes keep failing, the state becomes
+           too old and readers fall back to the system clock */
+        if ( wtmlib_RefreshClockState( tsc_per_sec, local_err_msg,
+                                       sizeof( local_err_msg)) )
+        {
+            WTMLIB_OUT( "Couldn't refresh the TSC-based clock: %s\n", local_err_msg);
+        }
+
+        pthread_mutex_lock( &ctrl->mutex);
+    }
+
+    pthread_mutex_unlock( &ctrl->mutex);
+
+    return 0;
+}
+
+/**
+ * Reset the TSC-based system clock in a child process
+ *
+ * The clock thread doesn't exist in the child. The mutex may have been locked and the
+ * published state may have been half-updated at the moment of fork(). The clock is left
+ * stopped, so that readers immediately fall back to the system clock. It can be
+ * started again in the child
+ */
+static void wtmlib_ResetClockAfterFork( void)
+{
+    wtmlib_ClockControl_t *ctrl = &wtmlib_clock_ctrl;
+    /* Destroying the condition variable is not safe here. The parent's waiters are
+       still registered in it. So, both objects are simply overwritten */
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+    uint32_t seq = __atomic_load_n( &wtmlib_clock_state.seq, __ATOMIC_RELAXED);
+
+    ctrl->mutex = mutex;
+    ctrl->cond = cond;
+    ctrl->is_cond_initialized = false;
+    ctrl->is_started = false;
+    ctrl->is_stopping = false;
+    ctrl->must_stop = false;
+    ctrl->is_start_done = false;
+
+    /* Complete the update interrupted by fork() */
+    if ( seq & 1 ) __atomic_store_n( &wtmlib_clock_state.seq, seq + 1, __ATOMIC_RELAXED);
+
+    wtmlib_PublishClockState( false, 0, 0, 0, 0, 0, 0);
+
+    return;
+}
+
+/**
+ * Start the TSC-based system clock
+ */
+int wtmlib_StartClock( bool wait,
+                       char *err_msg,
+                       int err_msg_size)
+{
+    wtmlib_ClockControl_t *ctrl = &wtmlib_clock_ctrl;
+    int ret = 0;
+
+    pthread_mutex_lock( &ctrl->mutex);
+
+    /* A clock that is being stopped is still started: its thread may still update the
+       state */
+    if ( ctrl->is_started )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, ctrl->is_stopping ?
+                         "The clock is being stopped" : "The clock is already started");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto start_clock_out;
+    }
+
+    if ( !ctrl->is_atfork_registered )
+    {
+        if ( pthread_atfork( 0, 0, wtmlib_ResetClockAfterFork) )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't register the fork "
+                             "handler of the clock");
+            ret = WTMLIB_RET_GENERIC_ERR;
+
+            goto start_clock_out;
+        }
+
+        ctrl->is_atfork_registered = true;
+    }
+
+    if ( !ctrl->is_cond_initialized )
+    {
+        wtmlib_InitMonotonicCond( &ctrl->cond);
+        ctrl->is_cond_initialized = true;
+    }
+
+    ctrl->must_stop = false;
+    ctrl->is_start_done = false;
+    ctrl->start_ret = 0;
+    ctrl->start_err_msg[0] = '\0';
+
+    if ( pthread_create( &ctrl->thread, 0, wtmlib_ClockThread, 0) )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't start the clock thread");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto start_clock_out;
+    }
+
+    ctrl->is_started = true;
+
+    if ( !wait ) goto start_clock_out;
+
+    while ( !ctrl->is_start_done ) pthread_cond_wait( &ctrl->cond, &ctrl->mutex);
+
+    ret = ctrl->start_ret;
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't start the clock: %s",
+                         ctrl->start_err_msg);
+        /* The thread exits by itself in this case */
+        pthread_join( ctrl->thread, 0);
+        ctrl->is_started = false;
+    }
+
+start_clock_out:
+    pthread_mutex_unlock( &ctrl->mutex);
+
+    return ret;
+}
+
+/**
+ * Stop the TSC-based system clock
+ */
+int wtmlib_StopClock( char *err_msg,
+                      int err_msg_size)
+{
+    wtmlib_ClockControl_t *ctrl = &wtmlib_clock_ctrl;
+    pthread_t thread;
+
+    pthread_mutex_lock( &ctrl->mutex);
+
+    if ( !ctrl->is_started || ctrl->is_stopping )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, ctrl->is_stopping ?
+                         "The clock is already being stopped" :
+                         "The clock is not started");
+        pthread_mutex_unlock( &ctrl->mutex);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    ctrl->must_stop = true;
+    ctrl->is_stopping = true;
+    thread = ctrl->thread;
+    pthread_cond_broadcast( &ctrl->cond);
+    pthread_mutex_unlock( &ctrl->mutex);
+    pthread_join( thread, 0);
+    /* Readers fall back to the system clock from now on. The thread is joined, so
+       there is a single writer of the state */
+    wtmlib_PublishClockState( false, 0, 0, 0, 0, 0, 0);
+    pthread_mutex_lock( &ctrl->mutex);
+    ctrl->is_started = false;
+    ctrl->is_stopping = false;
+    pthread_mutex_unlock( &ctrl->mutex);
+
+    return 0;
+}
+
+/**
+ * Initialize a versioned container of TSC-to-nanoseconds conversion parameters
+ */
+void wtmlib_InitVersionedTSCConversionParams( wtmlib_VersionedTSCConversionParams_t *vcp,
+                                              const wtmlib_TSCConversionParams_t
+                                                  *conv_params)
+{
+    vcp->copies[0] = *conv_params;
+    vcp->copies[1] = *conv_params;
+    __atomic_store_n( &vcp->seq, 0, __ATOMIC_RELEASE);
+
+    return;
+}
+
+/**
+ * Update the parameters stored in a versioned container
+ */
+void wtmlib_PublishTSCConversionParams( wtmlib_VersionedTSCConversionParams_t *vcp,
+                                        const wtmlib_TSCConversionParams_t *conv_params)
+{
+    uint64_t seq = __atomic_load_n( &vcp->seq, __ATOMIC_RELAXED);
+
+    WTMLIB_ASSERT( !(seq & 1));
+    /* Redirect readers to the second copy and update the first one. The store is a
+       release: readers that see the odd sequence number must also see the second copy
+       written by the previous update. The fence that follows keeps updates of the first
+       copy from becoming visible before the odd sequence number */
+    __atomic_store_n( &vcp->seq, seq + 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence( __ATOMIC_RELEASE);
+    wtmlib_AtomicCopyTSCConversionParams( &vcp->copies[0], conv_params);
+    /* Redirect readers back to the first copy and update the second one */
+    __atomic_store_n( &vcp->seq, seq + 2, __ATOMIC_RELEASE);
+    __atomic_thread_fence( __ATOMIC_RELEASE);
+    wtmlib_AtomicCopyTSCConversionParams( &vcp->copies[1], conv_params);
+
+    return;
+}
+
+/**
+ * Read TSC and the given system clock at (approximately) the same moment
+ *
+ * Out of WTMLIB_TSC_ANCHOR_ATTEMPTS attempts the one with the narrowest TSC interval
+ * around reading of the clock is used. The middle of the interval is returned as the
+ * TSC value that corresponds to the clock value
+ */
+static int wtmlib_SampleTSCAgainstClock( clockid_t clk_id,
+                                         uint64_t *tsc_ret,
+                                         uint64_t *nsec_ret,
+                                         char *err_msg,
+                                         int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    uint64_t tsc = 0, nsec = 0, bracket_ticks = UINT64_MAX;
+
+    for ( int i = 0; i < WTMLIB_TSC_ANCHOR_ATTEMPTS; i++ )
+    {
+        struct timespec clock_time;
+        uint64_t start_tsc = WTMLIB_GET_TSC_START();
+        int ret = wtmlib_RealClockGettime( clk_id, &clock_time);
+        uint64_t end_tsc = WTMLIB_GET_TSC_END();
+
+        if ( ret )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "A call to 'clock_gettime()' "
+                             "failed: %s",
+                             WTMLIB_STRERROR_R( local_err_msg, sizeof( local_err_msg)));
+
+            return WTMLIB_RET_GENERIC_ERR;
+        }
+
+        /* TSC may go backwards if the thread migrates to a different CPU in-between */
+        if ( end_tsc < start_tsc || end_tsc - start_tsc >= bracket_ticks ) continue;
+
+        tsc = start_tsc + (end_tsc - start_tsc) / 2;
+        nsec = (uint64_t)clock_time.tv_sec * 1000000000 + clock_time.tv_nsec;
+        bracket_ticks = end_tsc - start_tsc;
+    }
+
+    if ( bracket_ticks == UINT64_MAX )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "All attempts to read the system clock "
+                         "inside a TSC interval failed");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    if ( tsc_ret ) *tsc_ret = tsc;
+
+    if ( nsec_ret ) *nsec_ret = nsec;
+
+    return 0;
+}
+
+/**
+ * Estimate TSC frequency by fitting a line (using the least squares method) to a set of
+ * (clock nanoseconds, TSC value) samples
+ */
+static int wtmlib_EstimateTSCPerSec( const uint64_t *sample_nsecs,
+                                     const uint64_t *sample_tscs,
+                                     int num_samples,
+                                     uint64_t *tsc_per_sec_ret,
+                                     char *err_msg,
+                                     int err_msg_size)
+{
+    double mean_nsec = 0, mean_tsc = 0, cov = 0, var = 0;
+
+    WTMLIB_ASSERT( num_samples > 0);
+
+    /* Values are taken relative to the first sample to avoid loss of precision */
+    for ( int i = 0; i < num_samples; i++ )
+    {
+        mean_nsec += (double)(int64_t)(sample_nsecs[i] - sample_nsecs[0]);
+        mean_tsc += (double)(int64_t)(sample_tscs[i] - sample_tscs[0]);
+    }
+
+    mean_nsec /= num_samples;
+    mean_tsc /= num_samples;
+
+    for ( int i = 0; i < num_samples; i++ )
+    {
+        double nsec_dev = (double)(int64_t)(sample_nsecs[i] - sample_nsecs[0]) -
+                          mean_nsec;
+        double tsc_dev = (double)(int64_t)(sample_tscs[i] - sample_tscs[0]) - mean_tsc;
+
+        cov += nsec_dev * tsc_dev;
+        var += nsec_dev * nsec_dev;
+    }
+
+    if ( var <= 0 || cov <= 0 )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "TSC doesn't advance along with the "
+                         "system clock");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    if ( tsc_per_sec_ret ) *tsc_per_sec_ret = (uint64_t)(cov / var * 1000000000 + 0.5);
+
+    return 0;
+}
+
+/* TSC-to-nanoseconds conversion parameters maintained by the drift tracker. The
+   parameters are aligned, so that they don't share cache lines with any other data */
+static wtmlib_VersionedTSCConversionParams_t wtmlib_tracked_conv_params
+    __attribute__((aligned(128)));
+
+/**
+ * Control structure of the drift tracker thread
+ */
+typedef struct
+{
+    /* Protects all the fields below */
+    pthread_mutex_t mutex;
+    /* Signalled when the thread must stop */
+    pthread_cond_t cond;
+    /* Whether "cond" was initialized to use CLOCK_MONOTONIC */
+    bool is_cond_initialized;
+    /* Whether the thread is started. Remains "true" until the thread is joined */
+    bool is_started;
+    /* Whether the thread is being stopped */
+    bool is_stopping;
+    /* Whether the thread must stop */
+    bool must_stop;
+    /* Thread descriptor */
+    pthread_t thread;
+    /* Conversion parameters the tracker was started with */
+    wtmlib_TSCConversionParams_t initial_conv_params;
+} wtmlib_DriftTrackerControl_t;
+
+static wtmlib_DriftTrackerControl_t wtmlib_drift_tracker_ctrl =
+    {.mutex = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER,
+     .is_cond_initialized = false, .is_started = false, .is_stopping = false,
+     .must_stop = false, .thread = 0};
+
+/**
+ * Get the most recent conversion parameters published by the drift tracker
+ */
+int wtmlib_GetTrackedTSCConversionParams( wtmlib_TSCConversionParams_t *conv_params_ret,
+                                          char *err_msg,
+                                          int err_msg_size)
+{
+    wtmlib_TSCConversionParams_t conv_params;
+
+    wtmlib_ReadVersionedTSCConversionParams( &wtmlib_tracked_conv_params, &conv_params);
+
+    /* The drift tracker never publishes zero TSC frequency */
+    if ( !conv_params.tsc_ticks_per_sec )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "The drift tracker was never started");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    if ( conv_params_ret ) *conv_params_ret = conv_params;
+
+    return 0;
+}
+
+/**
+ * Get the container of conversion parameters maintained by the drift tracker
+ */
+const wtmlib_VersionedTSCConversionParams_t *wtmlib_GetDriftTrackerParams( void)
+{
+    return &wtmlib_tracked_conv_params;
+}
+
+/**
+ * Thread that tracks the drift of TSC against CLOCK_MONOTONIC_RAW
+ *
+ * The thread periodically samples TSC against the clock and estimates TSC frequency
+ * over the last WTMLIB_DRIFT_TRACKER_WINDOW samples. Conversion parameters calculated
+ * from the estimate are published
+ */
+static void *wtmlib_DriftTrackerThread( void *arg __attribute__((unused)))
+{
+    wtmlib_DriftTrackerControl_t *ctrl = &wtmlib_drift_tracker_ctrl;
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    /* Written before the thread was created and not modified while it runs */
+    const wtmlib_TSCConversionParams_t *initial_conv_params =
+        &ctrl->initial_conv_params;
+    uint64_t sample_nsecs[WTMLIB_DRIFT_TRACKER_WINDOW];
+    uint64_t sample_tscs[WTMLIB_DRIFT_TRACKER_WINDOW];
+    int num_samples = 0, next_sample = 0;
+
+    pthread_mutex_lock( &ctrl->mutex);
+
+    do
+    {
+        wtmlib_TSCConversionParams_t conv_params;
+        uint64_t tsc_per_sec = 0;
+        double drift_ppm = 0;
+
+        pthread_mutex_unlock( &ctrl->mutex);
+
+        if ( wtmlib_SampleTSCAgainstClock( CLOCK_MONOTONIC_RAW, &sample_tscs[next_sample],
+                                           &sample_nsecs[next_sample], local_err_msg,
+                                           sizeof( local_err_msg)) )
+        {
+            WTMLIB_OUT( "Drift tracker couldn't sample TSC: %s\n", local_err_msg);
+
+            goto drift_tracker_next;
+        }
+
+        next_sample = (next_sample + 1) % WTMLIB_DRIFT_TRACKER_WINDOW;
+
+        if ( num_samples < WTMLIB_DRIFT_TRACKER_WINDOW ) num_samples++;
+
+        if ( num_samples < 2 ) goto drift_tracker_next;
+
+        if ( wtmlib_EstimateTSCPerSec( sample_nsecs, sample_tscs, num_samples,
+                                       &tsc_per_sec, local_err_msg,
+                                       sizeof( local_err_msg)) )
+        {
+            drift_ppm = INFINITY;
+        } else
+        {
+            drift_ppm = ((double)tsc_per_sec -
+                         (double)initial_conv_params->tsc_ticks_per_sec) * 1000000 /
+                        initial_conv_params->tsc_ticks_per_sec;
+        }
+
+        WTMLIB_OUT( "Drift tracker: %d samples, TSC ticks per second: %lu (%+.3f ppm)\n",
+                    num_samples, tsc_per_sec, drift_ppm);
+
+        if ( fabs( drift_ppm) > WTMLIB_DRIFT_TRACKER_MAX_DRIFT )
+        {
+            int last_sample = (next_sample + WTMLIB_DRIFT_TRACKER_WINDOW - 1) %
+                              WTMLIB_DRIFT_TRACKER_WINDOW;
+
+            /* Start over from the most recent sample */
+            sample_nsecs[0] = sample_nsecs[last_sample];
+            sample_tscs[0] = sample_tscs[last_sample];
+            num_samples = 1;
+            next_sample = 1;
+
+            goto drift_tracker_next;
+        }
+
+        if ( wtmlib_CalcTSCToNsecConversionParams( tsc_per_sec, &conv_params,
+                                                   local_err_msg,
+                                                   sizeof( local_err_msg)) )
+        {
+            WTMLIB_OUT( "Drift tracker couldn't calculate conversion parameters: %s\n",
+                        local_err_msg);
+
+            goto drift_tracker_next;
+        }
+
+        /* The overhead of reading TSC doesn't depend on TSC frequency */
+        conv_params.plain_read_overhead = initial_conv_params->plain_read_overhead;
+        conv_params.fenced_read_overhead = initial_conv_params->fenced_read_overhead;
+        conv_params.mfenced_read_overhead = initial_conv_params->mfenced_read_overhead;
+        wtmlib_PublishTSCConversionParams( &wtmlib_tracked_conv_params, &conv_params);
+
+drift_tracker_next:
+        pthread_mutex_lock( &ctrl->mutex);
+    } while ( !wtmlib_WaitForStopRequest( &ctrl->cond, &ctrl->mutex, &ctrl->must_stop,
+                                          WTMLIB_DRIFT_TRACKER_PERIOD) );
+
+    pthread_mutex_unlock( &ctrl->mutex);
+
+    return 0;
+}
+
+/**
+ * Start the drift tracker
+ */
+int wtmlib_StartDriftTracker( const wtmlib_TSCConversionParams_t *conv_params,
+                              char *err_msg,
+                              int err_msg_size)
+{
+    wtmlib_DriftTrackerControl_t *ctrl = &wtmlib_drift_tracker_ctrl;
+    int ret = 0;
+
+    if ( !conv_params || !conv_params->tsc_ticks_per_sec )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Initial TSC-to-nanoseconds conversion "
+                         "parameters must be provided");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    pthread_mutex_lock( &ctrl->mutex);
+
+    /* A tracker that is being stopped is still started: its thread may still publish
+       conversion parameters */
+    if ( ctrl->is_started )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, ctrl->is_stopping ?
+                         "The drift tracker is being stopped" :
+                         "The drift tracker is already started");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto start_drift_tracker_out;
+    }
+
+    if ( !ctrl->is_cond_initialized )
+    {
+        wtmlib_InitMonotonicCond( &ctrl->cond);
+        ctrl->is_cond_initialized = true;
+    }
+
+    ctrl->must_stop = false;
+    ctrl->initial_conv_params = *conv_params;
+    /* The tracker thread is not running. So, there is no concurrent writer */
+    wtmlib_PublishTSCConversionParams( &wtmlib_tracked_conv_params, conv_params);
+
+    if ( pthread_create( &ctrl->thread, 0, wtmlib_DriftTrackerThread, 0) )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't start the drift tracker "
+                         "thread");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto start_drift_tracker_out;
+    }
+
+    ctrl->is_started = true;
+
+start_drift_tracker_out:
+    pthread_mutex_unlock( &ctrl->mutex);
+
+    return ret;
+}
+
+/**
+ * Stop the drift tracker
+ */
+int wtmlib_StopDriftTracker( char *err_msg,
+                             int err_msg_size)
+{
+    wtmlib_DriftTrackerControl_t *ctrl = &wtmlib_drift_tracker_ctrl;
+    pthread_t thread;
+
+    pthread_mutex_lock( &ctrl->mutex);
+
+    if ( !ctrl->is_started || ctrl->is_stopping )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, ctrl->is_stopping ?
+                         "The drift tracker is already being stopped" :
+                         "The drift tracker is not started");
+        pthread_mutex_unlock( &ctrl->mutex);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    ctrl->must_stop = true;
+    ctrl->is_stopping = true;
+    thread = ctrl->thread;
+    pthread_cond_broadcast( &ctrl->cond);
+    pthread_mutex_unlock( &ctrl->mutex);
+    pthread_join( thread, 0);
+    pthread_mutex_lock( &ctrl->mutex);
+    ctrl->is_started = false;
+    ctrl->is_stopping = false;
+    pthread_mutex_unlock( &ctrl->mutex);
+
+    return 0;
+}
+
+/**
+ * Tracer: a set of per-thread trace rings
+ */
+struct wtmlib_Tracer
+{
+    /* Protects the lists of rings, "released_num_dropped" and the "is_released" flags
+       of the rings */
+    pthread_mutex_t mutex;
+    /* List of rings attached to the tracer (the most recently created ring goes first) */
+    wtmlib_TraceRing_t *rings;
+    /* List of released rings that were drained and detached from the tracer. Such rings
+       are reused by wtmlib_CreateTraceRing() */
+    wtmlib_TraceRing_t *free_rings;
+    /* Number of records dropped by the rings that were detached from the tracer */
+    uint64_t released_num_dropped;
+    /* Key whose destructor releases the ring of an exiting thread (see
+       wtmlib_GetThreadTraceRing()) */
+    pthread_key_t thread_key;
+    /* Number of rings created so far */
+    int num_rings;
+    /* Number of records per ring (a power of 2) */
+    uint64_t ring_capacity;
+    /* TSC value at the moment of the tracer creation */
+    uint64_t start_tsc;
+    /* Cache line size */
+    int cline_size;
+};
+
+/**
+ * Release the trace ring of an exiting thread
+ *
+ * Called as a destructor of the thread-specific key of the tracer
+ */
+static void wtmlib_ReleaseThreadTraceRing( void *arg)
+{
+    wtmlib_ReleaseTraceRing( (wtmlib_TraceRing_t*)arg);
+
+    return;
+}
+
+/**
+ * Create a tracer
+ */
+int wtmlib_CreateTracer( uint64_t ring_capacity,
+                         wtmlib_Tracer_t **tracer_ret,
+                         char *err_msg,
+                         int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    wtmlib_Tracer_t *tracer = 0;
+    uint64_t capacity = 1;
+    int cline_size = 0;
+
+    if ( !ring_capacity || ring_capacity > WTMLIB_TRACE_MAX_RING_CAPACITY )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Ring capacity must be in the range "
+                         "[1, %llu]", WTMLIB_TRACE_MAX_RING_CAPACITY);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    while ( capacity < ring_capacity ) capacity <<= 1;
+
+    cline_size = wtmlib_GetCacheLineSize( local_err_msg, sizeof( local_err_msg));
+
+    if ( cline_size < 0 )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't obtain cache line size: %s",
+                         local_err_msg);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    /* "sysconf()" may report 0 if the cache line size is unknown */
+    if ( cline_size < (int)sizeof( uint64_t) * 4 ) cline_size = sizeof( uint64_t) * 4;
+
+    tracer = (wtmlib_Tracer_t*)calloc( 1, sizeof( wtmlib_Tracer_t));
+
+    if ( !tracer )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory for a tracer");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    if ( pthread_key_create( &tracer->thread_key, wtmlib_ReleaseThreadTraceRing) )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't create a thread-specific key "
+                         "of the tracer");
+        free( tracer);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    pthread_mutex_init( &tracer->mutex, 0);
+    tracer->rings = 0;
+    tracer->free_rings = 0;
+    tracer->released_num_dropped = 0;
+    tracer->num_rings = 0;
+    tracer->ring_capacity = capacity;
+    tracer->cline_size = cline_size;
+    tracer->start_tsc = WTMLIB_GET_TSC();
+    WTMLIB_OUT( "Created a tracer with %lu records per ring\n", capacity);
+
+    if ( tracer_ret )
+    {
+        *tracer_ret = tracer;
+    } else
+    {
+        wtmlib_DestroyTracer( tracer);
+    }
+
+    return 0;
+}
+
+/**
+ * Create a new trace ring and attach it to the tracer
+ */
+int wtmlib_CreateTraceRing( wtmlib_Tracer_t *tracer,
+                            wtmlib_TraceRing_t **ring_ret,
+                            char *err_msg,
+                            int err_msg_size)
+{
+    wtmlib_TraceRing_t *ring = 0;
+    char *lines = 0;
+    int cline_size = 0;
+    uint64_t records_size = 0;
+    int ret = 0;
+
+    if ( !tracer )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Tracer is not specified");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    cline_size = tracer->cline_size;
+    pthread_mutex_lock( &tracer->mutex);
+    ring = tracer->free_rings;
+
+    if ( ring )
+    {
+        /* The ring is not accessed by anybody else. Its records were touched already */
+        tracer->free_rings = ring->next;
+        memset( ring->prod, 0, 2 * cline_size);
+        ring->is_released = false;
+        ring->id = tracer->num_rings++;
+        ring->next = tracer->rings;
+        tracer->rings = ring;
+        pthread_mutex_unlock( &tracer->mutex);
+
+        goto create_trace_ring_out;
+    }
+
+    pthread_mutex_unlock( &tracer->mutex);
+    /* Size of the array of records rounded up to the cache line size */
+    records_size = tracer->ring_capacity * sizeof( wtmlib_TraceRecord_t);
+    records_size = (records_size + cline_size - 1) / cline_size * cline_size;
+    /* The ring's descriptor is not modified after creation. Thus, it's not aligned to
+       the cache line size. The producer's counters, the consumer's counters, and the
+       array of records are modified concurrently by different threads. So, each of them
+       starts at a separate cache line */
+    ring = (wtmlib_TraceRing_t*)calloc( 1, sizeof( wtmlib_TraceRing_t));
+    lines = (char*)aligned_alloc( cline_size, 2 * cline_size + records_size);
+
+    if ( !ring || !lines )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory for a trace "
+                         "ring");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto create_trace_ring_out;
+    }
+
+    memset( lines, 0, 2 * cline_size);
+    ring->prod = (uint64_t*)lines;
+    ring->cons = (uint64_t*)(lines + cline_size);
+    ring->records = (wtmlib_TraceRecord_t*)(lines + 2 * cline_size);
+    ring->mask = tracer->ring_capacity - 1;
+    ring->is_released = false;
+    ring->tracer = tracer;
+    /* Touch all the records in advance, so that page faults don't happen when records
+       are appended */
+    memset( ring->records, 0, records_size);
+
+    /* The new ring is added to the head of the list. Thus, descriptors of the rings
+       already in use are never modified */
+    pthread_mutex_lock( &tracer->mutex);
+    ring->id = tracer->num_rings++;
+    ring->next = tracer->rings;
+    tracer->rings = ring;
+    pthread_mutex_unlock( &tracer->mutex);
+
+create_trace_ring_out:
+    if ( ret )
+    {
+        if ( ring ) free( ring);
+
+        if ( lines ) free( lines);
+    } else if ( ring_ret )
+    {
+        *ring_ret = ring;
+    }
+
+    return ret;
+}
+
+/**
+ * Release a trace ring that is not going to be used by its producer anymore
+ */
+void wtmlib_ReleaseTraceRing( wtmlib_TraceRing_t *ring)
+{
+    if ( !ring ) return;
+
+    /* The mutex also makes the records appended by the producer visible to the next
+       wtmlib_DrainTrace() that sees the flag */
+    pthread_mutex_lock( &ring->tracer->mutex);
+    ring->is_released = true;
+    pthread_mutex_unlock( &ring->tracer->mutex);
+
+    return;
+}
+
+/**
+ * Get the trace ring of the calling thread
+ */
+int wtmlib_GetThreadTraceRing( wtmlib_Tracer_t *tracer,
+                               wtmlib_TraceRing_t **ring_ret,
+                               char *err_msg,
+                               int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    wtmlib_TraceRing_t *ring = 0;
+
+    if ( !tracer )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Tracer is not specified");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    ring = (wtmlib_TraceRing_t*)pthread_getspecific( tracer->thread_key);
+
+    if ( !ring )
+    {
+        if ( wtmlib_CreateTraceRing( tracer, &ring, local_err_msg,
+                                     sizeof( local_err_msg)) )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't create a trace ring of the "
+                             "thread: %s", local_err_msg);
+
+            return WTMLIB_RET_GENERIC_ERR;
+        }
+
+        if ( pthread_setspecific( tracer->thread_key, ring) )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't bind the trace ring to the "
+                             "thread");
+            wtmlib_ReleaseTraceRing( ring);
+
+            return WTMLIB_RET_GENERIC_ERR;
+        }
+    }
+
+    if ( ring_ret ) *ring_ret = ring;
+
+    return 0;
+}
+
+/**
+ * Read records from all rings of the tracer and convert them to nanoseconds
+ */
+int wtmlib_DrainTrace( wtmlib_Tracer_t *tracer,
+                       const wtmlib_TSCConversionParams_t *conv_params,
+                       wtmlib_TraceEvent_t *events,
+                       int max_events,
+                       int *num_events_ret,
+                       uint64_t *num_dropped_ret,
+                       char *err_msg,
+                       int err_msg_size)
+{
+    wtmlib_TraceRing_t **link = 0;
+    int num_events = 0;
+    uint64_t num_dropped = 0;
+
+    if ( !tracer || !conv_params || (max_events > 0 && !events) )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Tracer, conversion parameters, or "
+                         "event buffer is not specified");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    pthread_mutex_lock( &tracer->mutex);
+    link = &tracer->rings;
+
+    while ( *link )
+    {
+        wtmlib_TraceRing_t *ring = *link;
+        uint64_t head = __atomic_load_n( ring->prod, __ATOMIC_ACQUIRE);
+        uint64_t tail = ring->cons[0];
+
+        WTMLIB_ASSERT( head - tail <= ring->mask + 1);
+        num_dropped += __atomic_load_n( &ring->prod[2], __ATOMIC_RELAXED);
+
+        for ( ; tail != head && num_events < max_events; tail++ )
+        {
+            const wtmlib_TraceRecord_t *record = &ring->records[tail & ring->mask];
+            wtmlib_TraceEvent_t *event = &events[num_events++];
+            uint64_t tsc_ticks = record->tsc > tracer->start_tsc ?
+                                 record->tsc - tracer->start_tsc : 0;
+
+            event->nsec = WTMLIB_TSC_TO_NSEC( tsc_ticks, conv_params);
+            event->payload = record->payload;
+            event->event_id = record->event_id;
+            event->ring_id = ring->id;
+        }
+
+        /* Hand the consumed slots back to the producer */
+        __atomic_store_n( ring->cons, tail, __ATOMIC_RELEASE);
+
+        /* The producer of a released ring doesn't append records anymore. So, an empty
+           released ring can be detached and reused */
+        if ( ring->is_released && tail == head )
+        {
+            tracer->released_num_dropped += ring->prod[2];
+            *link = ring->next;
+            ring->next = tracer->free_rings;
+            tracer->free_rings = ring;
+
+            continue;
+        }
+
+        link = &ring->next;
+    }
+
+    num_dropped += tracer->released_num_dropped;
+    pthread_mutex_unlock( &tracer->mutex);
+
+    if ( num_events_ret ) *num_events_ret = num_events;
+
+    if ( num_dropped_ret ) *num_dropped_ret = num_dropped;
+
+    return 0;
+}
+
+/**
+ * Deallocate a list of trace rings
+ */
+static void wtmlib_FreeTraceRings( wtmlib_TraceRing_t *ring)
+{
+    while ( ring )
+    {
+        wtmlib_TraceRing_t *next = ring->next;
+
+        /* Counters and records were allocated as a single block */
+        free( ring->prod);
+        free( ring);
+        ring = next;
+    }
+
+    return;
+}
+
+/**
+ * Destroy the tracer and all its rings
+ */
+void wtmlib_DestroyTracer( wtmlib_Tracer_t *tracer)
+{
+    if ( !tracer ) return;
+
+    /* Destructors are not called for a deleted key. So, exiting threads don't touch the
+       rings deallocated below */
+    pthread_key_delete( tracer->thread_key);
+    wtmlib_FreeTraceRings( tracer->rings);
+    wtmlib_FreeTraceRings( tracer->free_rings);
+    pthread_mutex_destroy( &tracer->mutex);
+    free( tracer);
+
+    return;
+}
+
+/**
+ * Create a trace file and map it to memory
+ */
+int wtmlib_CreateTraceFile( const char *path,
+                            uint64_t capacity,
+                            const wtmlib_TSCConversionParams_t *conv_params,
+                            const wtmlib_TSCOffsetTable_t *offset_table,
+                            wtmlib_TraceFile_t **file_ret,
+                            char *err_msg,
+                            int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    wtmlib_TraceFile_t *file = 0;
+    wtmlib_TraceFileHeader_t *header = 0;
+    int num_cpus = offset_table ? offset_table->num_cpus : 0;
+    uint64_t counter_offset = 0;
+    uint64_t records_offset = 0;
+    uint64_t map_size = 0;
+    void *map_addr = MAP_FAILED;
+    int fd = -1;
+    long page_size = sysconf( _SC_PAGESIZE);
+    int cline_size = 0;
+    int ret = 0;
+
+    if ( !path || !conv_params )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Path or conversion parameters are not "
+                         "specified");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    if ( !capacity || capacity > WTMLIB_TRACE_FILE_MAX_CAPACITY )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Trace file capacity must be in the "
+                         "range [1, %llu]", WTMLIB_TRACE_FILE_MAX_CAPACITY);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    ret = wtmlib_CheckTSCAndCPUReading( get_nprocs_conf(), local_err_msg,
+                                        sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Trace records cannot be written: %s",
+                         local_err_msg);
+
+        return ret;
+    }
+
+    cline_size = wtmlib_GetCacheLineSize( local_err_msg, sizeof( local_err_msg));
+
+    if ( cline_size < 0 || page_size <= 0 )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't obtain cache line size or "
+                         "page size");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    if ( cline_size < (int)sizeof( uint64_t) ) cline_size = sizeof( uint64_t);
+
+    /* The records counter is modified concurrently with appending records. Thus, it
+       occupies a separate cache line. Records start at a page boundary */
+    counter_offset = sizeof( wtmlib_TraceFileHeader_t) + num_cpus * sizeof( int64_t);
+    counter_offset = (counter_offset + cline_size - 1) / cline_size * cline_size;
+    records_offset = counter_offset + cline_size;
+    records_offset = (records_offset + page_size - 1) / page_size * page_size;
+    map_size = records_offset + capacity * sizeof( wtmlib_TraceFileRecord_t);
+    file = (wtmlib_TraceFile_t*)calloc( 1, sizeof( wtmlib_TraceFile_t));
+
+    if ( !file )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory for a trace "
+                         "file descriptor");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto create_trace_file_out;
+    }
+
+    fd = open( path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if ( fd == -1 )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't open \"%s\": %s", path,
+                         WTMLIB_STRERROR_R( local_err_msg, sizeof( local_err_msg)));
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto create_trace_file_out;
+    }
+
+    /* Disk space is allocated in advance. Otherwise, the producer may get SIGBUS when
+       touching a page of a sparse file on a full file system */
+    ret = posix_fallocate( fd, 0, map_size);
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't preallocate %lu bytes for "
+                         "\"%s\": %s", map_size, path,
+                         strerror_r( ret, local_err_msg, sizeof( local_err_msg)));
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto create_trace_file_out;
+    }
+
+    /* Pages are populated in advance, so that appending records doesn't cause page
+       faults */
+    map_addr = mmap( 0, map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                     0);
+
+    if ( map_addr == MAP_FAILED )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't map \"%s\" to memory: %s", path,
+                         WTMLIB_STRERROR_R( local_err_msg, sizeof( local_err_msg)));
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto create_trace_file_out;
+    }
+
+    header = (wtmlib_TraceFileHeader_t*)map_addr;
+    memcpy( header->magic, WTMLIB_TRACE_FILE_MAGIC, sizeof( header->magic));
+    header->version = WTMLIB_TRACE_FILE_VERSION;
+    header->record_size = sizeof( wtmlib_TraceFileRecord_t);
+    header->capacity = capacity;
+    header->counter_offset = counter_offset;
+    header->records_offset = records_offset;
+    header->conv_params = *conv_params;
+    header->num_cpus = num_cpus;
+    header->base_cpu = offset_table ? offset_table->base_cpu : -1;
+    header->max_uncertainty = offset_table ? offset_table->max_uncertainty : 0;
+
+    if ( num_cpus )
+    {
+        memcpy( header + 1, offset_table->offsets, num_cpus * sizeof( int64_t));
+        header->start_tsc = WTMLIB_GET_TSC_CORRECTED( offset_table);
+    } else
+    {
+        header->start_tsc = WTMLIB_GET_TSC();
+    }
+
+    file->records = (wtmlib_TraceFileRecord_t*)((char*)map_addr + records_offset);
+    file->capacity = capacity;
+    file->num_records = (uint64_t*)((char*)map_addr + counter_offset);
+    file->map_addr = map_addr;
+    file->map_size = map_size;
+    file->fd = fd;
+    WTMLIB_OUT( "Created trace file \"%s\" for %lu records (%lu bytes)\n", path, capacity,
+                map_size);
+
+create_trace_file_out:
+    if ( ret || !file_ret )
+    {
+        if ( map_addr != MAP_FAILED ) munmap( map_addr, map_size);
+
+        if ( fd != -1 ) close( fd);
+
+        if ( file ) free( file);
+    } else
+    {
+        *file_ret = file;
+    }
+
+    return ret;
+}
+
+/**
+ * Flush a trace file to disk, unmap it and close it
+ */
+int wtmlib_CloseTraceFile( wtmlib_TraceFile_t *file,
+                           char *err_msg,
+                           int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    int ret = 0;
+
+    if ( !file ) return 0;
+
+    if ( msync( file->map_addr, file->map_size, MS_SYNC) )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't flush the trace file: %s",
+                         WTMLIB_STRERROR_R( local_err_msg, sizeof( local_err_msg)));
+        ret = WTMLIB_RET_GENERIC_ERR;
+    }
+
+    munmap( file->map_addr, file->map_size);
+
+    if ( close( file->fd) && !ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't close the trace file: %s",
+                         WTMLIB_STRERROR_R( local_err_msg, sizeof( local_err_msg)));
+        ret = WTMLIB_RET_GENERIC_ERR;
+    }
+
+    free( file);
+
+    return ret;
+}
+
+/**
+ * Create a histogram of TSC tick deltas
+ */
+int wtmlib_CreateHistogram( const wtmlib_TSCConversionParams_t *conv_params,
+                            wtmlib_Histogram_t *hist_ret,
+                            char *err_msg,
+                            int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    wtmlib_Histogram_t hist = {.counts = 0, .bucket_nsecs = 0, .num_buckets = 0,
+                               .sub_bucket_bits = WTMLIB_HISTOGRAM_SUB_BUCKET_BITS};
+    int sub_buckets = 1 << hist.sub_bucket_bits;
+    uint64_t counts_size = 0;
+    int cline_size = 0;
+    int ret = 0;
+
+    WTMLIB_ASSERT( hist.sub_bucket_bits >= 1 && hist.sub_bucket_bits <= 16);
+
+    if ( !conv_params )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Conversion parameters are not "
+                         "specified");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    cline_size = wtmlib_GetCacheLineSize( local_err_msg, sizeof( local_err_msg));
+
+    if ( cline_size < 0 )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't obtain cache line size: %s",
+                         local_err_msg);
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    if ( cline_size < (int)sizeof( uint64_t) ) cline_size = sizeof( uint64_t);
+
+    /* Values with the most significant bit at position "sub_bucket_bits" or lower are
+       stored exactly (there are 2 * sub_buckets such values). Each of the remaining
+       (63 - sub_bucket_bits) powers of 2 is split into "sub_buckets" buckets */
+    hist.num_buckets = (65 - hist.sub_bucket_bits) * sub_buckets;
+    counts_size = hist.num_buckets * sizeof( uint64_t);
+    counts_size = (counts_size + cline_size - 1) / cline_size * cline_size;
+    /* The counters are modified by the owner thread. They don't share cache lines with
+       any other data */
+    hist.counts = (uint64_t*)aligned_alloc( cline_size, counts_size);
+    hist.bucket_nsecs = (uint64_t*)calloc( sizeof( uint64_t), hist.num_buckets);
+
+    if ( !hist.counts || !hist.bucket_nsecs )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory for a "
+                         "histogram");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto create_histogram_out;
+    }
+
+    memset( hist.counts, 0, counts_size);
+
+    for ( int i = 0; i < hist.num_buckets; i++ )
+    {
+        uint64_t upper_bound = i;
+
+        if ( i >= sub_buckets )
+        {
+            /* See wtmlib_GetHistogramBucketIndex() */
+            int exp = i / sub_buckets - 1;
+            uint64_t mantissa = i - exp * sub_buckets;
+
+            /* Wraps to UINT64_MAX for the last bucket */
+            upper_bound = ((mantissa + 1) << exp) - 1;
+        }
+
+        WTMLIB_ASSERT( wtmlib_GetHistogramBucketIndex( hist.sub_bucket_bits,
+                                                       upper_bound) == i);
+        hist.bucket_nsecs[i] = WTMLIB_TSC_TO_NSEC( upper_bound, conv_params);
+    }
+
+create_histogram_out:
+    if ( ret || !hist_ret )
+    {
+        wtmlib_FreeHistogram( &hist);
+    } else
+    {
+        *hist_ret = hist;
+    }
+
+    return ret;
+}
+
+/**
+ * Release memory allocated by "wtmlib_CreateHistogram()"
+ */
+void wtmlib_FreeHistogram( wtmlib_Histogram_t *hist)
+{
+    if ( !hist ) return;
+
+    if ( hist->counts ) free( hist->counts);
+
+    if ( hist->bucket_nsecs ) free( hist->bucket_nsecs);
+
+    hist->counts = 0;
+    hist->bucket_nsecs = 0;
+    hist->num_buckets = 0;
+
+    return;
+}
+
+/**
+ * Zero all counters of the histogram
+ */
+void wtmlib_ResetHistogram( wtmlib_Histogram_t *hist)
+{
+    if ( !hist || !hist->counts ) return;
+
+    for ( int i = 0; i < hist->num_buckets; i++ )
+    {
+        __atomic_store_n( &hist->counts[i], 0, __ATOMIC_RELAXED);
+    }
+
+    return;
+}
+
+/**
+ * Add counters of histogram "src" to histogram "dst"
+ */
+int wtmlib_MergeHistogram( wtmlib_Histogram_t *dst,
+                           const wtmlib_Histogram_t *src,
+                           char *err_msg,
+                           int err_msg_size)
+{
+    if ( !dst || !src || !dst->counts || !src->counts )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Histogram is not specified");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    if ( dst->num_buckets != src->num_buckets ||
+         dst->sub_bucket_bits != src->sub_bucket_bits )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Histograms have different layouts");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    for ( int i = 0; i < src->num_buckets; i++ )
+    {
+        uint64_t count = __atomic_load_n( &src->counts[i], __ATOMIC_RELAXED);
+
+        __atomic_store_n( &dst->counts[i], dst->counts[i] + count, __ATOMIC_RELAXED);
+    }
+
+    return 0;
+}
+
+/**
+ * Get values (in nanoseconds) at the given percentiles of the histogram
+ */
+int wtmlib_GetHistogramPercentiles( const wtmlib_Histogram_t *hist,
+                                    const double *percentiles,
+                                    int num_percentiles,
+                                    uint64_t *nsecs,
+                                    uint64_t *total_count_ret,
+                                    char *err_msg,
+                                    int err_msg_size)
+{
+    uint64_t *counts = 0;
+    uint64_t total_count = 0;
+    int ret = 0;
+
+    if ( !hist || !hist->counts || (num_percentiles > 0 && !percentiles) )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Histogram or percentiles are not "
+                         "specified");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    for ( int i = 0; i < num_percentiles; i++ )
+    {
+        if ( !(percentiles[i] >= 0.0 && percentiles[i] <= 100.0) )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Percentile %f is out of the range "
+                             "[0, 100]", percentiles[i]);
+
+            return WTMLIB_RET_GENERIC_ERR;
+        }
+    }
+
+    /* The histogram may be concurrently recorded to. The counters are copied, so that
+       all percentiles are computed from the same snapshot */
+    counts = (uint64_t*)calloc( sizeof( uint64_t), hist->num_buckets);
+
+    if ( !counts )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory for a copy of "
+                         "histogram counters");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    for ( int i = 0; i < hist->num_buckets; i++ )
+    {
+        counts[i] = __atomic_load_n( &hist->counts[i], __ATOMIC_RELAXED);
+        total_count += counts[i];
+    }
+
+    if ( !total_count )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "The histogram is empty");
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto get_histogram_percentiles_out;
+    }
+
+    for ( int i = 0; nsecs && i < num_percentiles; i++ )
+    {
+        /* Number of values that must be less than or equal to the result */
+        uint64_t rank = (uint64_t)ceil( percentiles[i] / 100.0 * total_count);
+        uint64_t cumulative_count = 0;
+        int bucket = 0;
+
+        if ( !rank ) rank = 1;
+
+        for ( bucket = 0; bucket < hist->num_buckets - 1; bucket++ )
+        {
+            cumulative_count += counts[bucket];
+
+            if ( cumulative_count >= rank ) break;
+        }
+
+        nsecs[i] = hist->bucket_nsecs[bucket];
+    }
+
+    if ( total_count_ret ) *total_count_ret = total_count;
+
+get_histogram_percentiles_out:
+    free( counts);
+
+    return ret;
+}
+
+/**
+ * Type of a kernel that converts an array of TSC values to nanoseconds
+ *
+ * "base_tsc" is subtracted from each TSC value before the conversion. TSC values that
+ * don't exceed "base_tsc" are converted to zero
+ */
+typedef void (*wtmlib_TSCToNsecBatchKernel_t)( const uint64_t *tscs,
+                                               uint64_t *nsecs,
+                                               size_t count,
+                                               uint64_t base_tsc,
+                                               const wtmlib_TSCConversionParams_t
+                                                   *conv_params);
+
+/**
+ * Convert an array of TSC values to nanoseconds (portable version)
+ */
+static void wtmlib_TSCToNsecBatchScalar( const uint64_t *tscs,
+                                         uint64_t *nsecs,
+                                         size_t count,
+                                         uint64_t base_tsc,
+                                         const wtmlib_TSCConversionParams_t *conv_params)
+{
+    /* Local copy lets the compiler keep the parameters in registers even if "nsecs"
+       aliases the parameters in its view */
+    wtmlib_TSCConversionParams_t cp = *conv_params;
+
+    for ( size_t i = 0; i < count; i++ )
+    {
+        uint64_t ticks = tscs[i] > base_tsc ? tscs[i] - base_tsc : 0;
+
+        nsecs[i] = WTMLIB_TSC_TO_NSEC( ticks, &cp);
+    }
+
+    return;
+}
+
+#ifdef WTMLIB_X86_EXTENSIONS
+/**
+ * Multiply each 64-bit element of "a" by the corresponding element of "b" keeping the
+ * lower 64 bits of the product
+ *
+ * AVX2 doesn't provide a 64-bit multiplication. The product is assembled from 32-bit
+ * multiplications: a * b = lo(a) * lo(b) + ((hi(a) * lo(b) + lo(a) * hi(b)) << 32)
+ */
+__attribute__((target("avx2")))
+static inline __m256i wtmlib_MulLo64AVX2( __m256i a,
+                                          __m256i b)
+{
+    __m256i lo_lo = _mm256_mul_epu32( a, b);
+    __m256i hi_lo = _mm256_mul_epu32( _mm256_srli_epi64( a, 32), b);
+    __m256i lo_hi = _mm256_mul_epu32( a, _mm256_srli_epi64( b, 32));
+
+    return _mm256_add_epi64( lo_lo,
+                             _mm256_slli_epi64( _mm256_add_epi64( hi_lo, lo_hi), 32));
+}
+
+/**
+ * Convert an array of TSC values to nanoseconds (AVX2 version)
+ */
+__attribute__((target("avx2")))
+static void wtmlib_TSCToNsecBatchAVX2( const uint64_t *tscs,
+                                       uint64_t *nsecs,
+                                       size_t count,
+                                       uint64_t base_tsc,
+                                       const wtmlib_TSCConversionParams_t *conv_params)
+{
+    /* AVX2 provides only signed 64-bit comparison. Unsigned comparison is done by
+       flipping sign bits of both operands */
+    const __m256i sign_bit = _mm256_set1_epi64x( INT64_MIN);
+    const __m256i base = _mm256_set1_epi64x( (int64_t)base_tsc);
+    const __m256i signed_base = _mm256_xor_si256( base, sign_bit);
+    const __m256i mult = _mm256_set1_epi64x( (int64_t)conv_params->mult);
+    const __m256i nsecs_per_tsc_modulus =
+        _mm256_set1_epi64x( (int64_t)conv_params->nsecs_per_tsc_modulus);
+    const __m256i tsc_remainder_bitmask =
+        _mm256_set1_epi64x( (int64_t)conv_params->tsc_remainder_bitmask);
+    const __m128i shift = _mm_cvtsi32_si128( conv_params->shift);
+    const __m128i tsc_remainder_length =
+        _mm_cvtsi32_si128( conv_params->tsc_remainder_length);
+    size_t i = 0;
+
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        __m256i tsc = _mm256_loadu_si256( (const __m256i*)(tscs + i));
+        __m256i is_above_base = _mm256_cmpgt_epi64( _mm256_xor_si256( tsc, sign_bit),
+                                                    signed_base);
+        __m256i ticks = _mm256_and_si256( _mm256_sub_epi64( tsc, base), is_above_base);
+        __m256i moduli = _mm256_srl_epi64( ticks, tsc_remainder_length);
+        __m256i remainder = _mm256_and_si256( ticks, tsc_remainder_bitmask);
+        __m256i nsec = _mm256_add_epi64( wtmlib_MulLo64AVX2( moduli,
+                                                             nsecs_per_tsc_modulus),
+                                         _mm256_srl_epi64( wtmlib_MulLo64AVX2( remainder,
+                                                                               mult),
+                                                           shift));
+
+        _mm256_storeu_si256( (__m256i*)(nsecs + i), nsec);
+    }
+
+    wtmlib_TSCToNsecBatchScalar( tscs + i, nsecs + i, count - i, base_tsc, conv_params);
+
+    return;
+}
+
+/**
+ * Convert an array of TSC values to nanoseconds (AVX-512 version)
+ */
+__attribute__((target("avx512f,avx512dq")))
+static void wtmlib_TSCToNsecBatchAVX512( const uint64_t *tscs,
+                                         uint64_t *nsecs,
+                                         size_t count,
+                                         uint64_t base_tsc,
+                                         const wtmlib_TSCConversionParams_t *conv_params)
+{
+    const __m512i base = _mm512_set1_epi64( (int64_t)base_tsc);
+    const __m512i mult = _mm512_set1_epi64( (int64_t)conv_params->mult);
+    const __m512i nsecs_per_tsc_modulus =
+        _mm512_set1_epi64( (int64_t)conv_params->nsecs_per_tsc_modulus);
+    const __m512i tsc_remainder_bitmask =
+        _mm512_set1_epi64( (int64_t)conv_params->tsc_remainder_bitmask);
+    const __m128i shift = _mm_cvtsi32_si128( conv_params->shift);
+    const __m128i tsc_remainder_length =
+        _mm_cvtsi32_si128( conv_params->tsc_remainder_length);
+    /* Zero-masking variants with all lanes enabled are used instead of the plain
+       intrinsics. The plain ones pass an undefined vector as the merge source, which
+       GCC 12 reports as "may be used uninitialized" at -O2 */
+    const __mmask8 all_lanes = (__mmask8)0xff;
+    size_t i = 0;
+
+    for ( ; i + 8 <= count; i += 8 )
+    {
+        __m512i tsc = _mm512_loadu_si512( (const void*)(tscs + i));
+        /* max(tsc, base) - base is zero for values that don't exceed the base */
+        __m512i ticks = _mm512_sub_epi64( _mm512_maskz_max_epu64( all_lanes, tsc, base),
+                                          base);
+        __m512i moduli = _mm512_maskz_srl_epi64( all_lanes, ticks, tsc_remainder_length);
+        __m512i remainder = _mm512_and_si512( ticks, tsc_remainder_bitmask);
+        __m512i nsec =
+            _mm512_add_epi64( _mm512_mullo_epi64( moduli, nsecs_per_tsc_modulus),
+                              _mm512_maskz_srl_epi64( all_lanes,
+                                                      _mm512_mullo_epi64( remainder,
+                                                                          mult),
+                                                      shift));
+
+        _mm512_storeu_si512( (void*)(nsecs + i), nsec);
+    }
+
+    wtmlib_TSCToNsecBatchScalar( tscs + i, nsecs + i, count - i, base_tsc, conv_params);
+
+    return;
+}
+#endif /* WTMLIB_X86_EXTENSIONS */
+
+/**
+ * Get the fastest batch conversion kernel supported by the CPU
+ *
+ * The kernel is chosen once. CPU features are detected by means of CPUID (which also
+ * accounts for whether the OS saves the extended registers)
+ */
+static wtmlib_TSCToNsecBatchKernel_t wtmlib_GetTSCToNsecBatchKernel( void)
+{
+    static wtmlib_TSCToNsecBatchKernel_t batch_kernel = 0;
+    wtmlib_TSCToNsecBatchKernel_t kernel = __atomic_load_n( &batch_kernel,
+                                                            __ATOMIC_RELAXED);
+
+    if ( kernel ) return kernel;
+
+    kernel = wtmlib_TSCToNsecBatchScalar;
+#ifdef WTMLIB_X86_EXTENSIONS
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports( "avx512f") && __builtin_cpu_supports( "avx512dq") )
+    {
+        kernel = wtmlib_TSCToNsecBatchAVX512;
+    } else if ( __builtin_cpu_supports( "avx2") )
+    {
+        kernel = wtmlib_TSCToNsecBatchAVX2;
+    }
+#endif
+    WTMLIB_OUT( "Batch TSC-to-nanoseconds conversion kernel: %s\n",
+                kernel == wtmlib_TSCToNsecBatchScalar ? "scalar" : "SIMD");
+    __atomic_store_n( &batch_kernel, kernel, __ATOMIC_RELAXED);
+
+    return kernel;
+}
+
+/**
+ * Convert an array of TSC values to nanoseconds
+ */
+void wtmlib_TSCToNsecBatch( const uint64_t *tscs,
+                            uint64_t *nsecs,
+                            size_t count,
+                            const wtmlib_TSCConversionParams_t *conv_params)
+{
+    wtmlib_GetTSCToNsecBatchKernel()( tscs, nsecs, count, 0, conv_params);
+
+    return;
+}
+
+/**
+ * Convert an array of TSC values to nanoseconds elapsed since the given TSC value
+ */
+void wtmlib_TSCToNsecBatchDelta( const uint64_t *tscs,
+                                 uint64_t *nsecs,
+                                 size_t count,
+                                 uint64_t base_tsc,
+                                 const wtmlib_TSCConversionParams_t *conv_params)
+{
+    wtmlib_GetTSCToNsecBatchKernel()( tscs, nsecs, count, base_tsc, conv_params);
+
+    return;
+}
+
+/* Estimated latency of waking up from "nanosleep()" (in nanoseconds). Updated by
+   wtmlib_CalibrateSleep() */
+static uint64_t wtmlib_sleep_wakeup_latency = WTMLIB_SLEEP_DEFAULT_WAKEUP_LATENCY;
+
+#ifdef WTMLIB_X86_EXTENSIONS
+/**
+ * Check whether the CPU supports TPAUSE instruction (WAITPKG extension)
+ */
+static bool wtmlib_IsTPAUSESupported( void)
+{
+    /* -1 - not checked yet, 0 - not supported, 1 - supported */
+    static int is_supported = -1;
+    int ret = __atomic_load_n( &is_supported, __ATOMIC_RELAXED);
+
+    if ( ret < 0 )
+    {
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+        ret = __get_cpuid_count( 7, 0, &eax, &ebx, &ecx, &edx) && (ecx & (1u << 5));
+        __atomic_store_n( &is_supported, ret, __ATOMIC_RELAXED);
+    }
+
+    return ret;
+}
+
+/**
+ * Wait until TSC reaches the deadline using TPAUSE
+ *
+ * TPAUSE puts the CPU into a light-weight power-saving state (C0.1, which has the
+ * fastest wake-up) until TSC reaches the deadline. The wait may end earlier (e.g. on an
+ * interrupt or when the OS-defined time limit expires). Hence, the loop
+ */
+__attribute__((target("waitpkg")))
+static void wtmlib_TPAUSEUntilTSC( uint64_t deadline_tsc)
+{
+    while ( WTMLIB_GET_TSC() < deadline_tsc ) _tpause( 1, deadline_tsc);
+
+    return;
+}
+#endif /* WTMLIB_X86_EXTENSIONS */
+
+/**
+ * Spin until TSC reaches the deadline
+ *
+ * The spinning CPU is hinted to save power and to yield resources to sibling hardware
+ * threads: TPAUSE (if supported) or PAUSE on x86-64, low thread priority on PPC64
+ */
+static void wtmlib_SpinUntilTSC( uint64_t deadline_tsc)
+{
+#ifdef WTMLIB_X86_EXTENSIONS
+    if ( wtmlib_IsTPAUSESupported() )
+    {
+        wtmlib_TPAUSEUntilTSC( deadline_tsc);
+
+        return;
+    }
+#endif
+
+#ifdef WTMLIB_ARCH_PPC_64
+    /* Lower priority of the hardware thread */
+    __asm__ __volatile__( "or 1,1,1" ::: "memory");
+#endif
+
+    while ( WTMLIB_GET_TSC() < deadline_tsc )
+    {
+#ifdef WTMLIB_ARCH_X86_64
+        __asm__ __volatile__( "pause" ::: "memory");
+#else
+        __asm__ __volatile__( "" ::: "memory");
+#endif
+    }
+
+#ifdef WTMLIB_ARCH_PPC_64
+    /* Restore normal priority of the hardware thread */
+    __asm__ __volatile__( "or 2,2,2" ::: "memory");
+#endif
+
+    return;
+}
+
+/**
+ * Estimate the latency of waking up from "nanosleep()"
+ */
+int wtmlib_CalibrateSleep( const wtmlib_TSCConversionParams_t *conv_params,
+                           uint64_t *wakeup_latency_ret,
+                           char *err_msg,
+                           int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    uint64_t *latencies = 0;
+    uint64_t wakeup_latency = 0;
+    int ret = 0;
+
+    WTMLIB_OUT( "Calibrating sleep...\n");
+
+    if ( !conv_params )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "TSC-to-nanoseconds conversion "
+                         "parameters must be provided");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    latencies = (uint64_t*)calloc( WTMLIB_SLEEP_CALIBRATION_ROUNDS, sizeof( uint64_t));
+
+    if ( !latencies )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory for sleep "
+                         "latencies");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    for ( int i = 0; i < WTMLIB_SLEEP_CALIBRATION_ROUNDS; i++ )
+    {
+        struct timespec period = {.tv_sec = 0,
+                                  .tv_nsec = WTMLIB_SLEEP_CALIBRATION_PERIOD};
+        uint64_t start_tsc = WTMLIB_GET_TSC();
+
+        if ( nanosleep( &period, 0) )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "A call to 'nanosleep()' failed: "
+                             "%s", WTMLIB_STRERROR_R( local_err_msg,
+                                                      sizeof( local_err_msg)));
+            ret = WTMLIB_RET_GENERIC_ERR;
+
+            goto calibrate_sleep_out;
+        }
+
+        uint64_t elapsed_nsec = WTMLIB_TSC_TO_NSEC( WTMLIB_GET_TSC() - start_tsc,
+                                                    conv_params);
+
+        latencies[i] = elapsed_nsec > WTMLIB_SLEEP_CALIBRATION_PERIOD ?
+                       elapsed_nsec - WTMLIB_SLEEP_CALIBRATION_PERIOD : 0;
+    }
+
+    qsort( latencies, WTMLIB_SLEEP_CALIBRATION_ROUNDS, sizeof( uint64_t),
+           wtmlib_CompareUInt64);
+    /* A high percentile is used. Underestimated latency results in late wake-ups.
+       Overestimated latency just makes spinning longer */
+    wakeup_latency = latencies[(WTMLIB_SLEEP_CALIBRATION_ROUNDS - 1) *
+                               WTMLIB_SLEEP_LATENCY_PERCENTILE / 100];
+    WTMLIB_OUT( "\tWake-up latency: min %lu ns, median %lu ns, estimate %lu ns\n",
+                latencies[0], latencies[WTMLIB_SLEEP_CALIBRATION_ROUNDS / 2],
+                wakeup_latency);
+    __atomic_store_n( &wtmlib_sleep_wakeup_latency, wakeup_latency, __ATOMIC_RELAXED);
+
+    if ( wakeup_latency_ret ) *wakeup_latency_ret = wakeup_latency;
+
+calibrate_sleep_out:
+    free( latencies);
+
+    return ret;
+}
+
+/**
+ * Sleep until TSC reaches the deadline
+ */
+int wtmlib_SleepUntilTSC( uint64_t deadline_tsc,
+                          const wtmlib_TSCConversionParams_t *conv_params,
+                          char *err_msg,
+                          int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    uint64_t wakeup_latency = __atomic_load_n( &wtmlib_sleep_wakeup_latency,
+                                               __ATOMIC_RELAXED);
+    uint64_t tsc = WTMLIB_GET_TSC();
+
+    if ( !conv_params )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "TSC-to-nanoseconds conversion "
+                         "parameters must be provided");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    /* Sleep in the kernel while the remaining time is long enough to absorb the wake-up
+       latency. "nanosleep()" may be interrupted by a signal. Hence, the loop */
+    while ( tsc < deadline_tsc )
+    {
+        uint64_t remaining_nsec = WTMLIB_TSC_TO_NSEC( deadline_tsc - tsc, conv_params);
+
+        uint64_t spin_nsec = wakeup_latency + WTMLIB_SLEEP_MIN_SPIN_TIME;
+
+        if ( remaining_nsec <= spin_nsec ) break;
+
+        uint64_t sleep_nsec = remaining_nsec - spin_nsec;
+        struct timespec period = {.tv_sec = (time_t)(sleep_nsec / 1000000000),
+                                  .tv_nsec = (long)(sleep_nsec % 1000000000)};
+
+        if ( nanosleep( &period, 0) && errno != EINTR )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "A call to 'nanosleep()' failed: "
+                             "%s", WTMLIB_STRERROR_R( local_err_msg,
+                                                      sizeof( local_err_msg)));
+
+            return WTMLIB_RET_GENERIC_ERR;
+        }
+
+        tsc = WTMLIB_GET_TSC();
+    }
+
+    wtmlib_SpinUntilTSC( deadline_tsc);
+
+    return 0;
+}
+
+/**
+ * Sleep for the given number of nanoseconds
+ */
+int wtmlib_SleepForNsec( uint64_t nsecs,
+                         const wtmlib_TSCConversionParams_t *conv_params,
+                         char *err_msg,
+                         int err_msg_size)
+{
+    if ( !conv_params )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "TSC-to-nanoseconds conversion "
+                         "parameters must be provided");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    return wtmlib_SleepUntilTSC( WTMLIB_TSC_DEADLINE( nsecs, conv_params), conv_params,
+                                 err_msg, err_msg_size);
+}
+
+/**
+ * Run a micro-benchmark
+ */
+int wtmlib_RunBenchmark( wtmlib_BenchFunc_t func,
+                         void *arg,
+                         const wtmlib_BenchParams_t *params,
+                         const wtmlib_TSCConversionParams_t *conv_params,
+                         wtmlib_BenchResult_t *result_ret,
+                         char *err_msg,
+                         int err_msg_size)
+{
+    char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+    wtmlib_BenchParams_t bench_params = {.cpu_id = -1,
+                                         .num_warmup_iterations =
+                                             WTMLIB_BENCH_WARMUP_ITERATIONS,
+                                         .num_samples = WTMLIB_BENCH_SAMPLES,
+                                         .iterations_per_sample =
+                                             WTMLIB_BENCH_ITERATIONS_PER_SAMPLE};
+    wtmlib_BenchResult_t result;
+    wtmlib_ProcAndSysState_t ps_state;
+    cpu_set_t *cpu_set = 0;
+    uint64_t *samples = 0;
+    uint64_t num_samples = 0, num_migrations = 0, overhead = 0;
+    uint64_t average = 0, num_good_samples = 0;
+    double std_error = HUGE_VAL, nsecs_per_tick = 0;
+    int ret = 0;
+
+    WTMLIB_OUT( "Running a benchmark...\n");
+    wtmlib_InitProcAndSysState( &ps_state);
+
+    if ( params ) bench_params = *params;
+
+    if ( !func || !conv_params || !conv_params->tsc_ticks_per_sec ||
+         !bench_params.num_samples || !bench_params.iterations_per_sample )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "A benchmarked function, conversion "
+                         "parameters, and non-zero numbers of samples and iterations "
+                         "must be provided");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    /* The overhead of a pair of fenced TSC reads is excluded from every sample */
+    overhead = conv_params->fenced_read_overhead.min;
+
+    if ( !overhead )
+    {
+        ret = wtmlib_GetFencedTSCReadOverhead( &overhead, local_err_msg,
+                                               sizeof( local_err_msg));
+
+        if ( ret )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't measure the overhead of "
+                             "fenced TSC reading: %s", local_err_msg);
+
+            return ret;
+        }
+    }
+
+    samples = (uint64_t*)calloc( bench_params.num_samples, sizeof( uint64_t));
+
+    if ( !samples )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory for samples");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    if ( bench_params.cpu_id >= 0 )
+    {
+        ret = wtmlib_GetProcAndSystemState( &ps_state, local_err_msg,
+                                            sizeof( local_err_msg));
+
+        if ( ret )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't obtain details of the "
+                             "system and process state: %s", local_err_msg);
+
+            goto run_benchmark_out;
+        }
+
+        if ( bench_params.cpu_id >= ps_state.num_cpus ||
+             !CPU_ISSET_S( bench_params.cpu_id, CPU_ALLOC_SIZE( ps_state.num_cpus),
+                           ps_state.initial_cpu_set) )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "CPU %d is not available to the "
+                             "current thread", bench_params.cpu_id);
+            ret = WTMLIB_RET_GENERIC_ERR;
+
+            goto run_benchmark_out;
+        }
+
+        cpu_set = CPU_ALLOC( ps_state.num_cpus);
+
+        if ( !cpu_set )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate CPU set");
+            ret = WTMLIB_RET_GENERIC_ERR;
+
+            goto run_benchmark_out;
+        }
+
+        CPU_ZERO_S( CPU_ALLOC_SIZE( ps_state.num_cpus), cpu_set);
+        CPU_SET_S( bench_params.cpu_id, CPU_ALLOC_SIZE( ps_state.num_cpus), cpu_set);
+        ret = wtmlib_BindThreadToCPU( cpu_set, ps_state.num_cpus, local_err_msg,
+                                      sizeof( local_err_msg));
+
+        if ( ret )
+        {
+            WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't move the current thread "
+                             "to CPU %d: %s", bench_params.cpu_id, local_err_msg);
+
+            goto run_benchmark_out;
+        }
+    }
+
+    if ( bench_params.num_warmup_iterations )
+    {
+        func( arg, bench_params.num_warmup_iterations);
+    }
+
+    while ( num_samples < bench_params.num_samples )
+    {
+        uint64_t start_tsc = WTMLIB_GET_TSC_START();
+
+        func( arg, bench_params.iterations_per_sample);
+
+        uint64_t end_tsc = WTMLIB_GET_TSC_END();
+
+        /* TSC may go backwards if an unpinned thread migrates to a different CPU */
+        if ( end_tsc < start_tsc )
+        {
+            if ( ++num_migrations > bench_params.num_samples )
+            {
+                WTMLIB_BUFF_MSG( err_msg, err_msg_size, "TSC went backwards too many "
+                                 "times. Consider pinning the benchmark to a CPU");
+                ret = WTMLIB_RET_GENERIC_ERR;
+
+                goto run_benchmark_out;
+            }
+
+            continue;
+        }
+
+        samples[num_samples++] = end_tsc - start_tsc > overhead ?
+                                 end_tsc - start_tsc - overhead : 0;
+    }
+
+    ret = wtmlib_CalcFreeFromNoiseAverage( samples, num_samples, &average,
+                                           &num_good_samples, &std_error, local_err_msg,
+                                           sizeof( local_err_msg));
+
+    if ( ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't calculate the average of "
+                         "samples: %s", local_err_msg);
+
+        goto run_benchmark_out;
+    }
+
+    qsort( samples, num_samples, sizeof( uint64_t), wtmlib_CompareUInt64);
+    nsecs_per_tick = 1000000000.0 / conv_params->tsc_ticks_per_sec /
+                     bench_params.iterations_per_sample;
+    result.min_nsec = samples[0] * nsecs_per_tick;
+    result.median_nsec = samples[num_samples / 2] * nsecs_per_tick;
+    result.p99_nsec = samples[(num_samples - 1) * 99 / 100] * nsecs_per_tick;
+    result.max_nsec = samples[num_samples - 1] * nsecs_per_tick;
+    result.mean_nsec = average * nsecs_per_tick;
+    result.std_error_nsec = std_error * nsecs_per_tick;
+    result.num_samples = num_samples;
+    result.num_outliers = num_samples - num_good_samples;
+    WTMLIB_OUT( "\tPer iteration: min %f ns, median %f ns, p99 %f ns, mean %f ns\n",
+                result.min_nsec, result.median_nsec, result.p99_nsec, result.mean_nsec);
+
+run_benchmark_out:
+    if ( ps_state.initial_cpu_set &&
+         wtmlib_RestoreInitialProcState( &ps_state, local_err_msg,
+                                         sizeof( local_err_msg)) && !ret )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't restore initial state of "
+                         "the current process: %s", local_err_msg);
+        ret = WTMLIB_RET_GENERIC_ERR;
+    }
+
+    if ( !ret && result_ret ) *result_ret = result;
+
+    if ( cpu_set ) CPU_FREE( cpu_set);
+
+    free( samples);
+    wtmlib_DeallocProcAndSysState( &ps_state);
+
+    return ret;
+}
+
+/**
+ * A region that is currently executed by a thread
+ */
+typedef struct
+{
+    /* ID of the region. Negative if the region couldn't be registered */
+    int region_id;
+    /* TSC value read when the region was entered */
+    uint64_t start_tsc;
+    /* TSC ticks spent in the direct children of the region */
+    uint64_t child_ticks;
+} wtmlib_ProfilerFrame_t;
+
+/**
+ * Per-thread statistics of a region
+ *
+ * The statistics are updated by the owning thread only. The collector reads them
+ * concurrently. Hence, all the fields except "active_depth" are accessed atomically
+ * (but without read-modify-write operations, since there's a single writer)
+ */
+typedef struct
+{
+    uint64_t num_calls;
+    uint64_t inclusive_ticks;
+    uint64_t exclusive_ticks;
+    /* Number of instances of the region currently executed by the thread. Inclusive
+       time is accounted only when the outermost instance exits. Otherwise, time of
+       recursive calls would be counted more than once */
+    uint64_t active_depth;
+} wtmlib_ProfilerRegionCounters_t;
+
+/**
+ * Profiling state of a thread
+ */
+typedef struct wtmlib_ProfilerThreadState_t
+{
+    /* Next thread in the list of profiled threads */
+    struct wtmlib_ProfilerThreadState_t *next;
+    /* Number of regions currently entered. May exceed WTMLIB_PROFILER_MAX_DEPTH. Regions
+       that don't fit the stack are not profiled */
+    int depth;
+    /* Number of regions that were not profiled because the stack was full */
+    uint64_t num_dropped;
+    wtmlib_ProfilerFrame_t stack[WTMLIB_PROFILER_MAX_DEPTH];
+    wtmlib_ProfilerRegionCounters_t counters[WTMLIB_PROFILER_MAX_REGIONS];
+} wtmlib_ProfilerThreadState_t;
+
+/**
+ * Global state of the profiler
+ */
+typedef struct
+{
+    /* Protects region registration, the list of threads and the statistics of the
+       threads that exited */
+    pthread_mutex_t mutex;
+    /* Number of registered regions. Written under the mutex, read atomically */
+    int num_regions;
+    /* Names of the registered regions */
+    char *region_names[WTMLIB_PROFILER_MAX_REGIONS];
+    /* List of profiled threads that didn't exit yet */
+    wtmlib_ProfilerThreadState_t *threads;
+    /* Whether "thread_key" was created */
+    bool is_thread_key_created;
+    /* Key whose destructor releases the profiling state of an exiting thread */
+    pthread_key_t thread_key;
+    /* Statistics of the threads that exited ("active_depth" is not used) */
+    wtmlib_ProfilerRegionCounters_t retired_counters[WTMLIB_PROFILER_MAX_REGIONS];
+    uint64_t retired_num_dropped;
+} wtmlib_ProfilerControl_t;
+
+static wtmlib_ProfilerControl_t wtmlib_profiler_ctrl = {.mutex =
+                                                            PTHREAD_MUTEX_INITIALIZER,
+                                                        .num_regions = 0,
+                                                        .region_names = {},
+                                                        .threads = 0,
+                                                        .is_thread_key_created = false,
+                                                        .thread_key = 0,
+                                                        .retired_counters = {},
+                                                        .retired_num_dropped = 0};
+
+/* Profiling state of the current thread. The default TLS model is used. In a shared
+   library it requires a function call to access the variable. "initial-exec" model
+   would save about 10 TSC ticks per profiled region, but a library that uses it may fail
+   to load by means of dlopen() */
+static __thread wtmlib_ProfilerThreadState_t *wtmlib_profiler_thread_state = 0;
+
+/**
+ * Register a profiled region
+ */
+int wtmlib_ProfilerRegisterRegion( const char *name,
+                                   int *region_id_ret,
+                                   char *err_msg,
+                                   int err_msg_size)
+{
+    int region_id = -1;
+    int ret = 0;
+
+    if ( !name )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Name of a region must be provided");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    pthread_mutex_lock( &wtmlib_profiler_ctrl.mutex);
+
+    for ( int i = 0; i < wtmlib_profiler_ctrl.num_regions; i++ )
+    {
+        if ( !strcmp( wtmlib_profiler_ctrl.region_names[i], name) )
+        {
+            region_id = i;
+
+            goto profiler_register_region_out;
+        }
+    }
+
+    if ( wtmlib_profiler_ctrl.num_regions >= WTMLIB_PROFILER_MAX_REGIONS )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't register region \"%s\". The "
+                         "maximum number of regions (%d) is already registered", name,
+                         WTMLIB_PROFILER_MAX_REGIONS);
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto profiler_register_region_out;
+    }
+
+    region_id = wtmlib_profiler_ctrl.num_regions;
+    wtmlib_profiler_ctrl.region_names[region_id] = strdup( name);
+
+    if ( !wtmlib_profiler_ctrl.region_names[region_id] )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Couldn't allocate memory for the name "
+                         "of region \"%s\"", name);
+        ret = WTMLIB_RET_GENERIC_ERR;
+
+        goto profiler_register_region_out;
+    }
+
+    __atomic_store_n( &wtmlib_profiler_ctrl.num_regions, region_id + 1,
+                      __ATOMIC_RELEASE);
+
+profiler_register_region_out:
+    pthread_mutex_unlock( &wtmlib_profiler_ctrl.mutex);
+
+    if ( !ret && region_id_ret ) *region_id_ret = region_id;
+
+    return ret;
+}
+
+/**
+ * Release profiling state of an exiting thread
+ *
+ * Called as a destructor of the thread-specific key. Statistics of the thread are added
+ * to the statistics of the threads that exited. Then the state is removed from the list
+ * of threads and deallocated
+ */
+static void wtmlib_ProfilerReleaseThreadState( void *arg)
+{
+    wtmlib_ProfilerThreadState_t *state = (wtmlib_ProfilerThreadState_t*)arg;
+    wtmlib_ProfilerControl_t *ctrl = &wtmlib_profiler_ctrl;
+
+    pthread_mutex_lock( &ctrl->mutex);
+
+    for ( int i = 0; i < ctrl->num_regions; i++ )
+    {
+        ctrl->retired_counters[i].num_calls += state->counters[i].num_calls;
+        ctrl->retired_counters[i].inclusive_ticks += state->counters[i].inclusive_ticks;
+        ctrl->retired_counters[i].exclusive_ticks += state->counters[i].exclusive_ticks;
+    }
+
+    ctrl->retired_num_dropped += state->num_dropped;
+
+    for ( wtmlib_ProfilerThreadState_t **link = &ctrl->threads; *link;
+          link = &(*link)->next )
+    {
+        if ( *link == state )
+        {
+            *link = state->next;
+
+            break;
+        }
+    }
+
+    pthread_mutex_unlock( &ctrl->mutex);
+
+    /* Destructors of other thread-specific data may still use the profiler. In that
+       case a new state is allocated (and released by another destructor iteration) */
+    wtmlib_profiler_thread_state = 0;
+    free( state);
+
+    return;
+}
+
+/**
+ * Allocate profiling state of the current thread
+ *
+ * Returns zero if the state couldn't be allocated
+ */
+static __attribute__((noinline)) wtmlib_ProfilerThreadState_t
+    *wtmlib_ProfilerInitThreadState( void)
+{
+    wtmlib_ProfilerControl_t *ctrl = &wtmlib_profiler_ctrl;
+    wtmlib_ProfilerThreadState_t *state =
+        (wtmlib_ProfilerThreadState_t*)calloc( 1, sizeof( wtmlib_ProfilerThreadState_t));
+
+    if ( !state ) return 0;
+
+    pthread_mutex_lock( &ctrl->mutex);
+
+    if ( !ctrl->is_thread_key_created )
+    {
+        if ( pthread_key_create( &ctrl->thread_key, wtmlib_ProfilerReleaseThreadState) )
+        {
+            goto profiler_init_thread_state_fail;
+        }
+
+        ctrl->is_thread_key_created = true;
+    }
+
+    if ( pthread_setspecific( ctrl->thread_key, state) )
+    {
+        goto profiler_init_thread_state_fail;
+    }
+
+    state->next = ctrl->threads;
+    ctrl->threads = state;
+    pthread_mutex_unlock( &ctrl->mutex);
+    wtmlib_profiler_thread_state = state;
+
+    return state;
+
+profiler_init_thread_state_fail:
+    pthread_mutex_unlock( &ctrl->mutex);
+    free( state);
+
+    return 0;
+}
+
+/**
+ * Enter a profiled region
+ */
+void wtmlib_ProfilerEnter( int region_id)
+{
+    wtmlib_ProfilerThreadState_t *state = wtmlib_profiler_thread_state;
+
+    if ( __builtin_expect( !state, 0) )
+    {
+        state = wtmlib_ProfilerInitThreadState();
+
+        if ( !state ) return;
+    }
+
+    int depth = state->depth++;
+
+    if ( __builtin_expect( depth >= WTMLIB_PROFILER_MAX_DEPTH, 0) )
+    {
+        __atomic_store_n( &state->num_dropped, state->num_dropped + 1, __ATOMIC_RELAXED);
+
+        return;
+    }
+
+    wtmlib_ProfilerFrame_t *frame = &state->stack[depth];
+
+    if ( region_id < 0 || region_id >= WTMLIB_PROFILER_MAX_REGIONS ) region_id = -1;
+
+    if ( region_id >= 0 ) state->counters[region_id].active_depth++;
+
+    frame->region_id = region_id;
+    frame->child_ticks = 0;
+    /* TSC is read as late as possible, so that the bookkeeping above is not attributed
+       to the region */
+    frame->start_tsc = WTMLIB_GET_TSC();
+}
+
+/**
+ * Exit the most recently entered profiled region
+ */
+void wtmlib_ProfilerExit( void)
+{
+    /* TSC is read as early as possible, so that the bookkeeping below is not attributed
+       to the region */
+    uint64_t end_tsc = WTMLIB_GET_TSC();
+    wtmlib_ProfilerThreadState_t *state = wtmlib_profiler_thread_state;
+
+    if ( __builtin_expect( !state || !state->depth, 0) ) return;
+
+    int depth = --state->depth;
+
+    if ( __builtin_expect( depth >= WTMLIB_PROFILER_MAX_DEPTH, 0) ) return;
+
+    wtmlib_ProfilerFrame_t *frame = &state->stack[depth];
+    uint64_t elapsed = end_tsc > frame->start_tsc ? end_tsc - frame->start_tsc : 0;
+
+    if ( depth ) state->stack[depth - 1].child_ticks += elapsed;
+
+    if ( frame->region_id < 0 ) return;
+
+    wtmlib_ProfilerRegionCounters_t *counters = &state->counters[frame->region_id];
+    uint64_t exclusive = elapsed > frame->child_ticks ? elapsed - frame->child_ticks : 0;
+
+    __atomic_store_n( &counters->num_calls, counters->num_calls + 1, __ATOMIC_RELAXED);
+    __atomic_store_n( &counters->exclusive_ticks, counters->exclusive_ticks + exclusive,
+                      __ATOMIC_RELAXED);
+
+    if ( !--counters->active_depth )
+    {
+        __atomic_store_n( &counters->inclusive_ticks,
+                          counters->inclusive_ticks + elapsed, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Collect profiling statistics of all the threads
+ */
+int wtmlib_ProfilerGetReport( const wtmlib_TSCConversionParams_t *conv_params,
+                              wtmlib_ProfilerRegionStats_t *stats,
+                              int max_num_regions,
+                              int *num_regions_ret,
+                              uint64_t *num_dropped_ret,
+                              char *err_msg,
+                              int err_msg_size)
+{
+    if ( !conv_params || max_num_regions < 0 || (max_num_regions && !stats) )
+    {
+        WTMLIB_BUFF_MSG( err_msg, err_msg_size, "Conversion parameters and storage for "
+                         "the statistics must be provided");
+
+        return WTMLIB_RET_GENERIC_ERR;
+    }
+
+    wtmlib_ProfilerControl_t *ctrl = &wtmlib_profiler_ctrl;
+
+    /* The lock prevents threads from exiting while their statistics are collected.
+       Profiled threads don't take it */
+    pthread_mutex_lock( &ctrl->mutex);
+
+    int num_regions = ctrl->num_regions;
+    int num_reported = num_regions < max_num_regions ? num_regions : max_num_regions;
+    uint64_t num_dropped = ctrl->retired_num_dropped;
+
+    for ( int i = 0; i < num_reported; i++ )
+    {
+        stats[i].name = ctrl->region_names[i];
+        stats[i].num_calls = ctrl->retired_counters[i].num_calls;
+        stats[i].inclusive_ticks = ctrl->retired_counters[i].inclusive_ticks;
+        stats[i].exclusive_ticks = ctrl->retired_counters[i].exclusive_ticks;
+    }
+
+    for ( wtmlib_ProfilerThreadState_t *state = ctrl->threads; state;
+          state = state->next )
+    {
+        for ( int i = 0; i < num_reported; i++ )
+        {
+            wtmlib_ProfilerRegionCounters_t *counters = &state->counters[i];
+
+            stats[i].num_calls += __atomic_load_n( &counters->num_calls,
+                                                   __ATOMIC_RELAXED);
+            stats[i].inclusive_ticks += __atomic_load_n( &counters->inclusive_ticks,
+                                                         __ATOMIC_RELAXED);
+            stats[i].exclusive_ticks += __atomic_load_n( &counters->exclusive_ticks,
+                                                         __ATOMIC_RELAXED);
+        }
+
+        num_dropped += __atomic_load_n( &state->num_dropped, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_unlock( &ctrl->mutex);
+
+    /* Ticks are converted to nanoseconds only once, after aggregation */
+    for ( int i = 0; i < num_reported; i++ )
+    {
+        stats[i].inclusive_nsecs = WTMLIB_TSC_TO_NSEC( stats[i].inclusive_ticks,
+                                                       conv_params);
+        stats[i].exclusive_nsecs = WTMLIB_TSC_TO_NSEC( stats[i].exclusive_ticks,
+                                                       conv_params);
+    }
+
+    if ( num_regions_ret ) *num_regions_ret = num_regions;
+
+    if ( num_dropped_ret ) *num_dropped_ret = num_dropped;
+
+    return 0;
+}
@@ -12,8 +12,11 @@
 #define _WTMLIB_H_
 
 #include <stdint.h>
+#include <stddef.h>
 
 #include <pthread.h>
+#include <sched.h>
+#include <time.h>
 
 /**
  * Get time-stamp counter (TSC)
@@ -33,10 +36,11 @@
    the decision is to have a macro for GNU and a "static inline" function for all other
    environments.
 
-   Need to think about introducing "reordering-safe" version of the macro. At the moment
-   of writing GCC didn't provide any absolute non-reordering guarantees for ASM
-   statements. Reordering must be controlled by specifying explicit dependencies (like
-   "I can modify an arbitrary memory location").
+   Reordering-safe versions of the macro are provided below (WTMLIB_GET_TSC_START(),
+   WTMLIB_GET_TSC_END(), and WTMLIB_GET_TSC_MFENCED()). The notes that follow concern
+   this unfenced version. At the moment of writing GCC didn't provide any absolute
+   non-reordering guarantees for ASM statements. Reordering must be controlled by
+   specifying explicit dependencies (like "I can modify an arbitrary memory location").
    Without proper dependencies in place ASM statements can be potentially reordered with
    (almost) any surrounding code (including other ASM statements).
    Current version of the macro (that doesn't have reordering-blocking dependencies) can
@@ -95,6 +99,302 @@ static inline uint64_t WTMLIB_GET_TSC()
 #endif /* Architecture targets */
 #endif /* __GNUC__ */
 
+/**
+ * Get time-stamp counter (TSC) in a way that is ordered with the surrounding code
+ *
+ * WTMLIB_GET_TSC_START() is intended to be used at the beginning of a measured interval.
+ * It waits until all previous instructions complete before reading TSC.
+ * WTMLIB_GET_TSC_END() is intended to be used at the end of a measured interval. It
+ * reads TSC after all previous instructions complete and doesn't let subsequent
+ * instructions start until TSC is read.
+ * WTMLIB_GET_TSC_MFENCED() additionally waits until all previous memory stores become
+ * globally visible. It can be used at both ends of an interval when memory stores must
+ * be accounted for. Unlike LFENCE, MFENCE orders RDTSC on both Intel and AMD CPUs.
+ *
+ *      x86-64:  START = LFENCE; RDTSC
+ *               END = RDTSCP; LFENCE
+ *               MFENCED = MFENCE; LFENCE; RDTSC
+ *      PPC64:   START = ISYNC; MFTB
+ *               END = ISYNC; MFTB; ISYNC
+ *               MFENCED = SYNC; ISYNC; MFTB
+ *
+ * All the variants are also compiler barriers (the ASM statements clobber memory).
+ * Reading TSC this way is slower than by means of WTMLIB_GET_TSC(). The cost of a
+ * START/END pair can be measured by means of wtmlib_GetFencedTSCReadOverhead()
+ */
+#ifdef __GNUC__
+#ifdef WTMLIB_ARCH_X86_64
+#define WTMLIB_GET_TSC_START()                                              \
+    ({                                                                      \
+        uint32_t _eax, _edx;                                                \
+                                                                            \
+        __asm__ __volatile__( "lfence\n\trdtsc": "=a" (_eax), "=d" (_edx)   \
+                                               :: "memory");                \
+        ((uint64_t)_edx << 32U) | _eax;                                     \
+    })
+#define WTMLIB_GET_TSC_END()                                                \
+    ({                                                                      \
+        uint32_t _eax, _edx;                                                \
+                                                                            \
+        __asm__ __volatile__( "rdtscp\n\tlfence": "=a" (_eax), "=d" (_edx)  \
+                                                :: "rcx", "memory");        \
+        ((uint64_t)_edx << 32U) | _eax;                                     \
+    })
+#define WTMLIB_GET_TSC_MFENCED()                                            \
+    ({                                                                      \
+        uint32_t _eax, _edx;                                                \
+                                                                            \
+        __asm__ __volatile__( "mfence\n\tlfence\n\trdtsc": "=a" (_eax),     \
+                                                           "=d" (_edx)      \
+                                                         :: "memory");      \
+        ((uint64_t)_edx << 32U) | _eax;                                     \
+    })
+#elif WTMLIB_ARCH_PPC_64
+#define WTMLIB_GET_TSC_START()                                              \
+    ({                                                                      \
+        uint64_t _tbr_val;                                                  \
+                                                                            \
+        __asm__ __volatile__( "isync\n\tmfspr %0, %1": "=r" (_tbr_val)      \
+                                                     : "i" (TBR)            \
+                                                     : "memory");           \
+        _tbr_val;                                                           \
+    })
+#define WTMLIB_GET_TSC_END()                                                \
+    ({                                                                      \
+        uint64_t _tbr_val;                                                  \
+                                                                            \
+        __asm__ __volatile__( "isync\n\tmfspr %0, %1\n\tisync"              \
+                              : "=r" (_tbr_val): "i" (TBR): "memory");      \
+        _tbr_val;                                                           \
+    })
+#define WTMLIB_GET_TSC_MFENCED()                                            \
+    ({                                                                      \
+        uint64_t _tbr_val;                                                  \
+                                                                            \
+        __asm__ __volatile__( "sync\n\tisync\n\tmfspr %0, %1"               \
+                              : "=r" (_tbr_val): "i" (TBR): "memory");      \
+        _tbr_val;                                                           \
+    })
+#else /* None of supported architecture targets was defined */
+#define WTMLIB_GET_TSC_START() MUST_NOT_COMPILE
+#define WTMLIB_GET_TSC_END() MUST_NOT_COMPILE
+#define WTMLIB_GET_TSC_MFENCED() MUST_NOT_COMPILE
+#endif /* Architecture targets */
+#else /* __GNUC__ */
+#ifdef WTMLIB_ARCH_X86_64
+static inline uint64_t WTMLIB_GET_TSC_START()
+{
+    uint32_t eax, edx;
+
+    __asm__ __volatile__( "lfence\n\trdtsc" : "=a" (eax), "=d" (edx) :: "memory");
+
+    return ((uint64_t)edx << 32) | eax;
+}
+
+static inline uint64_t WTMLIB_GET_TSC_END()
+{
+    uint32_t eax, edx;
+
+    __asm__ __volatile__( "rdtscp\n\tlfence" : "=a" (eax), "=d" (edx) :: "rcx", "memory");
+
+    return ((uint64_t)edx << 32) | eax;
+}
+
+static inline uint64_t WTMLIB_GET_TSC_MFENCED()
+{
+    uint32_t eax, edx;
+
+    __asm__ __volatile__( "mfence\n\tlfence\n\trdtsc" : "=a" (eax), "=d" (edx)
+                                                      :: "memory");
+
+    return ((uint64_t)edx << 32) | eax;
+}
+#elif WTMLIB_ARCH_PPC_64
+static inline uint64_t WTMLIB_GET_TSC_START()
+{
+    uint64_t _tbr_val;
+
+    __asm__ __volatile__( "isync\n\tmfspr %0, %1": "=r" (_tbr_val): "i" (TBR): "memory");
+
+    return _tbr_val;
+}
+
+static inline uint64_t WTMLIB_GET_TSC_END()
+{
+    uint64_t _tbr_val;
+
+    __asm__ __volatile__( "isync\n\tmfspr %0, %1\n\tisync": "=r" (_tbr_val): "i" (TBR)
+                                                          : "memory");
+
+    return _tbr_val;
+}
+
+static inline uint64_t WTMLIB_GET_TSC_MFENCED()
+{
+    uint64_t _tbr_val;
+
+    __asm__ __volatile__( "sync\n\tisync\n\tmfspr %0, %1": "=r" (_tbr_val): "i" (TBR)
+                                                         : "memory");
+
+    return _tbr_val;
+}
+#else /* None of supported architecture targets was defined */
+static inline uint64_t WTMLIB_GET_TSC_START()
+{
+    MUST_NOT_COMPILE;
+}
+
+static inline uint64_t WTMLIB_GET_TSC_END()
+{
+    MUST_NOT_COMPILE;
+}
+
+static inline uint64_t WTMLIB_GET_TSC_MFENCED()
+{
+    MUST_NOT_COMPILE;
+}
+#endif /* Architecture targets */
+#endif /* __GNUC__ */
+
+/**
+ * Get time-stamp counter (TSC) along with ID of the CPU that the counter was read on.
+ * The CPU ID is stored to the memory referenced by "cpu_"
+ *
+ * On x86-64 RDTSCP instruction is used. It atomically reads TSC and TSC_AUX register.
+ * Linux stores ID of the CPU to the lower 12 bits of TSC_AUX. Unlike RDTSC, RDTSCP waits
+ * until all previous instructions have executed.
+ * On PPC64 the CPU ID is obtained by means of "sched_getcpu()". The time base register
+ * is re-read if the thread migrated to a different CPU in-between.
+ *
+ * wtmlib_GetTSCOffsetTable() checks that the CPU ID can be obtained this way
+ */
+#ifdef __GNUC__
+#ifdef WTMLIB_ARCH_X86_64
+#define WTMLIB_GET_TSC_AND_CPU( cpu_)                                 \
+    ({                                                                \
+        uint32_t _eax, _ecx, _edx;                                    \
+                                                                      \
+        __asm__ __volatile__( "rdtscp": "=a" (_eax), "=d" (_edx),     \
+                                        "=c" (_ecx));                 \
+        *(cpu_) = _ecx & 0xfff;                                       \
+        ((uint64_t)_edx << 32U) | _eax;                               \
+    })
+#elif WTMLIB_ARCH_PPC_64
+#define WTMLIB_GET_TSC_AND_CPU( cpu_)                                 \
+    ({                                                                \
+        int _cpu;                                                     \
+        uint64_t _tbr_val;                                            \
+                                                                      \
+        do                                                            \
+        {                                                             \
+            _cpu = sched_getcpu();                                    \
+            _tbr_val = WTMLIB_GET_TSC();                              \
+        } while ( _cpu != sched_getcpu() );                           \
+                                                                      \
+        *(cpu_) = _cpu;                                               \
+        _tbr_val;                                                     \
+    })
+#else /* None of supported architecture targets was defined */
+#define WTMLIB_GET_TSC_AND_CPU( cpu_) MUST_NOT_COMPILE
+#endif /* Architecture targets */
+#else /* __GNUC__ */
+#ifdef WTMLIB_ARCH_X86_64
+static inline uint64_t WTMLIB_GET_TSC_AND_CPU( int *cpu)
+{
+    uint32_t eax, ecx, edx;
+
+    __asm__ __volatile__( "rdtscp" : "=a" (eax), "=d" (edx), "=c" (ecx));
+    *cpu = ecx & 0xfff;
+
+    return ((uint64_t)edx << 32) | eax;
+}
+#elif WTMLIB_ARCH_PPC_64
+static inline uint64_t WTMLIB_GET_TSC_AND_CPU( int *cpu)
+{
+    int cpu_id;
+    uint64_t tbr_val;
+
+    do
+    {
+        cpu_id = sched_getcpu();
+        tbr_val = WTMLIB_GET_TSC();
+    } while ( cpu_id != sched_getcpu() );
+
+    *cpu = cpu_id;
+
+    return tbr_val;
+}
+#else /* None of supported architecture targets was defined */
+static inline uint64_t WTMLIB_GET_TSC_AND_CPU( int *cpu)
+{
+    MUST_NOT_COMPILE;
+}
+#endif /* Architecture targets */
+#endif /* __GNUC__ */
+
+/**
+ * Table of per-CPU TSC offsets (shifts between TSC on each CPU and TSC on the base CPU)
+ *
+ * All the arrays are indexed by CPU IDs. Entries that correspond to the base CPU and to
+ * the CPUs that were not evaluated contain "zeros"
+ */
+typedef struct
+{
+    /* Number of entries in each of the arrays below (the number of configured CPUs) */
+    int num_cpus;
+    /* ID of the base CPU */
+    int base_cpu;
+    /* Estimated shifts: offsets[cpu_id] = TSC(cpu_id) - TSC(base_cpu). Each estimate is
+       the middle of the corresponding [offsets_min, offsets_max] range. The array is
+       aligned to the cache line size (it's read on every corrected TSC read) */
+    int64_t *offsets;
+    /* Lower bounds of the shifts */
+    int64_t *offsets_min;
+    /* Upper bounds of the shifts */
+    int64_t *offsets_max;
+    /* The biggest (offsets_max - offsets_min) among all the CPUs. Corrected TSC values
+       read on different CPUs are comparable up to this number of ticks */
+    int64_t max_uncertainty;
+} wtmlib_TSCOffsetTable_t;
+
+/**
+ * Get time-stamp counter (TSC) corrected by the offset of the current CPU's TSC. I.e.
+ * get an estimate of the base CPU's TSC at the moment of reading. Corrected values read
+ * on different CPUs can be subtracted from each other even if TSCs of these CPUs are
+ * shifted relative to each other
+ */
+#ifdef __GNUC__
+#define WTMLIB_GET_TSC_CORRECTED( table_)                                     \
+    ({                                                                        \
+        int _cur_cpu;                                                         \
+        uint64_t _tsc_val = WTMLIB_GET_TSC_AND_CPU( &_cur_cpu);               \
+                                                                              \
+        _cur_cpu < (table_)->num_cpus ?                                       \
+            _tsc_val - (uint64_t)(table_)->offsets[_cur_cpu] : _tsc_val;      \
+    })
+#else /* __GNUC__ */
+static inline uint64_t WTMLIB_GET_TSC_CORRECTED( const wtmlib_TSCOffsetTable_t *table)
+{
+    int cur_cpu;
+    uint64_t tsc_val = WTMLIB_GET_TSC_AND_CPU( &cur_cpu);
+
+    return cur_cpu < table->num_cpus ? tsc_val - (uint64_t)table->offsets[cur_cpu] :
+                                       tsc_val;
+}
+#endif /* __GNUC__ */
+
+/**
+ * Cost of reading TSC (in TSC ticks) measured as the difference between two back-to-back
+ * reads
+ */
+typedef struct
+{
+    /* The minimum over all the measurements on all the allowed CPUs */
+    uint64_t min;
+    /* The median (the median of per-CPU medians) */
+    uint64_t median;
+} wtmlib_TSCReadOverhead_t;
+
 /**
  * A set of parameters used to convert TSC ticks into nanoseconds in a fast and
  * accurate way
@@ -118,6 +418,29 @@ typedef struct
        convert TSC ticks to (nano)seconds by means of simple division (either integer or
        floating-point) */
     uint64_t tsc_ticks_per_sec;
+    /* Overhead of reading TSC by means of WTMLIB_GET_TSC(). The overhead fields are
+       zero unless they were filled by wtmlib_MeasureTSCReadOverhead() */
+    wtmlib_TSCReadOverhead_t plain_read_overhead;
+    /* Overhead of a WTMLIB_GET_TSC_START() / WTMLIB_GET_TSC_END() pair */
+    wtmlib_TSCReadOverhead_t fenced_read_overhead;
+    /* Overhead of reading TSC by means of WTMLIB_GET_TSC_MFENCED() */
+    wtmlib_TSCReadOverhead_t mfenced_read_overhead;
+    /* A 64-bit fixed-point factor used by WTMLIB_TSC_TO_NSEC_WIDE():
+       nsecs = (tsc_ticks * wide_mult) >> wide_shift, where the product is 128-bit.
+       Zero if the compiler doesn't support 128-bit integers */
+    uint64_t wide_mult;
+    /* A shift applied to the 128-bit product */
+    int wide_shift;
+    /* Parameters of the reverse conversion (nanoseconds to TSC ticks) used by
+       WTMLIB_NSEC_TO_TSC(). They mirror the parameters of the direct conversion:
+       tsc_ticks = (nsecs >> nsec_remainder_length) * tscs_per_nsec_modulus
+                   + (((nsecs & nsec_remainder_bitmask) * nsec_to_tsc_mult) >>
+                     nsec_to_tsc_shift) */
+    uint64_t nsec_to_tsc_mult;
+    int nsec_to_tsc_shift;
+    uint64_t tscs_per_nsec_modulus;
+    int nsec_remainder_length;
+    uint64_t nsec_remainder_bitmask;
 } wtmlib_TSCConversionParams_t;
 
 /**
@@ -134,6 +457,77 @@ typedef struct
      + ((((tsc_ticks_) & ((cp_)->tsc_remainder_bitmask)) *                            \
       ((cp_)->mult)) >> (cp_)->shift))
 
+/**
+ * Convert nanoseconds to TSC ticks
+ *
+ * The conversion mirrors WTMLIB_TSC_TO_NSEC(): it doesn't use division and doesn't
+ * overflow (as long as the result fits 64 bits). The result never exceeds the exact
+ * value. It may be smaller by a tick plus a few parts per billion
+ *
+ * The macro is intended for computing deadlines in terms of TSC. That allows hot loops
+ * to compare raw TSC values against a deadline instead of converting TSC every
+ * iteration
+ */
+#define WTMLIB_NSEC_TO_TSC( nsecs_, cp_)                                              \
+    (((uint64_t)(nsecs_) >> (cp_)->nsec_remainder_length) *                          \
+     ((cp_)->tscs_per_nsec_modulus)                                                  \
+     + ((((uint64_t)(nsecs_) & ((cp_)->nsec_remainder_bitmask)) *                    \
+      ((cp_)->nsec_to_tsc_mult)) >> (cp_)->nsec_to_tsc_shift))
+
+/**
+ * Get TSC value that will be reached "nsecs_" nanoseconds from now
+ *
+ *      uint64_t deadline = WTMLIB_TSC_DEADLINE( 1000, &conv_params);
+ *
+ *      while ( WTMLIB_GET_TSC() < deadline ) poll();
+ */
+#define WTMLIB_TSC_DEADLINE( nsecs_, cp_) \
+    (WTMLIB_GET_TSC() + WTMLIB_NSEC_TO_TSC( (nsecs_), (cp_)))
+
+/**
+ * Convert TSC ticks to nanoseconds after subtracting the overhead of reading TSC
+ *
+ * The minimum overhead measured by wtmlib_MeasureTSCReadOverhead() is subtracted (the
+ * result is zero if the number of ticks doesn't exceed the overhead). Use the variant
+ * that matches the macros the interval was measured with:
+ *      WTMLIB_TSC_TO_NSEC_NET() - WTMLIB_GET_TSC() at both ends
+ *      WTMLIB_FENCED_TSC_TO_NSEC_NET() - WTMLIB_GET_TSC_START() / WTMLIB_GET_TSC_END()
+ *      WTMLIB_MFENCED_TSC_TO_NSEC_NET() - WTMLIB_GET_TSC_MFENCED() at both ends
+ */
+#define WTMLIB_TSC_TO_NSEC_MINUS_OVERHEAD( tsc_ticks_, overhead_, cp_)        \
+    WTMLIB_TSC_TO_NSEC( ((tsc_ticks_) > (overhead_) ?                         \
+                         (tsc_ticks_) - (overhead_) : 0), (cp_))
+#define WTMLIB_TSC_TO_NSEC_NET( tsc_ticks_, cp_)                              \
+    WTMLIB_TSC_TO_NSEC_MINUS_OVERHEAD( (tsc_ticks_),                          \
+                                       (cp_)->plain_read_overhead.min, (cp_))
+#define WTMLIB_FENCED_TSC_TO_NSEC_NET( tsc_ticks_, cp_)                       \
+    WTMLIB_TSC_TO_NSEC_MINUS_OVERHEAD( (tsc_ticks_),                          \
+                                       (cp_)->fenced_read_overhead.min, (cp_))
+#define WTMLIB_MFENCED_TSC_TO_NSEC_NET( tsc_ticks_, cp_)                      \
+    WTMLIB_TSC_TO_NSEC_MINUS_OVERHEAD( (tsc_ticks_),                          \
+                                       (cp_)->mfenced_read_overhead.min, (cp_))
+
+/**
+ * Convert TSC ticks to nanoseconds using 128-bit multiplication
+ *
+ * WTMLIB_TSC_TO_NSEC() splits TSC ticks into a quotient and a remainder of
+ * TSC modulus (see WTMLIB_TIME_CONVERSION_MODULUS in wtmlib_config.h) to avoid overflow
+ * of 64-bit multiplication. That limits the precision of the multiplier to roughly 30
+ * bits. This macro multiplies TSC ticks by a 64-bit fixed-point factor producing a
+ * 128-bit product. Relative error of the conversion is about 2^(-63) for any interval.
+ * On x86-64 and PPC64 the conversion takes a single widening multiplication followed by
+ * a shift (no additions or masking).
+ *
+ * The macro requires compiler support of 128-bit integers ("unsigned __int128")
+ */
+#ifdef __SIZEOF_INT128__
+#define WTMLIB_TSC_TO_NSEC_WIDE( tsc_ticks_, cp_)                                 \
+    ((uint64_t)(((unsigned __int128)(tsc_ticks_) * (cp_)->wide_mult) >>           \
+                (cp_)->wide_shift))
+#else /* __SIZEOF_INT128__ */
+#define WTMLIB_TSC_TO_NSEC_WIDE( tsc_ticks_, cp_) MUST_NOT_COMPILE
+#endif /* __SIZEOF_INT128__ */
+
 /*
     Maximum size of human-readable error messages returned by the library functions
  */
@@ -232,6 +626,58 @@ int wtmlib_EvalTSCReliabilityCPUSW( int64_t *tsc_range_length, bool *is_monotoni
 int wtmlib_EvalTSCReliabilityCOP( int64_t *tsc_range_length, bool *is_monotonic,
                                   char *err_msg, int err_msg_size);
 
+/**
+ * Evaluate reliability of TSC using a method of CAS-Ordered Probes. Disjoint pairs of
+ * CPUs are probed concurrently
+ *
+ * wtmlib_EvalTSCReliabilityCOP() compares TSC on each CPU with TSC on the base CPU, one
+ * pair of CPUs at a time. This function schedules pairs of CPUs along a binomial tree
+ * rooted at the base CPU, so that only ceil(log2(N)) rounds of probing are needed for
+ * N CPUs. Shifts between TSCs are then reconstructed from the pairwise results. The
+ * evaluation is much faster on machines with many CPUs. The price is a somewhat bigger
+ * (i.e. more conservative) estimate of the maximum shift between TSCs.
+ *
+ * Return codes, returned values, and their semantics are the same as for
+ * wtmlib_EvalTSCReliabilityCOP()
+ */
+int wtmlib_EvalTSCReliabilityCOPConcurrent( int64_t *tsc_range_length,
+                                            bool *is_monotonic, char *err_msg,
+                                            int err_msg_size);
+
+/**
+ * Build a table of per-CPU TSC offsets (shifts between TSC on each available CPU and
+ * TSC on the current CPU which is used as a base one)
+ *
+ * Shifts are evaluated using a method of CAS-Ordered Probes (in the same way as it's
+ * done by wtmlib_EvalTSCReliabilityCOP(); or by wtmlib_EvalTSCReliabilityCOPConcurrent()
+ * if "is_concurrent" is "true"). The table allows reading corrected TSC values using
+ * WTMLIB_GET_TSC_CORRECTED(). Thus, intervals measured across CPUs with shifted TSCs
+ * become usable.
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_TSC_INCONSISTENCY - major TSC inconsistency was detected
+ *      WTMLIB_RET_POOR_STAT - configured statistical significance criteria were not met
+ *      WTMLIB_RET_GENERIC_ERR - all other errors (including the case when ID of the
+ *                               current CPU cannot be read along with TSC)
+ *
+ * Besides the regular return value the function returns (if the corresponding pointers
+ * are non-zero):
+ *      table - table of per-CPU TSC offsets. Must be released after use by means of
+ *              wtmlib_FreeTSCOffsetTable()
+ *      err_msg - human-readable error message
+ *
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * "table". err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_GetTSCOffsetTable( bool is_concurrent, wtmlib_TSCOffsetTable_t *table,
+                              char *err_msg, int err_msg_size);
+
+/**
+ * Release memory allocated by wtmlib_GetTSCOffsetTable()
+ */
+void wtmlib_FreeTSCOffsetTable( wtmlib_TSCOffsetTable_t *table);
+
 /**
  * Calculate parameters needed to perform fast and accurate conversion of TSC ticks to
  * nanoseconds. Also calculate time (in seconds) remaining before the earliest TSC wrap
@@ -256,4 +702,1410 @@ int wtmlib_GetTSCToNsecConversionParams( wtmlib_TSCConversionParams_t *conv_para
                                          uint64_t *secs_before_wrap_ret, char *err_msg,
                                          int err_msg_size);
 
+/**
+ * Measure the overhead of reading TSC and store it to the conversion parameters
+ *
+ * The minimum and the median cost of back-to-back reads are measured for WTMLIB_GET_TSC()
+ * and for each of the fenced variants on every CPU allowed by the CPU affinity mask of
+ * the current thread (WTMLIB_TSC_READ_OVERHEAD_MEASUREMENTS measurements per CPU and
+ * variant; see wtmlib_config.h). The results are stored to the "*_read_overhead" fields
+ * of "conv_params". The other fields are not modified. The overhead can then be
+ * subtracted from measured intervals by means of WTMLIB_TSC_TO_NSEC_NET() and similar
+ * macros
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - all errors
+ *
+ * "conv_params" must be non-zero.
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * "conv_params". err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_MeasureTSCReadOverhead( wtmlib_TSCConversionParams_t *conv_params,
+                                   char *err_msg, int err_msg_size);
+
+/**
+ * Get parameters needed to perform fast and accurate conversion of TSC ticks to
+ * nanoseconds using a persistent calibration cache. Also calculate time (in seconds)
+ * remaining before the earliest TSC wrap
+ *
+ * The full calibration done by wtmlib_GetTSCToNsecConversionParams() takes seconds. This
+ * function instead tries to load the parameters from the cache file located at
+ * "cache_path". The cached parameters are used only if:
+ *      - the machine fingerprint stored in the file (CPU model, TSC-related CPU flags,
+ *        TSC frequency reported by the kernel or the hardware, and boot ID) matches the
+ *        current one
+ *      - a short measurement of TSC frequency agrees with the cached frequency (see
+ *        WTMLIB_CALIB_CACHE_CHECK_* parameters in wtmlib_config.h)
+ * Otherwise the function transparently falls back to the full calibration and stores
+ * the result to the cache file for future use. Failure to store the cache file is not
+ * treated as an error
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_TSC_INCONSISTENCY - major TSC inconsistency was detected
+ *      WTMLIB_RET_GENERIC_ERR - all other errors
+ *
+ * Besides the regular return value the function returns (if the corresponding pointers
+ * are non-zero):
+ *      conv_params - a set of TSC-to-nanoseconds conversion parameters
+ *      secs_before_wrap - number of seconds remaining before the earliest TSC wrap
+ *      is_cache_hit - "true" if the parameters were loaded from the cache file; "false"
+ *                     if the full calibration was performed
+ *      err_msg - human-readable error message
+ *
+ * Any of the pointer arguments except "cache_path" can be zero.
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * conv_params, secs_before_wrap, and is_cache_hit.
+ * err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_GetTSCToNsecConversionParamsCached( const char *cache_path,
+                                               wtmlib_TSCConversionParams_t *conv_params,
+                                               uint64_t *secs_before_wrap_ret,
+                                               bool *is_cache_hit, char *err_msg,
+                                               int err_msg_size);
+
+/**
+ * Get parameters needed to perform fast and accurate conversion of TSC ticks to
+ * nanoseconds spending only as much time as needed to reach the requested precision.
+ * Also calculate time (in seconds) remaining before the earliest TSC wrap
+ *
+ * wtmlib_GetTSCToNsecConversionParams() always does a fixed number of long measurements.
+ * This function starts with short measurements and makes them longer only if the
+ * precision of TSC frequency doesn't reach "target_ppm" (half-width of the confidence
+ * interval of TSC frequency measured in parts per million). Measurements stop as soon as
+ * the target is reached or "time_budget_msecs" milliseconds are spent (see
+ * WTMLIB_ADAPTIVE_CALIB_* parameters in wtmlib_config.h). In the latter case the most
+ * precise result obtained so far is used. Thus, the client can trade start-up latency
+ * for accuracy.
+ *
+ * Possible return codes:
+ *      0 - in case of success (even if the target precision wasn't reached)
+ *      WTMLIB_RET_TSC_INCONSISTENCY - major TSC inconsistency was detected
+ *      WTMLIB_RET_GENERIC_ERR - all other errors (including the case when the time
+ *                               budget is too small to make any estimate)
+ *
+ * Besides the regular return value the function returns (if the corresponding pointers
+ * are non-zero):
+ *      conv_params - a set of TSC-to-nanoseconds conversion parameters
+ *      secs_before_wrap - number of seconds remaining before the earliest TSC wrap
+ *      achieved_ppm - precision of TSC frequency that was actually achieved (in parts
+ *                     per million)
+ *      err_msg - human-readable error message
+ *
+ * Any of the pointer arguments can be zero.
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * conv_params, secs_before_wrap, and achieved_ppm.
+ * err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_GetTSCToNsecConversionParamsAdaptive( double target_ppm,
+                                                 uint64_t time_budget_msecs,
+                                                 wtmlib_TSCConversionParams_t
+                                                     *conv_params,
+                                                 uint64_t *secs_before_wrap_ret,
+                                                 double *achieved_ppm, char *err_msg,
+                                                 int err_msg_size);
+
+/**
+ * Get parameters needed to perform fast and accurate conversion of TSC ticks to
+ * nanoseconds by measuring TSC frequency concurrently on all available CPUs. Also
+ * calculate time (in seconds) remaining before the earliest TSC wrap
+ *
+ * The measurements that wtmlib_GetTSCToNsecConversionParams() does sequentially are
+ * distributed among threads bound to the available CPUs (see
+ * WTMLIB_PARALLEL_CALIB_MIN_SAMPLES_PER_CPU in wtmlib_config.h). Thus, on a multi-CPU
+ * system the calibration takes a fraction of the time. Additionally, TSC frequencies of
+ * different physical packages (sockets) are compared
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_TSC_INCONSISTENCY - major TSC inconsistency was detected (including
+ *                                     the case when TSC frequencies of different sockets
+ *                                     disagree by more than
+ *                                     WTMLIB_PARALLEL_CALIB_MAX_DISAGREEMENT ppm)
+ *      WTMLIB_RET_GENERIC_ERR - all other errors
+ *
+ * Besides the regular return value the function returns (if the corresponding pointers
+ * are non-zero):
+ *      conv_params - a set of TSC-to-nanoseconds conversion parameters
+ *      secs_before_wrap - number of seconds remaining before the earliest TSC wrap
+ *      disagreement_ppm - the biggest difference between TSC frequencies of different
+ *                         sockets (in parts per million)
+ *      err_msg - human-readable error message
+ *
+ * Any of the pointer arguments can be zero.
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * conv_params, secs_before_wrap, and disagreement_ppm.
+ * err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_GetTSCToNsecConversionParamsParallel( wtmlib_TSCConversionParams_t
+                                                     *conv_params,
+                                                 uint64_t *secs_before_wrap_ret,
+                                                 double *disagreement_ppm, char *err_msg,
+                                                 int err_msg_size);
+
+/*
+   Sources of TSC frequency used to calculate TSC-to-nanoseconds conversion parameters
+*/
+/* TSC frequency was measured against system time (the statistical method) */
+#define WTMLIB_TSC_FREQ_SRC_MEASURED 0
+/* TSC frequency was reported by the kernel via the perf_event mmap page */
+#define WTMLIB_TSC_FREQ_SRC_PERF_MMAP 1
+/* TSC frequency was reported by the hardware (CPUID on x86-64; time base frequency in
+   /proc/cpuinfo on PPC64) */
+#define WTMLIB_TSC_FREQ_SRC_ARCH 2
+
+/**
+ * Get parameters needed to perform fast and accurate conversion of TSC ticks to
+ * nanoseconds using TSC frequency reported by the kernel or the hardware. Also calculate
+ * time (in seconds) remaining before the earliest TSC wrap
+ *
+ * Unlike wtmlib_GetTSCToNsecConversionParams() the function normally takes
+ * milliseconds instead of seconds. TSC frequency is taken from the first available
+ * source:
+ *      1) the perf_event mmap page (conversion parameters exported by the kernel)
+ *      2) the hardware (CPUID leaves 0x15/0x16 or leaf 0x40000010 of VMware and KVM
+ *         hypervisors on x86-64; time base frequency on PPC64)
+ *      3) if neither is available, the function falls back to the statistical method
+ *         used by wtmlib_GetTSCToNsecConversionParams()
+ * If "cross_check" is "true", the reported frequency is additionally checked by a short
+ * measurement against system time (see WTMLIB_FAST_CALIB_CHECK_* parameters in
+ * wtmlib_config.h). If the check fails, the function falls back to the statistical
+ * method
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_TSC_INCONSISTENCY - major TSC inconsistency was detected
+ *      WTMLIB_RET_GENERIC_ERR - all other errors
+ *
+ * Besides the regular return value the function returns (if the corresponding pointers
+ * are non-zero):
+ *      conv_params - a set of TSC-to-nanoseconds conversion parameters
+ *      secs_before_wrap - number of seconds remaining before the earliest TSC wrap
+ *      freq_source - source of TSC frequency that was actually used (one of
+ *                    WTMLIB_TSC_FREQ_SRC_* values)
+ *      err_msg - human-readable error message
+ *
+ * Any of the pointer arguments can be zero.
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * conv_params, secs_before_wrap, and freq_source.
+ * err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_GetTSCToNsecConversionParamsFast( bool cross_check,
+                                             wtmlib_TSCConversionParams_t *conv_params,
+                                             uint64_t *secs_before_wrap_ret,
+                                             int *freq_source, char *err_msg,
+                                             int err_msg_size);
+
+/**
+ * Measure the overhead of fenced TSC reading, i.e. the number of TSC ticks between
+ * WTMLIB_GET_TSC_START() and WTMLIB_GET_TSC_END() executed back to back on the current
+ * CPU. The minimum over WTMLIB_TSC_READ_OVERHEAD_MEASUREMENTS (see wtmlib_config.h)
+ * measurements is returned. It can be subtracted from intervals measured by means of the
+ * fenced macros to get the cost of the measured code alone
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - all errors
+ *
+ * Besides the regular return value the function returns (if the corresponding pointers
+ * are non-zero):
+ *      overhead_ticks - the measured overhead in TSC ticks
+ *      err_msg - human-readable error message
+ *
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * "overhead_ticks". err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_GetFencedTSCReadOverhead( uint64_t *overhead_ticks, char *err_msg,
+                                     int err_msg_size);
+
+/**
+ * Anchor that ties TSC to system clocks: values of CLOCK_REALTIME and CLOCK_MONOTONIC
+ * (in nanoseconds) that correspond to the given TSC value
+ */
+typedef struct
+{
+    /* TSC value */
+    uint64_t tsc;
+    /* Nanoseconds since the Epoch (CLOCK_REALTIME) at the moment "tsc" was read */
+    uint64_t realtime_nsec;
+    /* CLOCK_MONOTONIC (in nanoseconds) at the moment "tsc" was read */
+    uint64_t monotonic_nsec;
+    /* Width of the TSC interval (in ticks) that enclosed reading of the system clocks.
+       Defines precision of the anchor */
+    uint64_t bracket_ticks;
+} wtmlib_TSCAnchor_t;
+
+/**
+ * Convert TSC value to nanoseconds since the Epoch (or since the start of
+ * CLOCK_MONOTONIC) using the given anchor
+ */
+static inline uint64_t wtmlib_TSCToAnchoredNsec( uint64_t tsc, uint64_t anchor_tsc,
+                                                 uint64_t anchor_nsec,
+                                                 const wtmlib_TSCConversionParams_t *cp)
+{
+    if ( tsc >= anchor_tsc )
+    {
+        return anchor_nsec + WTMLIB_TSC_TO_NSEC( tsc - anchor_tsc, cp);
+    }
+
+    return anchor_nsec - WTMLIB_TSC_TO_NSEC( anchor_tsc - tsc, cp);
+}
+
+/**
+ * Convert TSC value to nanoseconds since the Epoch (i.e. to CLOCK_REALTIME)
+ *
+ * "anchor_" is a pointer to an anchor obtained by means of wtmlib_GetTSCAnchor().
+ * "cp_" is a pointer to TSC-to-nanoseconds conversion parameters
+ */
+#define WTMLIB_TSC_TO_EPOCH_NSEC( tsc_, anchor_, cp_) \
+    wtmlib_TSCToAnchoredNsec( (tsc_), (anchor_)->tsc, (anchor_)->realtime_nsec, (cp_))
+
+/**
+ * Convert TSC value to CLOCK_MONOTONIC nanoseconds
+ */
+#define WTMLIB_TSC_TO_MONOTONIC_NSEC( tsc_, anchor_, cp_) \
+    wtmlib_TSCToAnchoredNsec( (tsc_), (anchor_)->tsc, (anchor_)->monotonic_nsec, (cp_))
+
+/**
+ * Get current time in nanoseconds since the Epoch without calling the system. A
+ * replacement for clock_gettime( CLOCK_REALTIME, ...)
+ */
+#define WTMLIB_GET_EPOCH_NSEC( anchor_, cp_) \
+    WTMLIB_TSC_TO_EPOCH_NSEC( WTMLIB_GET_TSC(), (anchor_), (cp_))
+
+/**
+ * Record an anchor that ties TSC to CLOCK_REALTIME and CLOCK_MONOTONIC
+ *
+ * Each attempt reads TSC, then both clocks, then TSC again. The attempt with the
+ * narrowest TSC interval (out of WTMLIB_TSC_ANCHOR_ATTEMPTS; see wtmlib_config.h) is
+ * used. The middle of the interval is taken as the TSC value that corresponds to the
+ * clock values.
+ *
+ * TSC frequency measured by the library and the rate of CLOCK_REALTIME (which is
+ * steered by NTP) slightly differ. Hence, timestamps computed from a single anchor drift
+ * away from the system clock over time. The anchor should be refreshed periodically.
+ * Also, the anchor doesn't reflect steps of CLOCK_REALTIME that happen after it was
+ * recorded
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - all errors
+ *
+ * Besides the regular return value the function returns (if the corresponding pointers
+ * are non-zero):
+ *      anchor - the recorded anchor
+ *      err_msg - human-readable error message
+ *
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * "anchor". err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_GetTSCAnchor( wtmlib_TSCAnchor_t *anchor, char *err_msg, int err_msg_size);
+
+/**
+ * Start the TSC-based system clock used by wtmlib_clock_gettime()
+ *
+ * A background thread is started. It periodically (every WTMLIB_CLOCK_REFRESH_PERIOD
+ * microseconds; see wtmlib_config.h) re-anchors TSC to CLOCK_MONOTONIC and
+ * CLOCK_REALTIME. The published state is protected by a sequence lock. Readers never
+ * block. Since the clock is re-anchored on every refresh, only an approximate TSC
+ * frequency is needed. The thread takes the frequency reported by the kernel or the
+ * hardware (cross-checked the same way as by wtmlib_GetTSCToNsecConversionParamsFast()).
+ * If none is reported, the frequency is sampled against CLOCK_MONOTONIC over one
+ * refresh period. The multi-second statistical calibration is never performed. Thus,
+ * the clock becomes operational within about one refresh period at most
+ *
+ * Between refreshes the clock runs at a rate chosen so that it converges to
+ * CLOCK_MONOTONIC by the next refresh. Each new segment starts at the TSC value and the
+ * time that the previous segment gives right before the new one is published. Thus, the
+ * clock doesn't jump when its rate changes. Readers read TSC inside the sequence lock.
+ * A reader whose TSC value may belong to a newer segment retries. Thus, CLOCK_MONOTONIC
+ * never goes backwards. That also holds when wtmlib_clock_gettime() falls back to the
+ * system's clock_gettime(): the value returned is never smaller than the largest value
+ * the TSC-based clock could have returned. The clock steps forward if it lags behind
+ * CLOCK_MONOTONIC by more than WTMLIB_CLOCK_MAX_CORRECTION nanoseconds (e.g. after a
+ * system suspend). CLOCK_REALTIME is derived from CLOCK_MONOTONIC using the offset
+ * between them observed at the last refresh
+ *
+ * In a child process created by fork() the clock is stopped. It can be started again
+ *
+ * If "wait" is "true", the function returns only when the clock becomes operational (or
+ * fails to). Otherwise, it returns right after starting the thread. Calibration errors
+ * are not reported in that case. wtmlib_clock_gettime() falls back to the system's
+ * clock_gettime() until the clock is operational
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_TSC_INCONSISTENCY - major TSC inconsistency was detected
+ *      WTMLIB_RET_GENERIC_ERR - all other errors (including the cases when the clock is
+ *                               already started or is being stopped)
+ *
+ * err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_StartClock( bool wait, char *err_msg, int err_msg_size);
+
+/**
+ * Stop the TSC-based system clock
+ *
+ * The background thread is stopped. The function returns when the thread has exited.
+ * wtmlib_clock_gettime() falls back to the system's clock_gettime(). The clock can be
+ * started again afterwards
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - all errors (including the cases when the clock is not
+ *                               started or is already being stopped)
+ *
+ * err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_StopClock( char *err_msg, int err_msg_size);
+
+/**
+ * Drop-in replacement for clock_gettime()
+ *
+ * CLOCK_MONOTONIC and CLOCK_REALTIME are computed from TSC (see wtmlib_StartClock()).
+ * All other clocks, as well as the cases when the TSC-based clock is not operational
+ * (not started; or the background thread didn't refresh the state for
+ * WTMLIB_CLOCK_MAX_ANCHOR_AGE refresh periods), are served by the system's
+ * clock_gettime(). Return value and "errno" have the same semantics as for
+ * clock_gettime()
+ *
+ * The whole state needed by readers fits into a single cache line. It is converted to
+ * "struct timespec" using one 64x64-bit multiplication and no division. A call is about
+ * 10% faster than a vDSO call of clock_gettime() when the kernel's clocksource is TSC
+ * (see README.md for measured numbers). The gain is much larger when clock_gettime()
+ * falls back to a system call
+ *
+ * A shared library that replaces clock_gettime() with this function in unmodified
+ * programs can be built by means of "make clock_shim" (see README.md)
+ */
+int wtmlib_clock_gettime( clockid_t clk_id, struct timespec *tp);
+
+/**
+ * Container of TSC-to-nanoseconds conversion parameters that can be updated while other
+ * threads use it for conversions
+ *
+ * The container holds two copies of the parameters and a sequence counter. The lowest
+ * bit of the counter selects the copy that readers use. A writer first redirects
+ * readers to the second copy and updates the first one, then redirects readers back to
+ * the first copy and updates the second one. Thus, readers always have a consistent
+ * copy to read. They never wait for the writer. A reader only retries if the counter
+ * changed while it was reading (i.e. if a writer completed an update in-between).
+ *
+ * The container must be initialized by means of
+ * wtmlib_InitVersionedTSCConversionParams() and updated by means of
+ * wtmlib_PublishTSCConversionParams(). All fields are accessed atomically.
+ *
+ * Keep the container apart from frequently written data to avoid false sharing
+ */
+typedef struct
+{
+    /* Sequence counter. Incremented twice per update */
+    uint64_t seq;
+    /* Two copies of the parameters */
+    wtmlib_TSCConversionParams_t copies[2];
+} wtmlib_VersionedTSCConversionParams_t;
+
+/**
+ * Copy TSC-to-nanoseconds conversion parameters field by field using atomic accesses
+ */
+static inline void wtmlib_AtomicCopyTSCConversionParams(
+                                               wtmlib_TSCConversionParams_t *dst,
+                                               const wtmlib_TSCConversionParams_t *src)
+{
+#define WTMLIB_ATOMIC_COPY_FIELD( field_)                                           \
+    __atomic_store_n( &dst->field_, __atomic_load_n( &src->field_, __ATOMIC_RELAXED), \
+                      __ATOMIC_RELAXED)
+
+    WTMLIB_ATOMIC_COPY_FIELD( mult);
+    WTMLIB_ATOMIC_COPY_FIELD( shift);
+    WTMLIB_ATOMIC_COPY_FIELD( nsecs_per_tsc_modulus);
+    WTMLIB_ATOMIC_COPY_FIELD( tsc_remainder_length);
+    WTMLIB_ATOMIC_COPY_FIELD( tsc_remainder_bitmask);
+    WTMLIB_ATOMIC_COPY_FIELD( tsc_ticks_per_sec);
+    WTMLIB_ATOMIC_COPY_FIELD( plain_read_overhead.min);
+    WTMLIB_ATOMIC_COPY_FIELD( plain_read_overhead.median);
+    WTMLIB_ATOMIC_COPY_FIELD( fenced_read_overhead.min);
+    WTMLIB_ATOMIC_COPY_FIELD( fenced_read_overhead.median);
+    WTMLIB_ATOMIC_COPY_FIELD( mfenced_read_overhead.min);
+    WTMLIB_ATOMIC_COPY_FIELD( mfenced_read_overhead.median);
+    WTMLIB_ATOMIC_COPY_FIELD( wide_mult);
+    WTMLIB_ATOMIC_COPY_FIELD( wide_shift);
+    WTMLIB_ATOMIC_COPY_FIELD( nsec_to_tsc_mult);
+    WTMLIB_ATOMIC_COPY_FIELD( nsec_to_tsc_shift);
+    WTMLIB_ATOMIC_COPY_FIELD( tscs_per_nsec_modulus);
+    WTMLIB_ATOMIC_COPY_FIELD( nsec_remainder_length);
+    WTMLIB_ATOMIC_COPY_FIELD( nsec_remainder_bitmask);
+
+#undef WTMLIB_ATOMIC_COPY_FIELD
+}
+
+/**
+ * Get a consistent copy of the parameters stored in a versioned container
+ *
+ * The function returns the version of the parameters: the number of updates made since
+ * the container was initialized. The version can be used to detect updates cheaply
+ */
+static inline uint64_t wtmlib_ReadVersionedTSCConversionParams(
+                                       const wtmlib_VersionedTSCConversionParams_t *vcp,
+                                       wtmlib_TSCConversionParams_t *conv_params)
+{
+    uint64_t seq;
+
+    do
+    {
+        seq = __atomic_load_n( &vcp->seq, __ATOMIC_ACQUIRE);
+        wtmlib_AtomicCopyTSCConversionParams( conv_params, &vcp->copies[seq & 1]);
+        __atomic_thread_fence( __ATOMIC_ACQUIRE);
+    } while ( seq != __atomic_load_n( &vcp->seq, __ATOMIC_RELAXED) );
+
+    return seq >> 1;
+}
+
+/**
+ * Convert TSC ticks to nanoseconds using the parameters stored in a versioned container
+ */
+static inline uint64_t wtmlib_TSCToNsecVersioned(
+                                       uint64_t tsc_ticks,
+                                       const wtmlib_VersionedTSCConversionParams_t *vcp)
+{
+    uint64_t seq, nsecs;
+
+    do
+    {
+        seq = __atomic_load_n( &vcp->seq, __ATOMIC_ACQUIRE);
+
+        const wtmlib_TSCConversionParams_t *cp = &vcp->copies[seq & 1];
+        uint64_t mult = __atomic_load_n( &cp->mult, __ATOMIC_RELAXED);
+        int shift = __atomic_load_n( &cp->shift, __ATOMIC_RELAXED);
+        uint64_t nsecs_per_tsc_modulus = __atomic_load_n( &cp->nsecs_per_tsc_modulus,
+                                                          __ATOMIC_RELAXED);
+        int tsc_remainder_length = __atomic_load_n( &cp->tsc_remainder_length,
+                                                    __ATOMIC_RELAXED);
+        uint64_t tsc_remainder_bitmask = __atomic_load_n( &cp->tsc_remainder_bitmask,
+                                                          __ATOMIC_RELAXED);
+
+        nsecs = (tsc_ticks >> tsc_remainder_length) * nsecs_per_tsc_modulus +
+                (((tsc_ticks & tsc_remainder_bitmask) * mult) >> shift);
+        __atomic_thread_fence( __ATOMIC_ACQUIRE);
+    } while ( seq != __atomic_load_n( &vcp->seq, __ATOMIC_RELAXED) );
+
+    return nsecs;
+}
+
+/**
+ * Convert TSC ticks to nanoseconds using the parameters stored in a versioned container
+ *
+ * "vcp_" is a pointer to a container of type wtmlib_VersionedTSCConversionParams_t.
+ * The conversion is consistent even if the parameters are updated concurrently. It costs
+ * a few more loads than WTMLIB_TSC_TO_NSEC() and a single well-predicted branch
+ */
+#define WTMLIB_TSC_TO_NSEC_VERSIONED( tsc_ticks_, vcp_) \
+    wtmlib_TSCToNsecVersioned( (tsc_ticks_), (vcp_))
+
+/**
+ * Initialize a versioned container of TSC-to-nanoseconds conversion parameters
+ *
+ * Both copies are set to "conv_params". The version is set to zero. The function must
+ * not be called while the container is in use by other threads
+ */
+void wtmlib_InitVersionedTSCConversionParams( wtmlib_VersionedTSCConversionParams_t *vcp,
+                                              const wtmlib_TSCConversionParams_t
+                                                  *conv_params);
+
+/**
+ * Update the parameters stored in a versioned container
+ *
+ * Readers are not blocked. They see either the old or the new parameters (never a mix
+ * of the two). The version is incremented by one. Concurrent updates of the same
+ * container must be serialized by the caller
+ */
+void wtmlib_PublishTSCConversionParams( wtmlib_VersionedTSCConversionParams_t *vcp,
+                                        const wtmlib_TSCConversionParams_t *conv_params);
+
+/**
+ * Start the drift tracker: a background thread that keeps TSC-to-nanoseconds conversion
+ * parameters in agreement with CLOCK_MONOTONIC_RAW
+ *
+ * TSC frequency measured during calibration is not exact. Over long periods of time
+ * intervals converted using fixed parameters drift away from the system time. The
+ * tracker samples TSC against CLOCK_MONOTONIC_RAW every WTMLIB_DRIFT_TRACKER_PERIOD
+ * microseconds (see wtmlib_config.h). TSC frequency is estimated by fitting a line to
+ * the last WTMLIB_DRIFT_TRACKER_WINDOW samples. Conversion parameters calculated from
+ * the estimate are published to a versioned container (see
+ * wtmlib_VersionedTSCConversionParams_t). They can be obtained at any moment by means
+ * of wtmlib_GetTrackedTSCConversionParams() or used directly with
+ * WTMLIB_TSC_TO_NSEC_VERSIONED() (see wtmlib_GetDriftTrackerParams()). Readers never
+ * block
+ *
+ * "conv_params" are the initial conversion parameters (obtained e.g. by means of
+ * wtmlib_GetTSCToNsecConversionParams()). They are published right away. Estimates
+ * that deviate from the initial TSC frequency by more than WTMLIB_DRIFT_TRACKER_MAX_DRIFT
+ * parts per million are discarded (along with the samples collected before). The
+ * overhead of reading TSC is copied from the initial parameters
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - all errors (including the cases when the tracker is
+ *                               already started or is being stopped)
+ *
+ * err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_StartDriftTracker( const wtmlib_TSCConversionParams_t *conv_params,
+                              char *err_msg, int err_msg_size);
+
+/**
+ * Stop the drift tracker
+ *
+ * The function returns when the tracker thread has exited. The parameters published
+ * last stay available through wtmlib_GetTrackedTSCConversionParams(). The tracker can
+ * be started again afterwards
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - all errors (including the cases when the tracker is not
+ *                               started or is already being stopped)
+ *
+ * err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_StopDriftTracker( char *err_msg, int err_msg_size);
+
+/**
+ * Get the most recent TSC-to-nanoseconds conversion parameters published by the drift
+ * tracker
+ *
+ * The function doesn't take locks. It's cheap enough to be called periodically from
+ * hot paths. The returned copy should be used for conversions until the next call
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - the drift tracker was never started
+ *
+ * Besides the regular return value the function returns (if the corresponding pointers
+ * are non-zero):
+ *      conv_params - the conversion parameters
+ *      err_msg - human-readable error message
+ *
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * "conv_params". err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_GetTrackedTSCConversionParams( wtmlib_TSCConversionParams_t *conv_params,
+                                          char *err_msg, int err_msg_size);
+
+/**
+ * Get the versioned container that the drift tracker publishes conversion parameters to
+ *
+ * The container can be passed to WTMLIB_TSC_TO_NSEC_VERSIONED(). Conversions made
+ * before the drift tracker was ever started yield zero
+ */
+const wtmlib_VersionedTSCConversionParams_t *wtmlib_GetDriftTrackerParams( void);
+
+/**
+ * A single trace record
+ */
+typedef struct
+{
+    /* TSC value at the moment of the event */
+    uint64_t tsc;
+    /* Arbitrary client-defined data associated with the event */
+    uint64_t payload;
+    /* Client-defined ID of the event */
+    uint32_t event_id;
+    /* Padding. Not used */
+    uint32_t reserved;
+} wtmlib_TraceRecord_t;
+
+/**
+ * Single-producer single-consumer ring buffer of trace records
+ *
+ * Every thread that produces trace records must append them to its own ring (obtained
+ * by means of wtmlib_CreateTraceRing() or wtmlib_GetThreadTraceRing()). Records are
+ * read by a single consumer using wtmlib_DrainTrace(). The fields are not intended for
+ * direct use by the client
+ */
+typedef struct wtmlib_TraceRing
+{
+    /* Array of records. Number of records is a power of 2 */
+    wtmlib_TraceRecord_t *records;
+    /* Number of records minus 1 */
+    uint64_t mask;
+    /* Cache line modified only by the producer:
+           prod[0] - total number of records appended to the ring ("head")
+           prod[1] - the last value of "tail" seen by the producer
+           prod[2] - number of records dropped because the ring was full */
+    uint64_t *prod;
+    /* Cache line modified only by the consumer:
+           cons[0] - total number of records consumed from the ring ("tail") */
+    uint64_t *cons;
+    /* ID of the ring (rings are numbered in the order of creation starting from 0) */
+    int id;
+    /* Whether the producer doesn't use the ring anymore (see
+       wtmlib_ReleaseTraceRing()) */
+    bool is_released;
+    /* Tracer the ring belongs to */
+    struct wtmlib_Tracer *tracer;
+    /* Next ring of the same tracer */
+    struct wtmlib_TraceRing *next;
+} wtmlib_TraceRing_t;
+
+/**
+ * Append a record to a trace ring
+ *
+ * The function is wait-free. If the ring is full, the record is dropped (and counted as
+ * such). The function returns "true" if the record was stored and "false" otherwise
+ */
+static inline bool wtmlib_AppendTraceRecord( wtmlib_TraceRing_t *ring, uint64_t tsc,
+                                             uint32_t event_id, uint64_t payload)
+{
+    uint64_t head = ring->prod[0];
+    wtmlib_TraceRecord_t *record = 0;
+
+    /* The consumer's cache line is touched only when the ring looks full */
+    if ( head - ring->prod[1] > ring->mask )
+    {
+        ring->prod[1] = __atomic_load_n( ring->cons, __ATOMIC_ACQUIRE);
+
+        if ( head - ring->prod[1] > ring->mask )
+        {
+            __atomic_store_n( &ring->prod[2], ring->prod[2] + 1, __ATOMIC_RELAXED);
+
+            return false;
+        }
+    }
+
+    record = &ring->records[head & ring->mask];
+    record->tsc = tsc;
+    record->payload = payload;
+    record->event_id = event_id;
+    /* Publish the record to the consumer */
+    __atomic_store_n( ring->prod, head + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/**
+ * Append a trace record stamped with the current TSC value to the given trace ring
+ *
+ * Evaluates to "true" if the record was stored and to "false" if it was dropped because
+ * the ring was full
+ */
+#define WTMLIB_TRACE_EVENT( ring_, event_id_, payload_) \
+    wtmlib_AppendTraceRecord( (ring_), WTMLIB_GET_TSC(), (event_id_), (payload_))
+
+/**
+ * Trace record converted to nanoseconds
+ */
+typedef struct
+{
+    /* Nanoseconds elapsed since creation of the tracer */
+    uint64_t nsec;
+    /* Client-defined data associated with the event */
+    uint64_t payload;
+    /* Client-defined ID of the event */
+    uint32_t event_id;
+    /* ID of the ring the record was read from */
+    int ring_id;
+} wtmlib_TraceEvent_t;
+
+/**
+ * Tracer: a set of per-thread trace rings that share a single consumer
+ */
+typedef struct wtmlib_Tracer wtmlib_Tracer_t;
+
+/**
+ * Create a tracer
+ *
+ * "ring_capacity" is the number of records that each ring of the tracer can hold. It's
+ * rounded up to the nearest power of 2 (and cannot exceed WTMLIB_TRACE_MAX_RING_CAPACITY
+ * defined in wtmlib_config.h)
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - all errors
+ *
+ * Besides the regular return value the function returns (if the corresponding pointers
+ * are non-zero):
+ *      tracer - the created tracer. Must be destroyed after use by means of
+ *               wtmlib_DestroyTracer()
+ *      err_msg - human-readable error message
+ *
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * "tracer". err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_CreateTracer( uint64_t ring_capacity, wtmlib_Tracer_t **tracer,
+                         char *err_msg, int err_msg_size);
+
+/**
+ * Create a new trace ring and attach it to the tracer
+ *
+ * Normally every producing thread calls this function once and then appends records to
+ * the returned ring using WTMLIB_TRACE_EVENT(). The function can be called concurrently
+ * with itself and with wtmlib_DrainTrace(). The ring is owned by the tracer. It can be
+ * released by means of wtmlib_ReleaseTraceRing() when the thread doesn't need it
+ * anymore. Otherwise, it's released by wtmlib_DestroyTracer(). Memory of released rings
+ * is reused by this function
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - all errors
+ *
+ * Besides the regular return value the function returns (if the corresponding pointers
+ * are non-zero):
+ *      ring - the created ring
+ *      err_msg - human-readable error message
+ *
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * "ring". err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_CreateTraceRing( wtmlib_Tracer_t *tracer, wtmlib_TraceRing_t **ring,
+                            char *err_msg, int err_msg_size);
+
+/**
+ * Release a trace ring that is not going to be used by its producer anymore
+ *
+ * Records already appended to the ring are not lost. They are read by
+ * wtmlib_DrainTrace() as usual. When the ring becomes empty, wtmlib_DrainTrace()
+ * detaches it from the tracer for reuse by wtmlib_CreateTraceRing(). The ring must not
+ * be used after this call. Records dropped by the ring remain accounted by the tracer
+ */
+void wtmlib_ReleaseTraceRing( wtmlib_TraceRing_t *ring);
+
+/**
+ * Get the trace ring of the calling thread
+ *
+ * On the first call in a thread the ring is created by means of wtmlib_CreateTraceRing().
+ * Subsequent calls in the same thread return the same ring. The ring is released (see
+ * wtmlib_ReleaseTraceRing()) automatically when the thread exits. Thus, threads that
+ * come and go don't accumulate rings
+ *
+ * Possible return codes and the use of "ring" and "err_msg" are the same as for
+ * wtmlib_CreateTraceRing()
+ */
+int wtmlib_GetThreadTraceRing( wtmlib_Tracer_t *tracer, wtmlib_TraceRing_t **ring,
+                               char *err_msg, int err_msg_size);
+
+/**
+ * Read records from all rings of the tracer and convert them to nanoseconds
+ *
+ * At most "max_events" records are read. Records of each ring are returned in the order
+ * they were appended. Records of different rings are not interleaved by time. If fewer
+ * than "max_events" records are returned, all the rings were empty at the moment of
+ * reading. Timestamps of records made before creation of the tracer (e.g. on a CPU with
+ * a shifted TSC) are converted to 0 nanoseconds.
+ * Only one thread at a time may drain the tracer
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - all errors
+ *
+ * Besides the regular return value the function returns (if the corresponding pointers
+ * are non-zero):
+ *      num_events - number of records stored to "events"
+ *      num_dropped - total number of records dropped by all the rings since creation of
+ *                    the tracer
+ *      err_msg - human-readable error message
+ *
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * "num_events" and "num_dropped". err_msg is modified only if the return code is
+ * non-zero
+ */
+int wtmlib_DrainTrace( wtmlib_Tracer_t *tracer,
+                       const wtmlib_TSCConversionParams_t *conv_params,
+                       wtmlib_TraceEvent_t *events, int max_events, int *num_events,
+                       uint64_t *num_dropped, char *err_msg, int err_msg_size);
+
+/**
+ * Destroy the tracer and all its rings
+ *
+ * Must not be called while any of the rings is in use. Rings obtained by means of
+ * wtmlib_GetThreadTraceRing() are not released on exit of their threads after the
+ * tracer is destroyed
+ */
+void wtmlib_DestroyTracer( wtmlib_Tracer_t *tracer);
+
+/*
+   Magic string that starts every trace file
+*/
+#define WTMLIB_TRACE_FILE_MAGIC "WTMTRACE"
+/*
+   Version of the trace file format
+*/
+#define WTMLIB_TRACE_FILE_VERSION 1
+
+/**
+ * Header of a trace file
+ *
+ * A trace file consists of:
+ *      1) the header
+ *      2) an array of "num_cpus" per-CPU TSC offsets (int64_t) that immediately follows
+ *         the header
+ *      3) the counter of appended records (uint64_t) located at "counter_offset". The
+ *         counter may exceed "capacity". In that case the excess records were dropped
+ *      4) an array of "capacity" records located at "records_offset"
+ * All values are stored in the native byte order. Records with zero TSC were not written
+ * (e.g. because the writing process crashed)
+ */
+typedef struct
+{
+    /* WTMLIB_TRACE_FILE_MAGIC (without the terminating zero) */
+    char magic[8];
+    /* WTMLIB_TRACE_FILE_VERSION */
+    uint32_t version;
+    /* Size of a single record */
+    uint32_t record_size;
+    /* Maximum number of records */
+    uint64_t capacity;
+    /* Offset of the records counter from the beginning of the file */
+    uint64_t counter_offset;
+    /* Offset of the array of records from the beginning of the file */
+    uint64_t records_offset;
+    /* Corrected TSC value at the moment of the file creation */
+    uint64_t start_tsc;
+    /* TSC-to-nanoseconds conversion parameters */
+    wtmlib_TSCConversionParams_t conv_params;
+    /* Number of per-CPU TSC offsets (0 if the offsets were not provided) */
+    int32_t num_cpus;
+    /* ID of the base CPU of the offsets */
+    int32_t base_cpu;
+    /* Uncertainty of the offsets (see wtmlib_TSCOffsetTable_t) */
+    int64_t max_uncertainty;
+} wtmlib_TraceFileHeader_t;
+
+/**
+ * A single record of a trace file
+ */
+typedef struct
+{
+    /* Raw (uncorrected) TSC value at the moment of the event. Written last */
+    uint64_t tsc;
+    /* Arbitrary client-defined data associated with the event */
+    uint64_t payload;
+    /* Client-defined ID of the event */
+    uint32_t event_id;
+    /* ID of the CPU that TSC was read on */
+    uint32_t cpu_id;
+} wtmlib_TraceFileRecord_t;
+
+/**
+ * Trace file opened for writing. The fields are not intended for direct use by the
+ * client
+ */
+typedef struct
+{
+    /* Array of records (inside the mapping) */
+    wtmlib_TraceFileRecord_t *records;
+    /* Maximum number of records */
+    uint64_t capacity;
+    /* Counter of appended records (inside the mapping, on a separate cache line) */
+    uint64_t *num_records;
+    /* Address and size of the mapping */
+    void *map_addr;
+    uint64_t map_size;
+    /* File descriptor */
+    int fd;
+} wtmlib_TraceFile_t;
+
+/**
+ * Append a record to a trace file
+ *
+ * The function is thread-safe and doesn't make system calls. If the file is full, the
+ * record is dropped. The function returns "true" if the record was stored and "false"
+ * otherwise
+ */
+static inline bool wtmlib_AppendTraceFileRecord( wtmlib_TraceFile_t *file,
+                                                 uint32_t event_id, uint64_t payload)
+{
+    uint64_t ind = __atomic_fetch_add( file->num_records, 1, __ATOMIC_RELAXED);
+    wtmlib_TraceFileRecord_t *record = 0;
+    uint64_t tsc = 0;
+    int cpu_id = 0;
+
+    if ( ind >= file->capacity ) return false;
+
+    record = &file->records[ind];
+    tsc = WTMLIB_GET_TSC_AND_CPU( &cpu_id);
+    record->payload = payload;
+    record->event_id = event_id;
+    record->cpu_id = cpu_id;
+    /* Non-zero TSC marks the record as complete */
+    __atomic_store_n( &record->tsc, tsc, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/**
+ * Append a record stamped with the current TSC value to the given trace file
+ *
+ * Evaluates to "true" if the record was stored and to "false" if it was dropped because
+ * the file was full
+ */
+#define WTMLIB_TRACE_FILE_EVENT( file_, event_id_, payload_) \
+    wtmlib_AppendTraceFileRecord( (file_), (event_id_), (payload_))
+
+/**
+ * Create a trace file and map it to memory
+ *
+ * The file is created (or truncated) at "path" and preallocated to hold "capacity"
+ * records (no more than WTMLIB_TRACE_FILE_MAX_CAPACITY defined in wtmlib_config.h). The
+ * header of the file stores "conv_params" and, if "offset_table" is non-zero, per-CPU
+ * TSC offsets. Thus, records are written raw and converted to nanoseconds offline (e.g.
+ * by the "trace_reader" tool). Records are appended by means of
+ * WTMLIB_TRACE_FILE_EVENT() which reads ID of the current CPU along with TSC. The
+ * function checks that it's possible
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - all errors
+ *
+ * Besides the regular return value the function returns (if the corresponding pointers
+ * are non-zero):
+ *      file - the opened trace file. Must be closed after use by means of
+ *             wtmlib_CloseTraceFile()
+ *      err_msg - human-readable error message
+ *
+ * "path" and "conv_params" must be non-zero.
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * "file". err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_CreateTraceFile( const char *path, uint64_t capacity,
+                            const wtmlib_TSCConversionParams_t *conv_params,
+                            const wtmlib_TSCOffsetTable_t *offset_table,
+                            wtmlib_TraceFile_t **file, char *err_msg, int err_msg_size);
+
+/**
+ * Flush a trace file to disk, unmap it and close it
+ *
+ * Must not be called while records are being appended to the file. The function
+ * releases all resources associated with "file" even if it returns an error
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - all errors
+ *
+ * err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_CloseTraceFile( wtmlib_TraceFile_t *file, char *err_msg, int err_msg_size);
+
+/**
+ * Log-linear histogram of TSC tick deltas
+ *
+ * Every power-of-2 range of tick values is split into 2^sub_bucket_bits equal buckets.
+ * Thus, the relative width of a bucket never exceeds 2^(-sub_bucket_bits). Values
+ * smaller than 2^sub_bucket_bits are stored exactly. The memory footprint is fixed.
+ *
+ * A histogram instance must be modified by a single thread. Instances of different
+ * threads can be merged by means of wtmlib_MergeHistogram() without stopping the
+ * threads. The fields are not intended for direct use by the client
+ */
+typedef struct
+{
+    /* Per-bucket counters. The array is aligned to the cache line size */
+    uint64_t *counts;
+    /* Upper bounds of the buckets converted to nanoseconds (precomputed at creation) */
+    uint64_t *bucket_nsecs;
+    /* Number of buckets */
+    int num_buckets;
+    /* Log2 of the number of buckets per power-of-2 range of values */
+    int sub_bucket_bits;
+} wtmlib_Histogram_t;
+
+/**
+ * Get index of the bucket that holds the given number of TSC ticks
+ *
+ * Let "e" be the position of the most significant bit of (ticks | 2^sub_bucket_bits)
+ * minus sub_bucket_bits. Then the index is (e << sub_bucket_bits) + (ticks >> e)
+ */
+static inline int wtmlib_GetHistogramBucketIndex( int sub_bucket_bits, uint64_t ticks)
+{
+    int exp = 63 - __builtin_clzll( ticks | (1ULL << sub_bucket_bits)) -
+              sub_bucket_bits;
+
+    return (exp << sub_bucket_bits) + (int)(ticks >> exp);
+}
+
+/**
+ * Record the given number of TSC ticks to the histogram
+ *
+ * The counter is updated by means of a relaxed atomic store, so that concurrent merging
+ * is well-defined. On the supported architectures it compiles to a plain increment
+ */
+static inline void wtmlib_RecordToHistogram( wtmlib_Histogram_t *hist, uint64_t ticks)
+{
+    uint64_t *counter =
+        &hist->counts[wtmlib_GetHistogramBucketIndex( hist->sub_bucket_bits, ticks)];
+
+    __atomic_store_n( counter, *counter + 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Record TSC ticks elapsed between "start_tsc_" and "end_tsc_" to the histogram
+ */
+#define WTMLIB_HISTOGRAM_RECORD( hist_, start_tsc_, end_tsc_) \
+    wtmlib_RecordToHistogram( (hist_), (end_tsc_) - (start_tsc_))
+
+/**
+ * Create a histogram of TSC tick deltas
+ *
+ * Resolution of the histogram is defined by WTMLIB_HISTOGRAM_SUB_BUCKET_BITS in
+ * wtmlib_config.h. Bucket boundaries are converted to nanoseconds in advance using
+ * "conv_params". Histograms that are going to be merged must be created with the same
+ * conversion parameters
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - all errors
+ *
+ * Besides the regular return value the function returns (if the corresponding pointers
+ * are non-zero):
+ *      hist - the created (empty) histogram. Must be released after use by means of
+ *             wtmlib_FreeHistogram()
+ *      err_msg - human-readable error message
+ *
+ * "conv_params" must be non-zero.
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * "hist". err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_CreateHistogram( const wtmlib_TSCConversionParams_t *conv_params,
+                            wtmlib_Histogram_t *hist, char *err_msg, int err_msg_size);
+
+/**
+ * Release memory allocated by wtmlib_CreateHistogram()
+ */
+void wtmlib_FreeHistogram( wtmlib_Histogram_t *hist);
+
+/**
+ * Zero all counters of the histogram
+ *
+ * Must be called by the thread that records to the histogram (or when no thread does)
+ */
+void wtmlib_ResetHistogram( wtmlib_Histogram_t *hist);
+
+/**
+ * Add counters of histogram "src" to histogram "dst"
+ *
+ * "src" may be concurrently recorded to by its owner thread. "dst" must not be modified
+ * concurrently
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - all errors (e.g. the histograms have different layouts)
+ *
+ * err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_MergeHistogram( wtmlib_Histogram_t *dst, const wtmlib_Histogram_t *src,
+                           char *err_msg, int err_msg_size);
+
+/**
+ * Get values (in nanoseconds) at the given percentiles of the histogram
+ *
+ * "percentiles" is an array of "num_percentiles" values in the range [0, 100]. For each
+ * percentile "p" the function finds the smallest bucket such that at least p% of the
+ * recorded values are less than or equal to the values of the bucket. The upper bound
+ * of the bucket (converted to nanoseconds) is stored to the corresponding element of
+ * "nsecs"
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - all errors (including the case when the histogram is
+ *                               empty)
+ *
+ * Besides the regular return value the function returns (if the corresponding pointers
+ * are non-zero):
+ *      nsecs - values at the percentiles (in nanoseconds)
+ *      total_count - total number of values recorded to the histogram
+ *      err_msg - human-readable error message
+ *
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * "nsecs" and "total_count". err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_GetHistogramPercentiles( const wtmlib_Histogram_t *hist,
+                                    const double *percentiles, int num_percentiles,
+                                    uint64_t *nsecs, uint64_t *total_count,
+                                    char *err_msg, int err_msg_size);
+
+/**
+ * Convert an array of TSC values to nanoseconds
+ *
+ * "count" TSC values are read from "tscs". The results are stored to "nsecs". The
+ * conversion is exactly the same as the one done by WTMLIB_TSC_TO_NSEC(). On x86-64 it
+ * uses AVX-512 or AVX2 (whatever is the best the CPU supports; detected at run time).
+ * Other CPUs use a scalar loop. "tscs" and "nsecs" may point to the same array. Other
+ * kinds of overlap are not allowed
+ */
+void wtmlib_TSCToNsecBatch( const uint64_t *tscs, uint64_t *nsecs, size_t count,
+                            const wtmlib_TSCConversionParams_t *conv_params);
+
+/**
+ * Convert an array of TSC values to nanoseconds elapsed since "base_tsc"
+ *
+ * Same as wtmlib_TSCToNsecBatch(), but "base_tsc" is subtracted from each TSC value
+ * before the conversion. TSC values that don't exceed "base_tsc" are converted to zero
+ */
+void wtmlib_TSCToNsecBatchDelta( const uint64_t *tscs, uint64_t *nsecs, size_t count,
+                                 uint64_t base_tsc,
+                                 const wtmlib_TSCConversionParams_t *conv_params);
+
+/**
+ * Estimate the latency of waking up from nanosleep()
+ *
+ * The function calls nanosleep() WTMLIB_SLEEP_CALIBRATION_ROUNDS times (see
+ * wtmlib_config.h) and measures by how much each call oversleeps. The
+ * WTMLIB_SLEEP_LATENCY_PERCENTILE percentile of the measurements is taken as the
+ * estimate. The estimate is used by all subsequent calls to wtmlib_SleepUntilTSC() and
+ * wtmlib_SleepForNsec(). Before the first calibration WTMLIB_SLEEP_DEFAULT_WAKEUP_LATENCY
+ * is used. The calibration should be repeated if the scheduling environment of the
+ * process changes (e.g. real-time priority is assigned)
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - all errors
+ *
+ * Besides the regular return value the function returns (if the corresponding pointers
+ * are non-zero):
+ *      wakeup_latency - the estimated latency (in nanoseconds)
+ *      err_msg - human-readable error message
+ *
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * "wakeup_latency". err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_CalibrateSleep( const wtmlib_TSCConversionParams_t *conv_params,
+                           uint64_t *wakeup_latency, char *err_msg, int err_msg_size);
+
+/**
+ * Sleep until TSC reaches "deadline_tsc"
+ *
+ * The coarse part of the wait is done by means of nanosleep(). The CPU is released to
+ * other threads during that part. The function wakes up ahead of the deadline by the
+ * estimated wake-up latency (see wtmlib_CalibrateSleep()) plus
+ * WTMLIB_SLEEP_MIN_SPIN_TIME nanoseconds. The rest of the wait is a spin on TSC. While
+ * spinning, the CPU is hinted to save power and to give way to sibling hardware threads
+ * (by means of TPAUSE or PAUSE on x86-64, or by lowering the thread priority on PPC64).
+ * The function returns within a fraction of a microsecond after the deadline unless
+ * the thread is preempted or the wake-up latency is underestimated
+ *
+ * Possible return codes:
+ *      0 - in case of success (including the case when the deadline has already passed)
+ *      WTMLIB_RET_GENERIC_ERR - all errors
+ *
+ * err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_SleepUntilTSC( uint64_t deadline_tsc,
+                          const wtmlib_TSCConversionParams_t *conv_params,
+                          char *err_msg, int err_msg_size);
+
+/**
+ * Sleep for "nsecs" nanoseconds
+ *
+ * Same as wtmlib_SleepUntilTSC() with the deadline computed by means of
+ * WTMLIB_TSC_DEADLINE()
+ */
+int wtmlib_SleepForNsec( uint64_t nsecs, const wtmlib_TSCConversionParams_t *conv_params,
+                         char *err_msg, int err_msg_size);
+
+/**
+ * Function benchmarked by means of wtmlib_RunBenchmark()
+ *
+ * The function must execute the benchmarked code "num_iterations" times. "arg" is the
+ * argument passed to wtmlib_RunBenchmark(). Results of the benchmarked code should be
+ * consumed (e.g. stored to a volatile variable). Otherwise, the compiler may eliminate
+ * the code
+ */
+typedef void (*wtmlib_BenchFunc_t)( void *arg, uint64_t num_iterations);
+
+/**
+ * Parameters of a micro-benchmark
+ */
+typedef struct
+{
+    /* CPU that the benchmark runs on. If negative, the thread is not pinned */
+    int cpu_id;
+    /* Number of iterations executed before the measurements start */
+    uint64_t num_warmup_iterations;
+    /* Number of samples */
+    uint64_t num_samples;
+    /* Number of iterations timed as a single sample */
+    uint64_t iterations_per_sample;
+} wtmlib_BenchParams_t;
+
+/**
+ * Results of a micro-benchmark. Times are given per iteration (in nanoseconds)
+ */
+typedef struct
+{
+    /* The fastest sample */
+    double min_nsec;
+    /* The median sample */
+    double median_nsec;
+    /* The 99th percentile */
+    double p99_nsec;
+    /* The slowest sample */
+    double max_nsec;
+    /* Average of the samples "cleaned" from outliers */
+    double mean_nsec;
+    /* Standard error of the "cleaned" average (infinite if there is only one "good"
+       sample) */
+    double std_error_nsec;
+    /* Number of samples */
+    uint64_t num_samples;
+    /* Number of samples excluded from the "cleaned" average */
+    uint64_t num_outliers;
+} wtmlib_BenchResult_t;
+
+/**
+ * Run a micro-benchmark
+ *
+ * The thread is pinned to the requested CPU (the initial CPU affinity is restored in
+ * the end). Then "func" is called once to execute the warm-up iterations. After that it
+ * is called "num_samples" times to execute "iterations_per_sample" iterations each.
+ * Every call is timed by means of WTMLIB_GET_TSC_START() / WTMLIB_GET_TSC_END(). The
+ * overhead of the fenced TSC reads is subtracted from each sample. The overhead is
+ * taken from "conv_params" if it was measured by wtmlib_MeasureTSCReadOverhead().
+ * Otherwise, it's measured by means of wtmlib_GetFencedTSCReadOverhead().
+ *
+ * Percentiles are computed over all the samples. The average is "cleaned" from
+ * outliers the same way as TSC-per-second samples are cleaned during calibration:
+ * samples that deviate from the mean by more than the standard deviation are ignored.
+ *
+ * If "params" is zero, default parameters are used (see WTMLIB_BENCH_* in
+ * wtmlib_config.h). The thread is not pinned in that case
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - all errors
+ *
+ * Besides the regular return value the function returns (if the corresponding pointers
+ * are non-zero):
+ *      result - results of the benchmark
+ *      err_msg - human-readable error message
+ *
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * "result". err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_RunBenchmark( wtmlib_BenchFunc_t func, void *arg,
+                         const wtmlib_BenchParams_t *params,
+                         const wtmlib_TSCConversionParams_t *conv_params,
+                         wtmlib_BenchResult_t *result, char *err_msg, int err_msg_size);
+
+/**
+ * Register a region profiled by means of wtmlib_ProfilerEnter() / wtmlib_ProfilerExit()
+ *
+ * If a region with the same name is already registered, its ID is returned. The
+ * function is thread-safe. It takes a lock, so it's not supposed to be called on hot
+ * paths. WTMLIB_PROFILER_ENTER() registers a region once per call site
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - all errors
+ *
+ * Besides the regular return value the function returns (if the corresponding pointers
+ * are non-zero):
+ *      region_id - ID of the region
+ *      err_msg - human-readable error message
+ *
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * "region_id". err_msg is modified only if the return code is non-zero
+ */
+int wtmlib_ProfilerRegisterRegion( const char *name, int *region_id, char *err_msg,
+                                   int err_msg_size);
+
+/**
+ * Enter and exit a profiled region
+ *
+ * Each thread keeps a stack of regions it currently executes. Entering a region pushes
+ * it to the stack together with the current TSC value. Exiting pops the most recently
+ * entered region and adds the elapsed TSC ticks to per-thread statistics of the region:
+ *      - inclusive time: time spent in the region, including nested regions. Recursive
+ *        instances of a region are accounted once
+ *      - exclusive time: time spent in the region minus time spent in the regions
+ *        directly nested into it
+ *
+ * The functions don't take locks and don't make system calls (except the very first
+ * wtmlib_ProfilerEnter() call in a thread, which allocates the thread's state). Enter
+ * and exit calls must be balanced. A negative "region_id" (i.e. of a region that
+ * couldn't be registered) is allowed: the region participates in the nesting but is not
+ * reported. Regions nested deeper than WTMLIB_PROFILER_MAX_DEPTH are not profiled
+ * either (they are counted as "dropped")
+ */
+void wtmlib_ProfilerEnter( int region_id);
+void wtmlib_ProfilerExit( void);
+
+/**
+ * Enter a region named "name_". The region is registered the first time the call site
+ * is executed. If registration fails, it's not retried: the call site is never
+ * reported. Must be paired with WTMLIB_PROFILER_EXIT() in the same scope:
+ *
+ *      WTMLIB_PROFILER_ENTER( "parse_request");
+ *      ...
+ *      WTMLIB_PROFILER_EXIT();
+ */
+#define WTMLIB_PROFILER_ENTER( name_)                                                 \
+    do                                                                                \
+    {                                                                                 \
+        /* -1: not registered yet; -2: registration failed */                        \
+        static int _wtmlib_region_id = -1;                                            \
+        int _id = __atomic_load_n( &_wtmlib_region_id, __ATOMIC_RELAXED);             \
+                                                                                      \
+        if ( __builtin_expect( _id == -1, 0) )                                        \
+        {                                                                             \
+            if ( wtmlib_ProfilerRegisterRegion( (name_), &_id, 0, 0) ) _id = -2;      \
+                                                                                      \
+            __atomic_store_n( &_wtmlib_region_id, _id, __ATOMIC_RELAXED);             \
+        }                                                                             \
+                                                                                      \
+        wtmlib_ProfilerEnter( _id < 0 ? -1 : _id);                                    \
+    } while ( 0)
+
+#define WTMLIB_PROFILER_EXIT() wtmlib_ProfilerExit()
+
+/**
+ * Aggregated statistics of a profiled region
+ */
+typedef struct
+{
+    /* Name of the region */
+    const char *name;
+    /* Number of completed executions of the region */
+    uint64_t num_calls;
+    /* Inclusive and exclusive time in TSC ticks */
+    uint64_t inclusive_ticks;
+    uint64_t exclusive_ticks;
+    /* The same in nanoseconds */
+    uint64_t inclusive_nsecs;
+    uint64_t exclusive_nsecs;
+} wtmlib_ProfilerRegionStats_t;
+
+/**
+ * Collect profiling statistics of all the threads
+ *
+ * Per-thread statistics are summed up in TSC ticks. Then the sums are converted to
+ * nanoseconds. The function may be called at any moment from any thread. Profiled
+ * threads are not stopped. Thus, statistics of different regions may be collected at
+ * slightly different moments. Executions of regions that are not yet completed are not
+ * included. Statistics of threads that already exited are included (they are added up
+ * when a thread exits, and the thread's state is released). The function takes a lock
+ * that is also taken by exiting profiled threads
+ *
+ * Statistics of region "i" (as returned by wtmlib_ProfilerRegisterRegion()) are stored
+ * to stats[i]. At most "max_num_regions" regions are reported
+ *
+ * Possible return codes:
+ *      0 - in case of success
+ *      WTMLIB_RET_GENERIC_ERR - all errors
+ *
+ * Besides the regular return value the function returns (if the corresponding pointers
+ * are non-zero):
+ *      num_regions - number of registered regions (may exceed "max_num_regions")
+ *      num_dropped - number of region executions that were not profiled because the
+ *                    nesting was too deep
+ *      err_msg - human-readable error message
+ *
+ * In case of non-zero return code, the function doesn't modify memory referenced by
+ * "stats", "num_regions", and "num_dropped". err_msg is modified only if the return
+ * code is non-zero
+ */
+int wtmlib_ProfilerGetReport( const wtmlib_TSCConversionParams_t *conv_params,
+                              wtmlib_ProfilerRegionStats_t *stats, int max_num_regions,
+                              int *num_regions, uint64_t *num_dropped, char *err_msg,
+                              int err_msg_size);
+
 #endif /* _WTMLIB_H_ */
@@ -0,0 +1,573 @@
+/**
+ * Copyright © 2018 Andrey Nevolin, https://github.com/AndreyNevolin
+ * Twitter: @Andrey_Nevolin
+ * LinkedIn: https://www.linkedin.com/in/andrey-nevolin-76387328
+ *
+ * WTMLIB: a library for taking Wall-clock Time Measurements
+ *
+ * Header-only C++ front end of the library. Everything here is a thin inline layer on
+ * top of the macros and functions declared in wtmlib.h. Reading the clock compiles to a
+ * bare TSC read. Recording an interval into a histogram compiles to a TSC read, a
+ * subtraction, a few bit operations and an increment
+ */
+
+#ifndef _WTMLIB_HPP_
+#define _WTMLIB_HPP_
+
+#include <chrono>
+#include <ratio>
+#include <cstdint>
+#include <cstdio>
+
+#include "wtmlib.h"
+#include "wtmlib_config.h"
+
+namespace wtmlib
+{
+
+/**
+ * Number of TSC ticks. Representation of durations of tsc_clock
+ *
+ * TSC frequency is not known at compile time. So, tsc_clock can't have an exact
+ * "period". Unlike arithmetic types, tsc_ticks is not convertible to or from other
+ * representations. Thus, std::chrono refuses to convert durations of tsc_clock to other
+ * durations (both implicitly and by means of std::chrono::duration_cast()). Such
+ * conversions are done by tsc_converter (see below)
+ */
+class tsc_ticks
+{
+public:
+    constexpr tsc_ticks() : ticks_( 0)
+    {
+    }
+
+    constexpr explicit tsc_ticks( int64_t ticks) : ticks_( ticks)
+    {
+    }
+
+    constexpr int64_t count() const
+    {
+        return ticks_;
+    }
+
+    constexpr tsc_ticks operator+() const
+    {
+        return *this;
+    }
+
+    constexpr tsc_ticks operator-() const
+    {
+        return tsc_ticks( -ticks_);
+    }
+
+    tsc_ticks &operator+=( tsc_ticks t)
+    {
+        ticks_ += t.ticks_;
+
+        return *this;
+    }
+
+    tsc_ticks &operator-=( tsc_ticks t)
+    {
+        ticks_ -= t.ticks_;
+
+        return *this;
+    }
+
+    friend constexpr tsc_ticks operator+( tsc_ticks a, tsc_ticks b)
+    {
+        return tsc_ticks( a.ticks_ + b.ticks_);
+    }
+
+    friend constexpr tsc_ticks operator-( tsc_ticks a, tsc_ticks b)
+    {
+        return tsc_ticks( a.ticks_ - b.ticks_);
+    }
+
+    friend constexpr bool operator==( tsc_ticks a, tsc_ticks b)
+    {
+        return a.ticks_ == b.ticks_;
+    }
+
+    friend constexpr bool operator!=( tsc_ticks a, tsc_ticks b)
+    {
+        return a.ticks_ != b.ticks_;
+    }
+
+    friend constexpr bool operator<( tsc_ticks a, tsc_ticks b)
+    {
+        return a.ticks_ < b.ticks_;
+    }
+
+    friend constexpr bool operator>( tsc_ticks a, tsc_ticks b)
+    {
+        return a.ticks_ > b.ticks_;
+    }
+
+    friend constexpr bool operator<=( tsc_ticks a, tsc_ticks b)
+    {
+        return a.ticks_ <= b.ticks_;
+    }
+
+    friend constexpr bool operator>=( tsc_ticks a, tsc_ticks b)
+    {
+        return a.ticks_ >= b.ticks_;
+    }
+
+private:
+    int64_t ticks_;
+};
+
+/**
+ * Clock that satisfies the requirements of std::chrono's TrivialClock. The clock ticks
+ * with TSC
+ *
+ * Durations of the clock are represented by tsc_ticks. "period" is only nominal. It's
+ * never used for conversions, because std::chrono can't convert tsc_ticks to anything
+ * else. tsc_converter must be used to get durations in nanoseconds:
+ *      auto start = tsc_clock::now();
+ *      ...
+ *      std::chrono::nanoseconds elapsed = converter.to_duration( tsc_clock::now() -
+ *                                                                start);
+ * If TSC frequency is known at compile time, fixed_tsc_clock (see below) can be used.
+ * Its period is exact.
+ *
+ * The clock is steady as long as TSC is reliable on the system (see
+ * wtmlib_EvalTSCReliabilityCOP() and wtmlib_EvalTSCReliabilityCPUSW())
+ */
+struct tsc_clock
+{
+    typedef tsc_ticks rep;
+    typedef std::ratio<1> period;
+    typedef std::chrono::duration<rep, period> duration;
+    typedef std::chrono::time_point<tsc_clock> time_point;
+
+    static constexpr bool is_steady = true;
+
+    static time_point now() noexcept
+    {
+        return time_point( duration( rep( (int64_t)WTMLIB_GET_TSC())));
+    }
+
+    /* Reordering-safe versions of now(). Must be used in pairs:
+           auto start = tsc_clock::now_start();
+           ...
+           auto end = tsc_clock::now_end(); */
+    static time_point now_start() noexcept
+    {
+        return time_point( duration( rep( (int64_t)WTMLIB_GET_TSC_START())));
+    }
+
+    static time_point now_end() noexcept
+    {
+        return time_point( duration( rep( (int64_t)WTMLIB_GET_TSC_END())));
+    }
+};
+
+/**
+ * Conversion of TSC ticks to nanoseconds and back
+ *
+ * The object keeps a copy of the conversion parameters and performs the same
+ * computations as WTMLIB_TSC_TO_NSEC() and WTMLIB_NSEC_TO_TSC(). All members are
+ * constexpr. If the parameters are known at compile time, the conversions are folded
+ * into constants
+ */
+class tsc_converter
+{
+public:
+    constexpr explicit tsc_converter( const wtmlib_TSCConversionParams_t &conv_params)
+        : cp_( conv_params)
+    {
+    }
+
+    constexpr uint64_t to_nsec( uint64_t tsc_ticks) const
+    {
+        return WTMLIB_TSC_TO_NSEC( tsc_ticks, &cp_);
+    }
+
+    constexpr uint64_t to_tsc( uint64_t nsecs) const
+    {
+        return WTMLIB_NSEC_TO_TSC( nsecs, &cp_);
+    }
+
+    /* Negative durations are not supported */
+    constexpr std::chrono::nanoseconds to_duration( tsc_clock::duration d) const
+    {
+        return std::chrono::nanoseconds( (std::chrono::nanoseconds::rep)
+                                         to_nsec( (uint64_t)d.count().count()));
+    }
+
+    constexpr tsc_clock::duration from_duration( std::chrono::nanoseconds d) const
+    {
+        return tsc_clock::duration( tsc_ticks( (int64_t)to_tsc( (uint64_t)d.count())));
+    }
+
+    constexpr const wtmlib_TSCConversionParams_t &params() const
+    {
+        return cp_;
+    }
+
+private:
+    wtmlib_TSCConversionParams_t cp_;
+};
+
+/* Compile-time counterparts of the computations done by
+   wtmlib_CalcTSCToNsecConversionParams(). Written in C++11 constexpr style (a single
+   return statement per function) */
+namespace detail
+{
+
+/* Position of the most significant set bit. Zero for 0 and 1 */
+constexpr int floor_log2( uint64_t x)
+{
+    return x > 1 ? 1 + floor_log2( x >> 1) : 0;
+}
+
+constexpr int calc_shift( uint64_t tsc_per_sec)
+{
+    return floor_log2( UINT64_MAX / (WTMLIB_TIME_CONVERSION_MODULUS * tsc_per_sec) *
+                       tsc_per_sec / 1000000000);
+}
+
+constexpr uint64_t calc_mult( uint64_t tsc_per_sec)
+{
+    return (1ull << calc_shift( tsc_per_sec)) * 1000000000 / tsc_per_sec;
+}
+
+constexpr int calc_tsc_remainder_length( uint64_t tsc_per_sec)
+{
+    return floor_log2( WTMLIB_TIME_CONVERSION_MODULUS * tsc_per_sec);
+}
+
+#ifdef __SIZEOF_INT128__
+constexpr int calc_wide_shift( uint64_t tsc_per_sec, int wide_shift = 0)
+{
+    return wide_shift < 97 &&
+           ((unsigned __int128)1000000000 << (wide_shift + 1)) / tsc_per_sec <=
+           UINT64_MAX ? calc_wide_shift( tsc_per_sec, wide_shift + 1) : wide_shift;
+}
+
+constexpr uint64_t calc_wide_mult( uint64_t tsc_per_sec)
+{
+    return (uint64_t)(((unsigned __int128)1000000000 << calc_wide_shift( tsc_per_sec)) /
+                      tsc_per_sec);
+}
+#else /* __SIZEOF_INT128__ */
+constexpr int calc_wide_shift( uint64_t tsc_per_sec)
+{
+    return 0;
+}
+
+constexpr uint64_t calc_wide_mult( uint64_t tsc_per_sec)
+{
+    return 0;
+}
+#endif /* __SIZEOF_INT128__ */
+
+constexpr int calc_nsec_to_tsc_shift( uint64_t tsc_per_sec)
+{
+    return floor_log2( UINT64_MAX / (WTMLIB_TIME_CONVERSION_MODULUS * 1000000000ull) *
+                       1000000000 / tsc_per_sec);
+}
+
+constexpr uint64_t calc_nsec_to_tsc_mult( uint64_t tsc_per_sec)
+{
+    return (1ull << calc_nsec_to_tsc_shift( tsc_per_sec)) * tsc_per_sec / 1000000000;
+}
+
+constexpr int calc_nsec_remainder_length()
+{
+    return floor_log2( WTMLIB_TIME_CONVERSION_MODULUS * 1000000000ull);
+}
+
+constexpr wtmlib_TSCConversionParams_t calc_conversion_params( uint64_t tsc_per_sec)
+{
+    return {.mult = calc_mult( tsc_per_sec),
+            .shift = calc_shift( tsc_per_sec),
+            .nsecs_per_tsc_modulus = ((1ull << calc_tsc_remainder_length( tsc_per_sec)) *
+                                      calc_mult( tsc_per_sec)) >>
+                                     calc_shift( tsc_per_sec),
+            .tsc_remainder_length = calc_tsc_remainder_length( tsc_per_sec),
+            .tsc_remainder_bitmask = (1ull << calc_tsc_remainder_length( tsc_per_sec)) -
+                                     1,
+            .tsc_ticks_per_sec = tsc_per_sec,
+            .plain_read_overhead = {0, 0},
+            .fenced_read_overhead = {0, 0},
+            .mfenced_read_overhead = {0, 0},
+            .wide_mult = calc_wide_mult( tsc_per_sec),
+            .wide_shift = calc_wide_shift( tsc_per_sec),
+            .nsec_to_tsc_mult = calc_nsec_to_tsc_mult( tsc_per_sec),
+            .nsec_to_tsc_shift = calc_nsec_to_tsc_shift( tsc_per_sec),
+            .tscs_per_nsec_modulus = ((1ull << calc_nsec_remainder_length()) *
+                                      calc_nsec_to_tsc_mult( tsc_per_sec)) >>
+                                     calc_nsec_to_tsc_shift( tsc_per_sec),
+            .nsec_remainder_length = calc_nsec_remainder_length(),
+            .nsec_remainder_bitmask = (1ull << calc_nsec_remainder_length()) - 1};
+}
+
+} /* namespace detail */
+
+/**
+ * Clock for systems where TSC frequency is known at compile time
+ *
+ * Conversion parameters are computed at compile time. They are identical to the
+ * parameters that wtmlib_CalcTSCToNsecConversionParams() would compute at run time for
+ * the same frequency. So, the multiplier, the shift and the bitmask become immediate
+ * operands of the conversion code. Unlike tsc_clock, "period" of this clock is exact.
+ * Thus, its durations can also be converted by means of std::chrono::duration_cast().
+ *
+ * The frequency must be verified at startup, before the clock is trusted:
+ *      typedef wtmlib::fixed_tsc_clock<2100000000> clock;
+ *      ...
+ *      if ( clock::verify( 100, err_msg, sizeof( err_msg)) ) ...
+ *      ...
+ *      uint64_t nsecs = clock::to_nsec( end - start);
+ */
+template <uint64_t TSCPerSec>
+struct fixed_tsc_clock
+{
+    static_assert( TSCPerSec >= 1000000 &&
+                   TSCPerSec <= UINT64_MAX / WTMLIB_TIME_CONVERSION_MODULUS,
+                   "TSC frequency is out of the supported range");
+
+    typedef int64_t rep;
+    typedef std::ratio<1, TSCPerSec> period;
+    typedef std::chrono::duration<rep, period> duration;
+    typedef std::chrono::time_point<fixed_tsc_clock> time_point;
+
+    static constexpr bool is_steady = true;
+    static constexpr wtmlib_TSCConversionParams_t conv_params =
+        detail::calc_conversion_params( TSCPerSec);
+
+    static time_point now() noexcept
+    {
+        return time_point( duration( (rep)WTMLIB_GET_TSC()));
+    }
+
+    static constexpr uint64_t to_nsec( uint64_t tsc_ticks)
+    {
+        return WTMLIB_TSC_TO_NSEC( tsc_ticks, &conv_params);
+    }
+
+    static constexpr uint64_t to_tsc( uint64_t nsecs)
+    {
+        return WTMLIB_NSEC_TO_TSC( nsecs, &conv_params);
+    }
+
+    static constexpr tsc_converter converter()
+    {
+        return tsc_converter( conv_params);
+    }
+
+    /**
+     * Check that the calibrated TSC frequency differs from TSCPerSec by no more than
+     * "tolerance_ppm" parts per million
+     *
+     * Returns 0 if the frequencies match. WTMLIB_RET_GENERIC_ERR otherwise. err_msg is
+     * modified only if the return code is non-zero
+     */
+    static int verify( const wtmlib_TSCConversionParams_t &calibrated,
+                       uint64_t tolerance_ppm, char *err_msg, int err_msg_size)
+    {
+        uint64_t actual = calibrated.tsc_ticks_per_sec;
+        uint64_t diff = actual > TSCPerSec ? actual - TSCPerSec : TSCPerSec - actual;
+
+        /* diff * 1000000 <= tolerance_ppm * TSCPerSec. Computed in floating point to
+           avoid overflow */
+        if ( (double)diff * 1000000 > (double)tolerance_ppm * TSCPerSec )
+        {
+            if ( err_msg )
+            {
+                snprintf( err_msg, err_msg_size, "Calibrated TSC frequency (%lu ticks "
+                          "per second) differs from the expected one (%lu) by more than "
+                          "%lu ppm", actual, TSCPerSec, tolerance_ppm);
+            }
+
+            return WTMLIB_RET_GENERIC_ERR;
+        }
+
+        return 0;
+    }
+
+    /* Same as above, but calibrates TSC first by means of
+       wtmlib_GetTSCToNsecConversionParamsFast() (with the cross-check enabled) */
+    static int verify( uint64_t tolerance_ppm, char *err_msg, int err_msg_size)
+    {
+        wtmlib_TSCConversionParams_t calibrated;
+        char local_err_msg[WTMLIB_MAX_ERR_MSG_SIZE] = "";
+
+        if ( wtmlib_GetTSCToNsecConversionParamsFast( true, &calibrated, 0, 0,
+                                                      local_err_msg,
+                                                      sizeof( local_err_msg)) )
+        {
+            if ( err_msg )
+            {
+                snprintf( err_msg, err_msg_size, "Couldn't calibrate TSC: %s",
+                          local_err_msg);
+            }
+
+            return WTMLIB_RET_GENERIC_ERR;
+        }
+
+        return verify( calibrated, tolerance_ppm, err_msg, err_msg_size);
+    }
+};
+
+template <uint64_t TSCPerSec>
+constexpr wtmlib_TSCConversionParams_t fixed_tsc_clock<TSCPerSec>::conv_params;
+
+/**
+ * Sink that records intervals into a log-linear histogram (see wtmlib_Histogram_t)
+ *
+ * The sink owns the histogram. It must be initialized by means of init() before the
+ * first interval is recorded. Recording is done by WTMLIB_HISTOGRAM_RECORD(). The sink
+ * must be recorded to by a single thread. Histograms of different threads can be merged
+ * and reported by passing histogram() to wtmlib_MergeHistogram() and
+ * wtmlib_GetHistogramPercentiles()
+ */
+class histogram_sink
+{
+public:
+    histogram_sink() : hist_()
+    {
+    }
+
+    ~histogram_sink()
+    {
+        wtmlib_FreeHistogram( &hist_);
+    }
+
+    histogram_sink( const histogram_sink&) = delete;
+    histogram_sink &operator=( const histogram_sink&) = delete;
+
+    /* Same return codes as wtmlib_CreateHistogram() */
+    int init( const wtmlib_TSCConversionParams_t &conv_params, char *err_msg,
+              int err_msg_size)
+    {
+        wtmlib_FreeHistogram( &hist_);
+
+        return wtmlib_CreateHistogram( &conv_params, &hist_, err_msg, err_msg_size);
+    }
+
+    void record( uint64_t start_tsc, uint64_t end_tsc) noexcept
+    {
+        WTMLIB_HISTOGRAM_RECORD( &hist_, start_tsc, end_tsc);
+    }
+
+    wtmlib_Histogram_t *histogram()
+    {
+        return &hist_;
+    }
+
+    const wtmlib_Histogram_t *histogram() const
+    {
+        return &hist_;
+    }
+
+private:
+    wtmlib_Histogram_t hist_;
+};
+
+/**
+ * Sink that appends intervals to a trace ring (see wtmlib_CreateTraceRing())
+ *
+ * Each interval becomes a trace record with the given event ID. The record is stamped
+ * with the TSC value at the start of the interval. Its payload is the length of the
+ * interval in TSC ticks. Records are read by means of wtmlib_DrainTrace(). Like the
+ * ring itself, the sink must be recorded to by a single thread
+ */
+class trace_ring_sink
+{
+public:
+    trace_ring_sink( wtmlib_TraceRing_t *ring, uint32_t event_id) noexcept
+        : ring_( ring), event_id_( event_id)
+    {
+    }
+
+    void record( uint64_t start_tsc, uint64_t end_tsc) noexcept
+    {
+        wtmlib_AppendTraceRecord( ring_, start_tsc, event_id_, end_tsc - start_tsc);
+    }
+
+private:
+    wtmlib_TraceRing_t *ring_;
+    uint32_t event_id_;
+};
+
+/**
+ * Timer that records the lifetime of its scope into a sink
+ *
+ * Sink is any type that has "void record( uint64_t start_tsc, uint64_t end_tsc)"
+ * member. For example:
+ *      static thread_local wtmlib::histogram_sink parse_latency;
+ *      ...
+ *      parse_latency.init( conv_params, err_msg, sizeof( err_msg));
+ *      ...
+ *      {
+ *          wtmlib::scoped_timer<wtmlib::histogram_sink> timer( parse_latency);
+ *          parse( request);
+ *      }
+ *
+ * Unfenced TSC reads are used (see notes to WTMLIB_GET_TSC() regarding reordering)
+ */
+template <typename Sink>
+class scoped_timer
+{
+public:
+    explicit scoped_timer( Sink &sink) noexcept : sink_( sink), start_( WTMLIB_GET_TSC())
+    {
+    }
+
+    ~scoped_timer()
+    {
+        sink_.record( start_, WTMLIB_GET_TSC());
+    }
+
+    scoped_timer( const scoped_timer&) = delete;
+    scoped_timer &operator=( const scoped_timer&) = delete;
+
+private:
+    Sink &sink_;
+    uint64_t start_;
+};
+
+/**
+ * Get ID of a profiled region (see wtmlib_ProfilerRegisterRegion()). Returns -1 if the
+ * region couldn't be registered. Such a region is not reported by the profiler
+ */
+inline int profiler_region_id( const char *name)
+{
+    int region_id = -1;
+
+    return wtmlib_ProfilerRegisterRegion( name, &region_id, 0, 0) ? -1 : region_id;
+}
+
+/**
+ * Profiled region that lasts until the end of the enclosing scope:
+ *      static const int parse_region = wtmlib::profiler_region_id( "parse");
+ *      ...
+ *      {
+ *          wtmlib::profiled_scope scope( parse_region);
+ *          parse( request);
+ *      }
+ */
+class profiled_scope
+{
+public:
+    explicit profiled_scope( int region_id) noexcept
+    {
+        wtmlib_ProfilerEnter( region_id);
+    }
+
+    ~profiled_scope()
+    {
+        wtmlib_ProfilerExit();
+    }
+
+    profiled_scope( const profiled_scope&) = delete;
+    profiled_scope &operator=( const profiled_scope&) = delete;
+};
+
+} /* namespace wtmlib */
+
+#endif /* _WTMLIB_HPP_ */
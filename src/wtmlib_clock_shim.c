@@ -0,0 +1,36 @@
+/**
+ * Copyright © 2018 Andrey Nevolin, https://github.com/AndreyNevolin
+ * Twitter: @Andrey_Nevolin
+ * LinkedIn: https://www.linkedin.com/in/andrey-nevolin-76387328
+ *
+ * WTMLIB: a library for taking Wall-clock Time Measurements
+ *
+ * Clock shim: replaces clock_gettime() with wtmlib_clock_gettime() in programs that
+ * load the shim library by means of LD_PRELOAD. The TSC-based clock is started in the
+ * background when the shim is loaded. Loading is not delayed: the clock doesn't run the
+ * statistical calibration and becomes operational within about one refresh period.
+ * Until then, all calls are served by the system's clock_gettime()
+ */
+
+#include <time.h>
+
+#include "wtmlib.h"
+
+/**
+ * Start the TSC-based clock when the shim is loaded
+ */
+static void __attribute__((constructor)) wtmlib_InitClockShim()
+{
+    /* Errors are ignored. The system's clock_gettime() is used in case of error */
+    wtmlib_StartClock( false, 0, 0);
+
+    return;
+}
+
+/**
+ * Replacement for the system's clock_gettime()
+ */
+extern "C" int clock_gettime( clockid_t clk_id, struct timespec *tp) __THROW
+{
+    return wtmlib_clock_gettime( clk_id, tp);
+}
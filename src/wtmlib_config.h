@@ -115,6 +115,44 @@
 	 into tsc-per-second
 */
 #define WTMLIB_TIME_PERIOD_TO_MATCH_WITH_TSC 500000
+/*
+   The initial time period (in microseconds) used by the adaptive calibration (see
+   wtmlib_GetTSCToNsecConversionParamsAdaptive()). The period is doubled each time the
+   requested precision cannot be reached with the current period. It never exceeds
+   WTMLIB_TIME_PERIOD_TO_MATCH_WITH_TSC
+*/
+#define WTMLIB_ADAPTIVE_CALIB_INITIAL_PERIOD 10000
+/*
+   The number of measurements done with each time period by the adaptive calibration
+   before the period is doubled. Once the period reaches
+   WTMLIB_TIME_PERIOD_TO_MATCH_WITH_TSC, up to WTMLIB_TSC_PER_SEC_SAMPLE_COUNT
+   measurements are done
+*/
+#define WTMLIB_ADAPTIVE_CALIB_SAMPLES_PER_PERIOD 10
+/*
+   The minimum number of measurements needed to evaluate precision of TSC frequency.
+   Evaluation based on fewer samples is not trusted
+*/
+#define WTMLIB_ADAPTIVE_CALIB_MIN_SAMPLES 5
+/*
+   Z-score used to calculate a confidence interval of TSC frequency. The default value
+   corresponds to 95% confidence (assuming normal distribution of measurement errors)
+*/
+#define WTMLIB_ADAPTIVE_CALIB_Z_SCORE 1.96
+/*
+   The minimum number of measurements of TSC worth of a second done on each CPU by the
+   parallel calibration (see wtmlib_GetTSCToNsecConversionParamsParallel()).
+   WTMLIB_TSC_PER_SEC_SAMPLE_COUNT measurements are evenly distributed among the
+   available CPUs. But on systems with many CPUs each CPU would get too few measurements
+   to evaluate its socket separately
+*/
+#define WTMLIB_PARALLEL_CALIB_MIN_SAMPLES_PER_CPU 3
+/*
+   Maximum allowed disagreement (in parts per million) between TSC frequencies measured
+   on different physical packages (sockets) by the parallel calibration. If the
+   disagreement is bigger, TSCs are considered inconsistent
+*/
+#define WTMLIB_PARALLEL_CALIB_MAX_DISAGREEMENT 100
 /*
    A time period (measured in seconds) used to calculate TSC-to-nanoseconds conversion
    parameters
@@ -128,3 +166,153 @@
    The accuracy of the conversion depends on the value of the "modulus"
 */
 #define WTMLIB_TIME_CONVERSION_MODULUS 10
+/*
+   Period of time (in microseconds) used to validate TSC-to-nanoseconds conversion
+   parameters loaded from a calibration cache file
+
+   Before parameters loaded from the cache are returned to the client, the library
+   quickly re-measures how TSC changes during this period of time and compares the result
+   with the cached TSC frequency. The check is cheap compared to the full calibration
+   procedure but it dominates the time needed to load the cache. Setting the period to
+   "zero" disables the check (the cache is then trusted as long as the machine
+   fingerprint matches)
+*/
+#define WTMLIB_CALIB_CACHE_CHECK_PERIOD 2000
+/*
+   Maximum allowed deviation (in parts per million) between the cached TSC frequency and
+   the TSC frequency measured while validating the cache
+
+   The validation period is short. Thus, a single measurement may be affected by an
+   interrupt or a context switch. The tolerance should be large enough to survive that,
+   but small enough to catch a real frequency change
+*/
+#define WTMLIB_CALIB_CACHE_CHECK_TOLERANCE 1000
+/*
+   Number of attempts to validate cached TSC frequency. The cache is considered valid if
+   at least one attempt succeeds
+*/
+#define WTMLIB_CALIB_CACHE_CHECK_ATTEMPTS 3
+/*
+   Period of time (in microseconds) used to cross-check TSC frequency reported by the
+   kernel or the hardware against system time (if the client requests the cross-check)
+
+   Reported TSC frequency is not always exact. E.g. on some x86 CPUs it is derived from
+   the processor base frequency. The cross-check is meant to catch such cases
+*/
+#define WTMLIB_FAST_CALIB_CHECK_PERIOD 10000
+/*
+   Maximum allowed deviation (in parts per million) between the reported TSC frequency
+   and the TSC frequency measured during the cross-check. If the deviation is bigger,
+   the library falls back to the full statistical calibration
+*/
+#define WTMLIB_FAST_CALIB_CHECK_TOLERANCE 1000
+/*
+   Number of attempts to cross-check the reported TSC frequency. The check succeeds if
+   at least one attempt succeeds
+*/
+#define WTMLIB_FAST_CALIB_CHECK_ATTEMPTS 3
+/*
+   Maximum number of records that a single trace ring can hold (see
+   wtmlib_CreateTracer()). Must be a power of 2
+*/
+#define WTMLIB_TRACE_MAX_RING_CAPACITY (1ULL << 30)
+/*
+   Maximum number of records that a trace file can hold (see wtmlib_CreateTraceFile())
+*/
+#define WTMLIB_TRACE_FILE_MAX_CAPACITY (1ULL << 32)
+/*
+   Log2 of the number of buckets that a histogram of TSC tick deltas allocates per each
+   power-of-2 range of values (see wtmlib_CreateHistogram()). Relative error of values
+   reported by the histogram doesn't exceed 2^(-WTMLIB_HISTOGRAM_SUB_BUCKET_BITS). The
+   histogram occupies 2 * 8 * (65 - WTMLIB_HISTOGRAM_SUB_BUCKET_BITS) *
+   2^WTMLIB_HISTOGRAM_SUB_BUCKET_BITS bytes. Must be in the range [1, 16]
+*/
+#define WTMLIB_HISTOGRAM_SUB_BUCKET_BITS 5
+/*
+   Number of back-to-back fenced TSC reads used to measure the overhead of fenced TSC
+   reading (see wtmlib_GetFencedTSCReadOverhead())
+*/
+#define WTMLIB_TSC_READ_OVERHEAD_MEASUREMENTS 10000
+/*
+   Number of attempts made to read system clocks inside a narrow TSC interval when
+   recording an anchor (see wtmlib_GetTSCAnchor()). The narrowest interval is used
+*/
+#define WTMLIB_TSC_ANCHOR_ATTEMPTS 100
+/*
+   Period (in microseconds) at which the TSC-based system clock is re-anchored to
+   CLOCK_MONOTONIC and CLOCK_REALTIME (see wtmlib_StartClock())
+*/
+#define WTMLIB_CLOCK_REFRESH_PERIOD 1000000
+/*
+   Maximum age of the TSC-based system clock state (in refresh periods). If the state
+   wasn't refreshed for longer, wtmlib_clock_gettime() falls back to the system's
+   clock_gettime()
+*/
+#define WTMLIB_CLOCK_MAX_ANCHOR_AGE 4
+/*
+   Maximum lag (in nanoseconds) of the TSC-based system clock behind CLOCK_MONOTONIC that
+   is corrected by adjusting the rate of the clock. Bigger lags are corrected by a step
+*/
+#define WTMLIB_CLOCK_MAX_CORRECTION 1000000
+/*
+   Period (in microseconds) at which the drift tracker samples TSC against
+   CLOCK_MONOTONIC_RAW (see wtmlib_StartDriftTracker())
+*/
+#define WTMLIB_DRIFT_TRACKER_PERIOD 10000000
+/*
+   Number of the most recent samples that the drift tracker fits a line to. The TSC
+   frequency is estimated over the last WTMLIB_DRIFT_TRACKER_WINDOW *
+   WTMLIB_DRIFT_TRACKER_PERIOD microseconds. Must be at least 2
+*/
+#define WTMLIB_DRIFT_TRACKER_WINDOW 30
+/*
+   Maximum deviation (in parts per million) of the TSC frequency estimated by the drift
+   tracker from the initial one. Bigger deviations are considered a result of a clock
+   or TSC disturbance (e.g. a system suspend). The tracker discards the collected
+   samples in that case and starts over
+*/
+#define WTMLIB_DRIFT_TRACKER_MAX_DRIFT 1000
+/*
+   Latency (in nanoseconds) of waking up from nanosleep() assumed by
+   wtmlib_SleepUntilTSC() until it's measured by wtmlib_CalibrateSleep()
+*/
+#define WTMLIB_SLEEP_DEFAULT_WAKEUP_LATENCY 100000
+/*
+   Number of nanosleep() calls made by wtmlib_CalibrateSleep() to measure the wake-up
+   latency
+*/
+#define WTMLIB_SLEEP_CALIBRATION_ROUNDS 200
+/*
+   Duration (in nanoseconds) of a single nanosleep() call made by
+   wtmlib_CalibrateSleep(). Must be less than a second
+*/
+#define WTMLIB_SLEEP_CALIBRATION_PERIOD 100000
+/*
+   Percentile of the measured wake-up latencies that is used as the latency estimate
+*/
+#define WTMLIB_SLEEP_LATENCY_PERCENTILE 99
+/*
+   Minimum time (in nanoseconds) that wtmlib_SleepUntilTSC() spends spinning before the
+   deadline (in addition to the wake-up latency). Absorbs variance of the latency
+*/
+#define WTMLIB_SLEEP_MIN_SPIN_TIME 2000
+
+/*
+   Default parameters of a micro-benchmark (see wtmlib_RunBenchmark()): the number of
+   warm-up iterations, the number of samples, and the number of iterations timed as a
+   single sample
+*/
+#define WTMLIB_BENCH_WARMUP_ITERATIONS 100000
+#define WTMLIB_BENCH_SAMPLES 10000
+#define WTMLIB_BENCH_ITERATIONS_PER_SAMPLE 100
+
+/*
+   Maximum number of regions that can be registered in the profiler (see
+   wtmlib_ProfilerRegisterRegion()). Every profiled thread keeps counters for each region
+*/
+#define WTMLIB_PROFILER_MAX_REGIONS 256
+
+/*
+   Maximum nesting depth of profiled regions. Regions nested deeper are not profiled
+*/
+#define WTMLIB_PROFILER_MAX_DEPTH 64
@@ -0,0 +1,188 @@
+/**
+ * Copyright © 2018 Andrey Nevolin, https://github.com/AndreyNevolin
+ * Twitter: @Andrey_Nevolin
+ * LinkedIn: https://www.linkedin.com/in/andrey-nevolin-76387328
+ *
+ * Tool that converts a trace file written by means of WTMLIB_TRACE_FILE_EVENT() to a
+ * nanosecond timeline
+ *
+ * Usage: trace_reader <trace file>
+ *
+ * Records are printed to stdout sorted by time. One record per line:
+ *      <nanoseconds since the file creation> <CPU ID> <event ID> <payload>
+ * Summary of the file is printed to stderr
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "src/wtmlib.h"
+
+/* A record with its TSC value corrected by the offset of the CPU it was read on */
+typedef struct
+{
+    uint64_t tsc;
+    const wtmlib_TraceFileRecord_t *record;
+} CorrectedRecord_t;
+
+int compareRecords( const void *a, const void *b)
+{
+    uint64_t tsc_a = ((const CorrectedRecord_t*)a)->tsc;
+    uint64_t tsc_b = ((const CorrectedRecord_t*)b)->tsc;
+
+    return tsc_a < tsc_b ? -1 : (tsc_a > tsc_b ? 1 : 0);
+}
+
+int main( int argc, char **argv)
+{
+    const wtmlib_TraceFileHeader_t *header = 0;
+    const int64_t *offsets = 0;
+    const wtmlib_TraceFileRecord_t *records = 0;
+    CorrectedRecord_t *sorted = 0;
+    uint64_t num_appended = 0, num_stored = 0, num_complete = 0;
+    uint64_t file_size = 0;
+    struct stat file_stat;
+    void *map_addr = MAP_FAILED;
+    int fd = -1;
+    int ret = 1;
+
+    if ( argc != 2 )
+    {
+        fprintf( stderr, "Usage: %s <trace file>\n", argv[0]);
+
+        return 1;
+    }
+
+    fd = open( argv[1], O_RDONLY);
+
+    if ( fd == -1 || fstat( fd, &file_stat) )
+    {
+        fprintf( stderr, "Couldn't open \"%s\": %s\n", argv[1], strerror( errno));
+
+        goto main_out;
+    }
+
+    file_size = (uint64_t)file_stat.st_size;
+
+    if ( file_size < sizeof( wtmlib_TraceFileHeader_t) )
+    {
+        fprintf( stderr, "\"%s\" is too small to be a trace file\n", argv[1]);
+
+        goto main_out;
+    }
+
+    map_addr = mmap( 0, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if ( map_addr == MAP_FAILED )
+    {
+        fprintf( stderr, "Couldn't map \"%s\" to memory: %s\n", argv[1],
+                 strerror( errno));
+
+        goto main_out;
+    }
+
+    header = (const wtmlib_TraceFileHeader_t*)map_addr;
+
+    if ( memcmp( header->magic, WTMLIB_TRACE_FILE_MAGIC, sizeof( header->magic)) ||
+         header->version != WTMLIB_TRACE_FILE_VERSION ||
+         header->record_size != sizeof( wtmlib_TraceFileRecord_t) )
+    {
+        fprintf( stderr, "\"%s\" is not a trace file or has unsupported format\n",
+                 argv[1]);
+
+        goto main_out;
+    }
+
+    /* The header comes from an untrusted file. So, the layout is validated without sums
+       or products that could overflow: every operand is bounded by the preceding
+       checks. "file_size" is not smaller than the header. "record_size" is known to be
+       non-zero */
+    if ( header->num_cpus < 0 ||
+         (uint64_t)header->num_cpus >
+         (file_size - sizeof( *header)) / sizeof( int64_t) ||
+         header->counter_offset % sizeof( uint64_t) ||
+         header->counter_offset <
+         sizeof( *header) + header->num_cpus * sizeof( int64_t) ||
+         header->counter_offset > file_size - sizeof( uint64_t) ||
+         header->records_offset % sizeof( uint64_t) ||
+         header->records_offset < header->counter_offset + sizeof( uint64_t) ||
+         header->records_offset > file_size ||
+         header->capacity > (file_size - header->records_offset) / header->record_size )
+    {
+        fprintf( stderr, "\"%s\" is corrupted\n", argv[1]);
+
+        goto main_out;
+    }
+
+    offsets = (const int64_t*)(header + 1);
+    records = (const wtmlib_TraceFileRecord_t*)((const char*)map_addr +
+                                                header->records_offset);
+    num_appended = *(const uint64_t*)((const char*)map_addr + header->counter_offset);
+    num_stored = num_appended < header->capacity ? num_appended : header->capacity;
+    sorted = (CorrectedRecord_t*)calloc( num_stored ? num_stored : 1,
+                                         sizeof( CorrectedRecord_t));
+
+    if ( !sorted )
+    {
+        fprintf( stderr, "Couldn't allocate memory for %lu records\n", num_stored);
+
+        goto main_out;
+    }
+
+    for ( uint64_t i = 0; i < num_stored; i++ )
+    {
+        const wtmlib_TraceFileRecord_t *record = &records[i];
+        uint64_t tsc = record->tsc;
+
+        /* The record was reserved but never completed */
+        if ( !tsc ) continue;
+
+        if ( record->cpu_id < (uint32_t)header->num_cpus )
+        {
+            tsc -= (uint64_t)offsets[record->cpu_id];
+        }
+
+        sorted[num_complete].tsc = tsc;
+        sorted[num_complete].record = record;
+        num_complete++;
+    }
+
+    qsort( sorted, num_complete, sizeof( CorrectedRecord_t), compareRecords);
+    fprintf( stderr, "Trace file \"%s\":\n", argv[1]);
+    fprintf( stderr, "\tTSC ticks per second: %lu\n",
+             header->conv_params.tsc_ticks_per_sec);
+    fprintf( stderr, "\tPer-CPU TSC offsets: %d (base CPU %d, uncertainty %ld ticks)\n",
+             header->num_cpus, header->base_cpu, header->max_uncertainty);
+    fprintf( stderr, "\tRecords: %lu complete, %lu incomplete, %lu dropped\n",
+             num_complete, num_stored - num_complete, num_appended - num_stored);
+
+    for ( uint64_t i = 0; i < num_complete; i++ )
+    {
+        const wtmlib_TraceFileRecord_t *record = sorted[i].record;
+        uint64_t ticks = sorted[i].tsc > header->start_tsc ?
+                         sorted[i].tsc - header->start_tsc : 0;
+
+        fprintf( stdout, "%lu %u %u %lu\n",
+                 WTMLIB_TSC_TO_NSEC( ticks, &header->conv_params), record->cpu_id,
+                 record->event_id, record->payload);
+    }
+
+    ret = 0;
+
+main_out:
+    if ( sorted ) free( sorted);
+
+    if ( map_addr != MAP_FAILED ) munmap( map_addr, file_stat.st_size);
+
+    if ( fd != -1 ) close( fd);
+
+    return ret;
+}